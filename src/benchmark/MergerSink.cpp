@@ -0,0 +1,203 @@
+/*
+ * MergerSink.cpp
+ *
+ *  Created on: Oct 16, 2026
+ *      Author: Jonas Kunze (kunze.jonas@gmail.com)
+ */
+
+#include "MergerSink.h"
+
+#include <socket/ZMQHandler.h>
+#include <structs/Event.h>
+#include <zmq.h>
+#include <zmq.hpp>
+#include <lz4.h>
+#include <chrono>
+#include <cstring>
+#include <sstream>
+
+#include <options/Logging.h>
+
+#include "../eventBuilding/EventBatcher.h"
+#include "../eventBuilding/OutputCompressor.h"
+
+namespace na62 {
+
+static uint64_t nowNanos() {
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(
+			std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+MergerSink::MergerSink(uint port, uint maxEventNumber) :
+		running_(true), maxEventNumber_(maxEventNumber), eventsReceived_(0), bytesReceived_(
+				0), brokenEvents_(0), lastReceiveNanos_(0) {
+	generationNanos_ = new std::atomic<uint64_t>[maxEventNumber];
+	for (uint i = 0; i != maxEventNumber; i++) {
+		generationNanos_[i] = 0;
+	}
+
+	std::stringstream address;
+	address << "tcp://*:" << port;
+
+	socket_ = ZMQHandler::GenerateSocket("MergerSink", ZMQ_PULL);
+	int timeout = 100;
+	socket_->setsockopt(ZMQ_RCVTIMEO, &timeout, sizeof(timeout));
+	socket_->bind(address.str().c_str());
+	LOG_INFO<< "Benchmark merger sink listening at " << address.str() << ENDL;
+}
+
+MergerSink::~MergerSink() {
+	ZMQHandler::DestroySocket(socket_);
+	delete[] generationNanos_;
+}
+
+void MergerSink::startRun() {
+	tbb::spin_mutex::scoped_lock my_lock(latencyMutex_);
+	latencies_.clear();
+	eventsReceived_ = 0;
+	bytesReceived_ = 0;
+	brokenEvents_ = 0;
+	lastReceiveNanos_ = 0;
+}
+
+std::vector<uint64_t> MergerSink::getLatencies() {
+	tbb::spin_mutex::scoped_lock my_lock(latencyMutex_);
+	return latencies_;
+}
+
+void MergerSink::thread() {
+	std::string event;
+	while (running_) {
+		/*
+		 * Multipart messages are concatenated to one event
+		 */
+		event.clear();
+		bool more = true;
+		while (more) {
+			zmq::message_t message;
+			try {
+				if (!socket_->recv(&message)) {
+					break;
+				}
+			} catch (const zmq::error_t& ex) {
+				if (ex.num() != EINTR) {
+					LOG_ERROR<< "Merger sink: " << ex.what() << ENDL;
+					return;
+				}
+				break;
+			}
+			event.append((const char*) message.data(), message.size());
+			more = message.more();
+		}
+
+		if (!event.empty() && !more) {
+			onMessageReceived(event.data(), event.size());
+		}
+	}
+}
+
+void MergerSink::onMessageReceived(const char* data, const uint length) {
+	uint32_t magic = 0;
+	if (length >= sizeof(EVENT_BATCH_HDR)) {
+		memcpy(&magic, data, sizeof(magic));
+	}
+	if (magic == COMPRESSED_MESSAGE_MAGIC) {
+		COMPRESSED_MESSAGE_HDR hdr;
+		memcpy(&hdr, data, sizeof(hdr));
+		std::string message(hdr.uncompressedLength, '\0');
+		if (sizeof(hdr) + hdr.compressedLength != length
+				|| LZ4_decompress_safe(data + sizeof(hdr), &message[0],
+						hdr.compressedLength, hdr.uncompressedLength)
+						!= (int) hdr.uncompressedLength) {
+			brokenEvents_++;
+			return;
+		}
+		onMessageReceived(message.data(), message.size());
+		return;
+	}
+
+	if (magic != EVENT_BATCH_MAGIC) {
+		onEventReceived(data, length);
+		return;
+	}
+
+	EVENT_BATCH_HDR hdr;
+	memcpy(&hdr, data, sizeof(hdr));
+	if (hdr.length != length) {
+		brokenEvents_++;
+		return;
+	}
+
+	uint offset = sizeof(EVENT_BATCH_HDR);
+	for (uint eventNum = 0; eventNum != hdr.numberOfEvents; eventNum++) {
+		uint32_t eventLength;
+		if (offset + sizeof(eventLength) > length) {
+			brokenEvents_++;
+			return;
+		}
+		memcpy(&eventLength, data + offset, sizeof(eventLength));
+		offset += sizeof(eventLength);
+		if (offset + eventLength > length) {
+			brokenEvents_++;
+			return;
+		}
+		onEventReceived(data + offset, eventLength);
+		offset += eventLength;
+	}
+}
+
+void MergerSink::onEventReceived(const char* data, const uint length) {
+	const uint64_t now = nowNanos();
+	lastReceiveNanos_ = now;
+	bytesReceived_ += length;
+	eventsReceived_++;
+
+	if (!checkEventFraming(data, length)) {
+		brokenEvents_++;
+		return;
+	}
+
+	const EVENT_HDR* hdr = (const EVENT_HDR*) data;
+	if (hdr->eventNum < maxEventNumber_) {
+		const uint64_t generated = generationNanos_[hdr->eventNum].load(
+				std::memory_order_relaxed);
+		tbb::spin_mutex::scoped_lock my_lock(latencyMutex_);
+		latencies_.push_back(now - generated);
+	}
+}
+
+bool MergerSink::checkEventFraming(const char* data, const uint length) {
+	if (length < sizeof(EVENT_HDR) + sizeof(EVENT_TRAILER) || length % 4 != 0) {
+		return false;
+	}
+
+	const EVENT_HDR* hdr = (const EVENT_HDR*) data;
+	if (hdr->length * 4 != length) {
+		return false;
+	}
+
+	/*
+	 * Every entry of the pointer table must point behind the table and before the trailer
+	 */
+	const uint pointerTableEnd = sizeof(EVENT_HDR) + 4 * hdr->numberOfDetectors;
+	if (pointerTableEnd + sizeof(EVENT_TRAILER) > length) {
+		return false;
+	}
+
+	uint lastOffset = pointerTableEnd;
+	for (uint detector = 0; detector != hdr->numberOfDetectors; detector++) {
+		uint32_t entry;
+		memcpy(&entry, data + sizeof(EVENT_HDR) + 4 * detector, 4);
+		const uint offset = (entry & 0xFFFFFF) * 4;
+		if (offset < lastOffset || offset > length - sizeof(EVENT_TRAILER)) {
+			return false;
+		}
+		lastOffset = offset;
+	}
+
+	const EVENT_TRAILER* trailer = (const EVENT_TRAILER*) (data + length
+			- sizeof(EVENT_TRAILER));
+	return trailer->eventNum == hdr->eventNum;
+}
+
+} /* namespace na62 */
@@ -0,0 +1,111 @@
+/*
+ * MergerSink.h
+ *
+ *  Created on: Oct 16, 2026
+ *      Author: Jonas Kunze (kunze.jonas@gmail.com)
+ */
+
+#pragma once
+#ifndef MERGERSINK_H_
+#define MERGERSINK_H_
+
+#include <sys/types.h>
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <tbb/spin_mutex.h>
+#include <utils/AExecutable.h>
+
+namespace zmq {
+class socket_t;
+} /* namespace zmq */
+
+namespace na62 {
+
+/*
+ * Local replacement of the merger used by the ThroughputBenchmark. Receives events via a ZMQ
+ * PULL socket, checks the EVENT_HDR framing and measures the latency between the generation
+ * of the event's first MEP and its arrival
+ */
+class MergerSink: public AExecutable {
+public:
+	/**
+	 * @param maxEventNumber Largest event number to be expected +1
+	 */
+	MergerSink(uint port, uint maxEventNumber);
+	virtual ~MergerSink();
+
+	void stopRunning() {
+		running_ = false;
+	}
+
+	/**
+	 * Must be called right before the first MEP of the event is generated
+	 */
+	inline void setGenerationTime(uint32_t eventNumber, uint64_t nanos) {
+		generationNanos_[eventNumber].store(nanos, std::memory_order_relaxed);
+	}
+
+	/**
+	 * Resets all counters and the latencies measured so far
+	 */
+	void startRun();
+
+	/**
+	 * @return The latencies in nanoseconds of all events received since startRun()
+	 */
+	std::vector<uint64_t> getLatencies();
+
+	inline uint64_t getEventsReceived() const {
+		return eventsReceived_;
+	}
+
+	inline uint64_t getBytesReceived() const {
+		return bytesReceived_;
+	}
+
+	inline uint64_t getBrokenEvents() const {
+		return brokenEvents_;
+	}
+
+	/**
+	 * @return Time of the last received event in nanoseconds
+	 */
+	inline uint64_t getLastReceiveTime() const {
+		return lastReceiveNanos_;
+	}
+
+	/**
+	 * @return <true> if the EVENT_HDR, the pointer table and the trailer of the event are consistent
+	 */
+	static bool checkEventFraming(const char* data, const uint length);
+
+private:
+	void thread();
+
+	/**
+	 * Splits batches of events (EVENT_BATCH_HDR) into their events
+	 */
+	void onMessageReceived(const char* data, const uint length);
+
+	void onEventReceived(const char* data, const uint length);
+
+	bool running_;
+	zmq::socket_t* socket_;
+
+	std::atomic<uint64_t>* generationNanos_;
+	const uint maxEventNumber_;
+
+	std::atomic<uint64_t> eventsReceived_;
+	std::atomic<uint64_t> bytesReceived_;
+	std::atomic<uint64_t> brokenEvents_;
+	std::atomic<uint64_t> lastReceiveNanos_;
+
+	tbb::spin_mutex latencyMutex_;
+	std::vector<uint64_t> latencies_;
+};
+
+} /* namespace na62 */
+
+#endif /* MERGERSINK_H_ */
@@ -0,0 +1,410 @@
+/*
+ * ThroughputBenchmark.cpp
+ *
+ *  Created on: Oct 16, 2026
+ *      Author: Jonas Kunze (kunze.jonas@gmail.com)
+ */
+
+#include "ThroughputBenchmark.h"
+
+#include <arpa/inet.h>
+#include <net/ethernet.h>
+#include <netinet/in.h>
+#include <netinet/ip.h>
+#include <netinet/udp.h>
+#include <tbb/task.h>
+#include <tbb/task_scheduler_init.h>
+#include <unistd.h>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iomanip>
+#include <sstream>
+#include <thread>
+
+#include <eventBuilding/SourceIDManager.h>
+#include <l0/MEP.h>
+#include <l0/MEPFragment.h>
+#include <LKr/LkrFragment.h>
+#include <options/Logging.h>
+#include <options/Options.h>
+#include <structs/L0TPHeader.h>
+#include <structs/Network.h>
+#include <utils/Utils.h>
+
+#include "../eventBuilding/L1Builder.h"
+#include "../eventBuilding/StorageHandler.h"
+#include "../eventBuilding/TriggerTask.h"
+#include "../options/MyOptions.h"
+#include "../socket/HandleFrameTask.h"
+#include "MergerSink.h"
+
+namespace na62 {
+
+uint ThroughputBenchmark::numberOfEvents_;
+uint ThroughputBenchmark::eventsPerChunk_;
+uint ThroughputBenchmark::eventsPerMEP_;
+uint ThroughputBenchmark::l0FragmentPayloadSize_;
+uint ThroughputBenchmark::lkrFragmentPayloadSize_;
+
+uint32_t ThroughputBenchmark::myIP_;
+uint16_t ThroughputBenchmark::l0Port_;
+uint16_t ThroughputBenchmark::creamPort_;
+
+std::vector<std::pair<uint8_t, uint8_t> > ThroughputBenchmark::creams_;
+
+static uint64_t nowNanos() {
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(
+			std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+bool ThroughputBenchmark::IsEnabled() {
+	return Options::GetBool(OPTION_BENCHMARK);
+}
+
+void ThroughputBenchmark::run() {
+	numberOfEvents_ = std::min(Options::GetInt(OPTION_BENCHMARK_EVENTS),
+			Options::GetInt(OPTION_MAX_NUMBER_OF_EVENTS_PER_BURST));
+	eventsPerMEP_ = std::max(1, Options::GetInt(OPTION_BENCHMARK_EVENTS_PER_MEP));
+	eventsPerChunk_ = eventsPerMEP_ * 128;
+	/*
+	 * Payloads are 32-bit aligned and large enough to carry a L0TP header
+	 */
+	l0FragmentPayloadSize_ = std::max((uint) sizeof(L0TpHeader),
+			((uint) Options::GetInt(OPTION_BENCHMARK_L0_FRAGMENT_SIZE) + 3) & ~3u);
+	lkrFragmentPayloadSize_ = (Options::GetInt(
+			OPTION_BENCHMARK_LKR_FRAGMENT_SIZE) + 3) & ~3u;
+
+	/*
+	 * The lengths in the MEP, fragment and UDP headers are 16 bit and the event count 8 bit
+	 */
+	const uint maxFrameLength = sizeof(UDP_HDR) + sizeof(l0::MEP_HDR)
+			+ eventsPerMEP_
+					* (sizeof(l0::MEPFragment_HDR) + l0FragmentPayloadSize_);
+	if (eventsPerMEP_ > 0xFF || maxFrameLength > 0xFFFF
+			|| sizeof(UDP_HDR) + sizeof(cream::LKR_EVENT_RAW_HDR)
+					+ lkrFragmentPayloadSize_ > 0xFFFF) {
+		LOG_ERROR<< "The benchmark MEPs or CREAM frames do not fit into a UDP frame: Reduce "
+		<< OPTION_BENCHMARK_EVENTS_PER_MEP << " (max 255), "
+		<< OPTION_BENCHMARK_L0_FRAGMENT_SIZE << " or " << OPTION_BENCHMARK_LKR_FRAGMENT_SIZE << ENDL;
+		exit(1);
+	}
+
+	myIP_ = GetMyIP();
+	l0Port_ = Options::GetInt(OPTION_L0_RECEIVER_PORT);
+	creamPort_ = Options::GetInt(OPTION_CREAM_RECEIVER_PORT);
+
+	if (SourceIDManager::NUMBER_OF_EXPECTED_CREAM_PACKETS_PER_EVENT != 0) {
+		std::vector<std::pair<int, int> > inactiveCreams =
+				Options::GetIntPairList(OPTION_INACTIVE_CREAM_CRATES);
+		for (auto cream : Options::GetIntPairList(OPTION_CREAM_CRATES)) {
+			if (std::find(inactiveCreams.begin(), inactiveCreams.end(), cream)
+					== inactiveCreams.end()) {
+				creams_.push_back(
+						std::make_pair((uint8_t) cream.first,
+								(uint8_t) cream.second));
+			}
+		}
+	}
+
+	/*
+	 * Redirect the StorageHandler to the local sink
+	 */
+	MergerSink sink(Options::GetInt(OPTION_MERGER_PORT), numberOfEvents_);
+	sink.startThread("MergerSink");
+	StorageHandler::setMergers("127.0.0.1");
+
+	uint maxThreads = Options::GetInt(OPTION_BENCHMARK_MAX_THREADS);
+	if (maxThreads == 0) {
+		maxThreads = std::thread::hardware_concurrency();
+	}
+
+	LOG_INFO<< "Starting throughput benchmark with " << numberOfEvents_
+	<< " events per run, " << SourceIDManager::NUMBER_OF_L0_DATA_SOURCES << " L0 sources and "
+	<< creams_.size() << " CREAMs" << ENDL;
+
+	std::vector<Result> results;
+	uint32_t burstID = Options::GetInt(OPTION_FIRST_BURST_ID);
+	for (uint threads = 1; threads <= maxThreads; threads++) {
+		tbb::task_scheduler_init scheduler(threads);
+		for (bool runToCompletion : { false, true }) {
+			TriggerTask::setEnabled(runToCompletion);
+			results.push_back(
+					runWithThreads(threads, runToCompletion, sink, burstID++));
+			printResult(results.back());
+		}
+	}
+	TriggerTask::setEnabled(false);
+
+	LOG_INFO<< "######################## Benchmark results ########################" << ENDL;
+	for (const Result& result : results) {
+		printResult(result);
+	}
+
+	sink.stopRunning();
+	sink.join();
+}
+
+ThroughputBenchmark::Result ThroughputBenchmark::runWithThreads(uint threads,
+		bool runToCompletion, MergerSink& sink, uint32_t burstID) {
+	Result result;
+	result.threads = threads;
+	result.runToCompletion = runToCompletion;
+	result.eventsGenerated = numberOfEvents_;
+	result.bytesGenerated = 0;
+
+	/*
+	 * All frames are generated before the clock starts so that only the event building is
+	 * measured. The CREAM data of a chunk is sent together with the L0 data of the following
+	 * chunk as it is only accepted after L1 has been processed
+	 */
+	std::vector<std::vector<std::vector<DataContainer> > > chunks;
+	for (uint firstEvent = 0; firstEvent < numberOfEvents_ + eventsPerChunk_;
+			firstEvent += eventsPerChunk_) {
+		chunks.emplace_back();
+		std::vector<std::vector<DataContainer> >& batches = chunks.back();
+
+		if (firstEvent < numberOfEvents_) {
+			const uint lastEvent = std::min(firstEvent + eventsPerChunk_,
+					numberOfEvents_);
+
+			/*
+			 * One task per source and subsource like the PacketHandlers would aggregate them
+			 */
+			for (uint sourceNum = 0;
+					sourceNum != SourceIDManager::NUMBER_OF_L0_DATA_SOURCES;
+					sourceNum++) {
+				const uint8_t sourceID = SourceIDManager::SourceNumToID(
+						sourceNum);
+				for (uint subID = 0;
+						subID
+								!= SourceIDManager::getExpectedPacksBySourceID(
+										sourceID); subID++) {
+					std::vector<DataContainer> frames;
+					for (uint event = firstEvent; event < lastEvent; event +=
+							eventsPerMEP_) {
+						frames.push_back(
+								generateMEP(sourceID, subID, event,
+										std::min(eventsPerMEP_,
+												lastEvent - event)));
+						result.bytesGenerated += frames.back().length;
+					}
+					batches.push_back(std::move(frames));
+				}
+			}
+		}
+
+		if (firstEvent != 0 && !creams_.empty()) {
+			const uint lastEvent = std::min(firstEvent, numberOfEvents_);
+			for (auto& cream : creams_) {
+				std::vector<DataContainer> frames;
+				for (uint event = firstEvent - eventsPerChunk_;
+						event != lastEvent; event++) {
+					frames.push_back(
+							generateCreamFrame(cream.first, cream.second,
+									event));
+					result.bytesGenerated += frames.back().length;
+				}
+				batches.push_back(std::move(frames));
+			}
+		}
+	}
+
+	sink.startRun();
+	const uint64_t start = nowNanos();
+
+	for (uint chunk = 0; chunk != chunks.size(); chunk++) {
+		std::vector<std::vector<DataContainer> >& batches = chunks[chunk];
+
+		/*
+		 * The latency of an event is measured from the injection of its L0 data
+		 */
+		const uint firstEvent = chunk * eventsPerChunk_;
+		const uint64_t now = nowNanos();
+		for (uint event = firstEvent;
+				event < std::min(firstEvent + eventsPerChunk_, numberOfEvents_);
+				event++) {
+			sink.setGenerationTime(event, now);
+		}
+
+		if (runToCompletion) {
+			processInline(batches, threads, burstID);
+
+			/*
+			 * The CREAM data of this chunk must not arrive before L1 has been processed
+			 */
+			while (TriggerTask::getNumberOfQueuedTasks() != 0) {
+				std::this_thread::yield();
+			}
+		} else {
+			tbb::task_list tasks;
+			for (auto& frames : batches) {
+				tasks.push_back(
+						*new (tbb::task::allocate_root()) HandleFrameTask(
+								std::move(frames), burstID));
+			}
+			tbb::task::spawn_root_and_wait(tasks);
+		}
+	}
+
+	/*
+	 * Wait until the sink did not receive anything for 1 s
+	 */
+	uint64_t lastEventsReceived = sink.getEventsReceived();
+	uint64_t lastChange = nowNanos();
+	while (nowNanos() - lastChange < 1000000000ull
+			&& sink.getEventsReceived() < numberOfEvents_) {
+		usleep(10000);
+		if (sink.getEventsReceived() != lastEventsReceived) {
+			lastEventsReceived = sink.getEventsReceived();
+			lastChange = nowNanos();
+		}
+	}
+
+	const uint64_t end =
+			sink.getEventsReceived() != 0 ?
+					sink.getLastReceiveTime() : nowNanos();
+
+	result.eventsReceived = sink.getEventsReceived();
+	result.bytesReceived = sink.getBytesReceived();
+	result.brokenEvents = sink.getBrokenEvents();
+	result.seconds = (end - start) / 1E9;
+
+	std::vector<uint64_t> latencies = sink.getLatencies();
+	std::sort(latencies.begin(), latencies.end());
+	if (latencies.empty()) {
+		latencies.push_back(0);
+	}
+	result.p50Nanos = latencies[latencies.size() * 50 / 100];
+	result.p99Nanos = latencies[latencies.size() * 99 / 100];
+	result.p999Nanos = latencies[latencies.size() * 999 / 1000];
+
+	return result;
+}
+
+void ThroughputBenchmark::processInline(
+		std::vector<std::vector<DataContainer> >& batches, uint threads,
+		uint32_t burstID) {
+	std::vector<std::thread> receivers;
+	for (uint receiver = 0; receiver != threads; receiver++) {
+		receivers.push_back(std::thread([&batches, threads, receiver, burstID]() {
+			for (uint batch = receiver; batch < batches.size(); batch += threads) {
+				for (DataContainer& frame : batches[batch]) {
+					HandleFrameTask::processFrame(std::move(frame), burstID);
+					L1Builder::flushL1BatchIfExpired();
+				}
+			}
+			L1Builder::flushL1Batch();
+		}));
+	}
+	for (std::thread& receiver : receivers) {
+		receiver.join();
+	}
+}
+
+void ThroughputBenchmark::printResult(const Result& result) {
+	std::stringstream line;
+	line << std::fixed << std::setprecision(0) << "Threads: " << result.threads
+			<< "\tmode: "
+			<< (result.runToCompletion ? "run-to-completion" : "tasks")
+			<< "\tbuilt events/s: " << result.eventsReceived / result.seconds
+			<< " (" << result.eventsReceived << "/" << result.eventsGenerated
+			<< " events)" << "\tinput: " << Utils::FormatSize(
+					result.bytesGenerated / result.seconds) << "/s"
+			<< "\toutput: "
+			<< Utils::FormatSize(result.bytesReceived / result.seconds)
+			<< "/s" << "\tbroken: " << result.brokenEvents
+			<< "\tlatency p50/p99/p999 [us]: " << result.p50Nanos / 1000 << "/"
+			<< result.p99Nanos / 1000 << "/" << result.p999Nanos / 1000;
+	LOG_INFO<< line.str() << ENDL;
+}
+
+void ThroughputBenchmark::writeUDPHeader(char* frame,
+		const uint16_t payloadLength, const uint32_t srcIP,
+		const uint16_t dstPort) {
+	UDP_HDR* hdr = (UDP_HDR*) frame;
+	memset(hdr, 0, sizeof(UDP_HDR));
+
+	hdr->eth.ether_type = htons(ETHERTYPE_IP);
+
+	hdr->ip.version = 4;
+	hdr->ip.ihl = 5;
+	hdr->ip.tot_len = htons(
+			sizeof(iphdr) + sizeof(udphdr) + payloadLength);
+	hdr->ip.ttl = 64;
+	hdr->ip.protocol = IPPROTO_UDP;
+	hdr->ip.saddr = srcIP;
+	hdr->ip.daddr = myIP_;
+
+	hdr->udp.source = htons(dstPort);
+	hdr->udp.dest = htons(dstPort);
+	hdr->udp.len = htons(sizeof(udphdr) + payloadLength);
+}
+
+DataContainer ThroughputBenchmark::generateMEP(const uint8_t sourceID,
+		const uint8_t sourceSubID, const uint32_t firstEventNum,
+		const uint numberOfEvents) {
+	const uint fragmentLength = sizeof(l0::MEPFragment_HDR)
+			+ l0FragmentPayloadSize_;
+	const uint16_t mepLength = sizeof(l0::MEP_HDR)
+			+ numberOfEvents * fragmentLength;
+	const uint16_t frameLength = sizeof(UDP_HDR) + mepLength;
+
+	char* frame = new char[frameLength];
+	writeUDPHeader(frame, mepLength, htonl(0x0A000000 | sourceID), l0Port_);
+
+	l0::MEP_HDR* mep = (l0::MEP_HDR*) (frame + sizeof(UDP_HDR));
+	mep->firstEventNum = firstEventNum;
+	mep->sourceID = sourceID;
+	mep->mepLength = mepLength;
+	mep->eventCount = numberOfEvents;
+	mep->sourceSubID = sourceSubID;
+
+	char* fragment = frame + sizeof(UDP_HDR) + sizeof(l0::MEP_HDR);
+	for (uint i = 0; i != numberOfEvents; i++) {
+		l0::MEPFragment_HDR* fragmentHdr = (l0::MEPFragment_HDR*) fragment;
+		fragmentHdr->eventLength_ = fragmentLength;
+		fragmentHdr->eventNumberLSB_ = (firstEventNum + i) & 0xFF;
+		fragmentHdr->reserved_ = 0;
+		fragmentHdr->lastEventOfBurst_ = 0;
+		fragmentHdr->timestamp_ = firstEventNum + i;
+
+		char* payload = fragment + sizeof(l0::MEPFragment_HDR);
+		memset(payload, sourceID, l0FragmentPayloadSize_);
+
+		/*
+		 * Every event is a L0 trigger of type 1 if this is the L0TP
+		 */
+		L0TpHeader* l0tp = (L0TpHeader*) payload;
+		l0tp->refFineTime = 0;
+		l0tp->l0TriggerType = 1;
+
+		fragment += fragmentLength;
+	}
+
+	return {frame, frameLength, true};
+}
+
+DataContainer ThroughputBenchmark::generateCreamFrame(const uint8_t crateID,
+		const uint8_t creamID, const uint32_t eventNum) {
+	const uint16_t eventLength = sizeof(cream::LKR_EVENT_RAW_HDR)
+			+ lkrFragmentPayloadSize_;
+	const uint16_t frameLength = sizeof(UDP_HDR) + eventLength;
+
+	char* frame = new char[frameLength];
+	writeUDPHeader(frame, eventLength,
+			htonl(0x0A010000 | crateID << 8 | creamID), creamPort_);
+
+	cream::LKR_EVENT_RAW_HDR* hdr = (cream::LKR_EVENT_RAW_HDR*) (frame
+			+ sizeof(UDP_HDR));
+	memset(hdr, 0, eventLength);
+	hdr->eventNumber = eventNum;
+	hdr->crateID = crateID;
+	hdr->creamID = creamID;
+	hdr->eventLength = eventLength / 4; // 32-bit words
+	hdr->timestamp = eventNum;
+
+	return {frame, frameLength, true};
+}
+
+} /* namespace na62 */
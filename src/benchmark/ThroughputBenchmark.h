@@ -0,0 +1,114 @@
+/*
+ * ThroughputBenchmark.h
+ *
+ *  Created on: Oct 16, 2026
+ *      Author: Jonas Kunze (kunze.jonas@gmail.com)
+ */
+
+#pragma once
+#ifndef THROUGHPUTBENCHMARK_H_
+#define THROUGHPUTBENCHMARK_H_
+
+#include <sys/types.h>
+#include <netinet/in.h>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include <socket/EthernetUtils.h>
+
+namespace na62 {
+
+class MergerSink;
+
+/*
+ * Drives the real event building chain HandleFrameTask -> L1Builder -> L2Builder ->
+ * StorageHandler with synthetic TEL62 MEPs and CREAM fragments for the configured
+ * L0DataSourceIDs and CREAMCrates. The built events are sent to a local MergerSink.
+ *
+ * The benchmark is repeated with 1 to benchmarkMaxThreads TBB threads and reports
+ * the sustained event and data rates and the build latency percentiles of every run.
+ * Every thread number is run twice: With HandleFrameTasks and in run-to-completion mode
+ * where the same number of receiver threads process the frames directly.
+ *
+ * The benchmark is a runtime option of the farm binary and not a separate executable on
+ * purpose: It measures exactly the code and compiler flags deployed on the farm nodes and is
+ * configured via the same config files. With the option set no NIC is opened, so nothing
+ * may use the NetworkHandler (no RX queues, no MRPs, see GetMyIP()).
+ */
+class ThroughputBenchmark {
+public:
+	static bool IsEnabled();
+
+	/**
+	 * @return The IP in network byte order the synthetic frames are sent to
+	 */
+	static inline uint32_t GetMyIP() {
+		return htonl(INADDR_LOOPBACK);
+	}
+
+	/**
+	 * Runs the benchmark with all thread numbers and prints the results
+	 */
+	static void run();
+
+private:
+	struct Result {
+		uint threads;
+		bool runToCompletion;
+		uint64_t eventsGenerated;
+		uint64_t eventsReceived;
+		uint64_t brokenEvents;
+		uint64_t bytesGenerated;
+		uint64_t bytesReceived;
+		double seconds;
+		uint64_t p50Nanos;
+		uint64_t p99Nanos;
+		uint64_t p999Nanos;
+	};
+
+	static uint numberOfEvents_;
+	static uint eventsPerChunk_;
+	static uint eventsPerMEP_;
+	static uint l0FragmentPayloadSize_;
+	static uint lkrFragmentPayloadSize_;
+
+	static uint32_t myIP_;
+	static uint16_t l0Port_;
+	static uint16_t creamPort_;
+
+	/*
+	 * All active (crateID, creamID) pairs
+	 */
+	static std::vector<std::pair<uint8_t, uint8_t> > creams_;
+
+	static Result runWithThreads(uint threads, bool runToCompletion,
+			MergerSink& sink, uint32_t burstID);
+
+	/**
+	 * Processes the batches like the PacketHandlers in run-to-completion mode would do it:
+	 * Every receiver thread handles the frames of every threads-th batch
+	 */
+	static void processInline(
+			std::vector<std::vector<DataContainer> >& batches, uint threads,
+			uint32_t burstID);
+
+	static void printResult(const Result& result);
+
+	static void writeUDPHeader(char* frame, const uint16_t payloadLength,
+			const uint32_t srcIP, const uint16_t dstPort);
+
+	/**
+	 * Generates a MEP frame with numberOfEvents fragments starting at firstEventNum
+	 */
+	static DataContainer generateMEP(const uint8_t sourceID,
+			const uint8_t sourceSubID, const uint32_t firstEventNum,
+			const uint numberOfEvents);
+
+	static DataContainer generateCreamFrame(const uint8_t crateID,
+			const uint8_t creamID, const uint32_t eventNum);
+};
+
+} /* namespace na62 */
+
+#endif /* THROUGHPUTBENCHMARK_H_ */
@@ -0,0 +1,187 @@
+/*
+ * EventAgingService.cpp
+ *
+ *  Created on: Oct 16, 2026
+ *      Author: Jonas Kunze (kunze.jonas@gmail.com)
+ */
+
+#include "EventAgingService.h"
+
+#include <eventBuilding/Event.h>
+#include <eventBuilding/EventPool.h>
+#include <eventBuilding/SourceIDManager.h>
+#include <l0/MEPFragment.h>
+#include <l0/Subevent.h>
+#include <options/Logging.h>
+#include <unistd.h>
+#include <algorithm>
+#include <chrono>
+
+#include "../options/MyOptions.h"
+
+namespace na62 {
+
+bool EventAgingService::enabled_ = false;
+uint64_t EventAgingService::timeoutMillis_ = 0;
+
+EventAgingService::EventEntry* EventAgingService::entries_ = nullptr;
+uint EventAgingService::entryMask_ = 0;
+EventAgingService::Stripe EventAgingService::stripes_[NUMBER_OF_STRIPES];
+
+tbb::concurrent_queue<EventAgingService::QueuedEvent> EventAgingService::agingQueue_;
+
+std::atomic<uint64_t> EventAgingService::eventsDropped_(0);
+std::atomic<uint64_t> EventAgingService::tableCollisions_(0);
+std::atomic<uint64_t> EventAgingService::lateFragments_(0);
+std::atomic<uint64_t> EventAgingService::eventsInFlight_(0);
+std::atomic<uint64_t> EventAgingService::missingEventsBySourceNum_[0x100];
+
+static inline uint64_t nowMillis() {
+	return std::chrono::duration_cast<std::chrono::milliseconds>(
+			std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static inline uint64_t makeTag(const uint32_t eventNumber,
+		const uint32_t burstID) {
+	return (uint64_t) burstID << 32 | eventNumber;
+}
+
+EventAgingService::EventAgingService() :
+		running_(true) {
+}
+
+void EventAgingService::initialize() {
+	timeoutMillis_ = Options::GetInt(OPTION_EVENT_AGING_TIMEOUT);
+	enabled_ = timeoutMillis_ != 0;
+	if (!enabled_) {
+		return;
+	}
+
+	/*
+	 * Entries sharing a stripe must share the lower bits of the event number
+	 */
+	uint tableSize = NUMBER_OF_STRIPES;
+	while (tableSize < (uint) Options::GetInt(OPTION_EVENT_AGING_TABLE_SIZE)) {
+		tableSize <<= 1;
+	}
+	entryMask_ = tableSize - 1;
+	entries_ = new EventEntry[tableSize];
+	for (uint i = 0; i != tableSize; i++) {
+		entries_[i].tag = ~0ull;
+		entries_[i].state = COMPLETE;
+	}
+	for (uint sourceNum = 0; sourceNum != 0x100; sourceNum++) {
+		missingEventsBySourceNum_[sourceNum] = 0;
+	}
+
+	LOG_INFO<< "Incomplete L0 events are dropped after " << timeoutMillis_ << " ms" << ENDL;
+
+	EventAgingService* service = new EventAgingService();
+	service->startThread("EventAgingService");
+}
+
+bool EventAgingService::addL0Fragment(Event* event, l0::MEPFragment* fragment,
+		const uint32_t burstID) {
+	const uint32_t eventNumber = fragment->getEventNumber();
+	const uint64_t tag = makeTag(eventNumber, burstID);
+
+	tbb::spin_mutex::scoped_lock my_lock(
+			stripes_[eventNumber % NUMBER_OF_STRIPES].mutex);
+	EventEntry& entry = entries_[eventNumber & entryMask_];
+
+	if (entry.tag != tag) {
+		/*
+		 * Entries of previous bursts with the same event number belong to the same Event
+		 * object which is reset by addL0Event -> only other event numbers collide
+		 */
+		if (entry.state == IN_FLIGHT && (uint32_t) entry.tag != eventNumber) {
+			tableCollisions_.fetch_add(1, std::memory_order_relaxed);
+			return event->addL0Event(fragment, burstID);
+		}
+
+		/*
+		 * First fragment of this event
+		 */
+		entry.tag = tag;
+		entry.state = IN_FLIGHT;
+		agingQueue_.push( { eventNumber, burstID, nowMillis() });
+		eventsInFlight_.fetch_add(1, std::memory_order_relaxed);
+	} else if (entry.state == AGED) {
+		lateFragments_.fetch_add(1, std::memory_order_relaxed);
+		delete fragment;
+		return false;
+	}
+
+	if (event->addL0Event(fragment, burstID)) {
+		entry.state = COMPLETE;
+		return true;
+	}
+	return false;
+}
+
+void EventAgingService::ageEvent(const QueuedEvent& queuedEvent) {
+	tbb::spin_mutex::scoped_lock my_lock(
+			stripes_[queuedEvent.eventNumber % NUMBER_OF_STRIPES].mutex);
+	EventEntry& entry = entries_[queuedEvent.eventNumber & entryMask_];
+
+	/*
+	 * Completed in time or the entry has been taken by another event
+	 */
+	if (entry.tag != makeTag(queuedEvent.eventNumber, queuedEvent.burstID)
+			|| entry.state != IN_FLIGHT) {
+		return;
+	}
+
+	Event* event = EventPool::GetEvent(queuedEvent.eventNumber);
+	if (event == nullptr || event->getBurstID() != queuedEvent.burstID) {
+		return;
+	}
+	entry.state = AGED;
+
+	for (uint sourceNum = 0;
+			sourceNum != SourceIDManager::NUMBER_OF_L0_DATA_SOURCES;
+			sourceNum++) {
+		l0::Subevent* subevent = event->getL0SubeventBySourceIDNum(sourceNum);
+		if (subevent->getNumberOfFragments()
+				< subevent->getNumberOfExpectedFragments()) {
+			missingEventsBySourceNum_[sourceNum].fetch_add(1,
+					std::memory_order_relaxed);
+		}
+	}
+
+	eventsDropped_.fetch_add(1, std::memory_order_relaxed);
+	EventPool::FreeEvent(event);
+}
+
+void EventAgingService::onInterruption() {
+	running_ = false;
+}
+
+void EventAgingService::thread() {
+	QueuedEvent oldest;
+	bool haveOldest = false;
+	while (running_) {
+		if (!haveOldest) {
+			haveOldest = agingQueue_.try_pop(oldest);
+			if (!haveOldest) {
+				usleep(std::min<uint64_t>(timeoutMillis_, 10) * 1000);
+				continue;
+			}
+			eventsInFlight_.fetch_sub(1, std::memory_order_relaxed);
+		}
+
+		/*
+		 * The queue is ordered by the first fragment -> wait until the oldest event expires
+		 */
+		const uint64_t age = nowMillis() - oldest.firstFragmentMillis;
+		if (age < timeoutMillis_) {
+			usleep(std::min<uint64_t>(timeoutMillis_ - age, 10) * 1000);
+			continue;
+		}
+
+		ageEvent(oldest);
+		haveOldest = false;
+	}
+}
+
+} /* namespace na62 */
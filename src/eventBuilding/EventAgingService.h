@@ -0,0 +1,143 @@
+/*
+ * EventAgingService.h
+ *
+ *  Created on: Oct 16, 2026
+ *      Author: Jonas Kunze (kunze.jonas@gmail.com)
+ */
+
+#pragma once
+#ifndef EVENTAGINGSERVICE_H_
+#define EVENTAGINGSERVICE_H_
+
+#include <sys/types.h>
+#include <tbb/concurrent_queue.h>
+#include <tbb/spin_mutex.h>
+#include <utils/AExecutable.h>
+#include <atomic>
+#include <cstdint>
+
+namespace na62 {
+class Event;
+namespace l0 {
+class MEPFragment;
+} /* namespace l0 */
+
+/*
+ * Ages out L0 events that are still incomplete eventAgingTimeout milliseconds after their
+ * first fragment. Without it an event missing a single fragment keeps the frames of all its
+ * other fragments until the end of the burst.
+ *
+ * Every event is appended to a FIFO when its first fragment arrives. The aging thread only
+ * looks at the head of the FIFO, so every event is checked once as soon as it is old enough.
+ * Aged events are dropped and the sources that were missing are counted. They are never
+ * processed by L1 as neither the trigger algorithms nor the serialization handle missing
+ * fragments. Fragments arriving after an event has been aged are dropped.
+ *
+ * The state of every event is kept in a table indexed by the event number. Fragments are
+ * added to the event under one of NUMBER_OF_STRIPES locks selected by the event number so
+ * that the aging thread never works on an event that is just being completed. An event whose
+ * entry is used by another event in flight cannot be aged and is counted as a collision.
+ */
+class EventAgingService: public AExecutable {
+public:
+	static void initialize();
+
+	static inline bool IsEnabled() {
+		return enabled_;
+	}
+
+	/**
+	 * Adds the fragment to the event like Event::addL0Event while tracking the age of the
+	 * event
+	 *
+	 * @return true if the event is complete
+	 */
+	static bool addL0Fragment(Event* event, l0::MEPFragment* fragment,
+			const uint32_t burstID);
+
+	static uint64_t GetEventsDropped() {
+		return eventsDropped_;
+	}
+
+	/*
+	 * Number of fragments of events that could not be tracked because their table entry was
+	 * used by another event in flight
+	 */
+	static uint64_t GetTableCollisions() {
+		return tableCollisions_;
+	}
+
+	static uint64_t GetLateFragments() {
+		return lateFragments_;
+	}
+
+	/*
+	 * Number of aged events that missed at least one fragment of the source
+	 */
+	static uint64_t GetMissingEventsBySourceNum(const uint8_t sourceNum) {
+		return missingEventsBySourceNum_[sourceNum];
+	}
+
+	/*
+	 * Number of events that have not yet been checked by the aging thread
+	 */
+	static uint64_t GetEventsInFlight() {
+		return eventsInFlight_;
+	}
+
+private:
+	static const uint NUMBER_OF_STRIPES = 1024;
+
+	enum EventState {
+		IN_FLIGHT, COMPLETE, AGED
+	};
+
+	struct EventEntry {
+		/*
+		 * burstID << 32 | eventNumber of the event using this entry
+		 */
+		uint64_t tag;
+		EventState state;
+	};
+
+	struct QueuedEvent {
+		uint32_t eventNumber;
+		uint32_t burstID;
+		uint64_t firstFragmentMillis;
+	};
+
+	struct alignas(64) Stripe {
+		tbb::spin_mutex mutex;
+	};
+
+	static bool enabled_;
+	static uint64_t timeoutMillis_;
+
+	static EventEntry* entries_;
+	static uint entryMask_;
+	static Stripe stripes_[NUMBER_OF_STRIPES];
+
+	static tbb::concurrent_queue<QueuedEvent> agingQueue_;
+
+	static std::atomic<uint64_t> eventsDropped_;
+	static std::atomic<uint64_t> tableCollisions_;
+	static std::atomic<uint64_t> lateFragments_;
+	static std::atomic<uint64_t> eventsInFlight_;
+	static std::atomic<uint64_t> missingEventsBySourceNum_[0x100];
+
+	bool running_;
+
+	EventAgingService();
+
+	void thread();
+	void onInterruption();
+
+	/**
+	 * Drops the event if it is still incomplete
+	 */
+	static void ageEvent(const QueuedEvent& queuedEvent);
+};
+
+} /* namespace na62 */
+
+#endif /* EVENTAGINGSERVICE_H_ */
@@ -0,0 +1,131 @@
+/*
+ * EventBatcher.cpp
+ *
+ *  Created on: Oct 16, 2026
+ *      Author: Jonas Kunze (kunze.jonas@gmail.com)
+ */
+
+#include "EventBatcher.h"
+
+#include <chrono>
+#include <cstring>
+
+#include "OutputBufferPool.h"
+
+namespace na62 {
+
+static uint64_t nowNanos() {
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(
+			std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+EventBatcher::EventBatcher(uint maxBatchBytes) :
+		bufferSize_(sizeof(EVENT_BATCH_HDR) + maxBatchBytes + 4), maxCopyBytes_(
+				maxBatchBytes / 4), buffer_(nullptr), bufferLength_(0), numberOfEvents_(
+				0), burstID_(0), batchBytes_(0), firstEventNanos_(0) {
+}
+
+EventBatcher::~EventBatcher() {
+}
+
+uint64_t EventBatcher::getAgeMicros() const {
+	return (nowNanos() - firstEventNanos_) / 1000;
+}
+
+uint EventBatcher::appendToBuffer(const uint length) {
+	/*
+	 * Consecutive buffer ranges are sent as one part
+	 */
+	if (!segments_.empty() && segments_.back().inBuffer) {
+		segments_.back().part.length += length;
+	} else {
+		segments_.push_back( { { nullptr, length, nullptr, nullptr }, true,
+				bufferLength_ });
+	}
+
+	const uint offset = bufferLength_;
+	bufferLength_ += length;
+	return offset;
+}
+
+void EventBatcher::addEvent(OutgoingEvent* event) {
+	if (buffer_ == nullptr) {
+		buffer_ = new BatchBuffer();
+		buffer_->data = OutputBufferPool::getInternalBuffer(
+				OutputBufferPool::EVENT_BATCHES, bufferSize_, buffer_->poolHint);
+		buffer_->references = 0;
+		bufferLength_ = 0;
+		appendToBuffer(sizeof(EVENT_BATCH_HDR));
+		batchBytes_ = sizeof(EVENT_BATCH_HDR);
+		burstID_ = event->burstID;
+		firstEventNanos_ = nowNanos();
+	}
+
+	uint32_t eventLength = 0;
+	for (const OutgoingPart& part : event->parts) {
+		eventLength += part.length;
+	}
+
+	/*
+	 * The batch is flushed as soon as it reaches its maximum size -> the length always fits
+	 */
+	memcpy(buffer_->data + appendToBuffer(sizeof(eventLength)), &eventLength,
+			sizeof(eventLength));
+
+	for (const OutgoingPart& part : event->parts) {
+		if (part.length <= maxCopyBytes_
+				&& bufferLength_ + part.length <= bufferSize_) {
+			memcpy(buffer_->data + appendToBuffer(part.length), part.data,
+					part.length);
+			part.freeFn(part.data, part.hint);
+		} else {
+			segments_.push_back( { part, false, 0 });
+		}
+	}
+
+	batchBytes_ += sizeof(eventLength) + eventLength;
+	numberOfEvents_++;
+	delete event;
+}
+
+OutgoingEvent* EventBatcher::finishBatch() {
+	EVENT_BATCH_HDR* hdr = (EVENT_BATCH_HDR*) buffer_->data;
+	hdr->magic = EVENT_BATCH_MAGIC;
+	hdr->numberOfEvents = numberOfEvents_;
+	hdr->burstID = burstID_;
+	hdr->length = batchBytes_;
+
+	OutgoingEvent* batch = new OutgoingEvent();
+	batch->burstID = burstID_;
+	batch->eventNumber = 0;
+	batch->parts.reserve(segments_.size());
+
+	uint bufferSegments = 0;
+	for (const BatchSegment& segment : segments_) {
+		if (segment.inBuffer) {
+			batch->parts.push_back( { buffer_->data + segment.bufferOffset,
+					segment.part.length, (zmq::free_fn*) releaseBatchBuffer,
+					buffer_ });
+			bufferSegments++;
+		} else {
+			batch->parts.push_back(segment.part);
+		}
+	}
+	buffer_->references = bufferSegments;
+
+	buffer_ = nullptr;
+	segments_.clear();
+	numberOfEvents_ = 0;
+	batchBytes_ = 0;
+	return batch;
+}
+
+void EventBatcher::releaseBatchBuffer(void*, void* hint) {
+	BatchBuffer* buffer = (BatchBuffer*) hint;
+	if (buffer->references.fetch_sub(1) == 1) {
+		OutputBufferPool::freeBuffer(buffer->data, buffer->poolHint);
+		delete buffer;
+	}
+}
+
+} /* namespace na62 */
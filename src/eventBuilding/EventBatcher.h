@@ -0,0 +1,123 @@
+/*
+ * EventBatcher.h
+ *
+ *  Created on: Oct 16, 2026
+ *      Author: Jonas Kunze (kunze.jonas@gmail.com)
+ */
+
+#pragma once
+#ifndef EVENTBATCHER_H_
+#define EVENTBATCHER_H_
+
+#include <sys/types.h>
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+#include "MergerSender.h"
+
+/*
+ * The upper byte differs from the format byte of EVENT_HDR so that batches and single events
+ * can be distinguished by their first word
+ */
+#define EVENT_BATCH_MAGIC 0xBA7C4E62
+
+namespace na62 {
+
+/*
+ * Header of a message containing several events of the same burst. It is followed by
+ * numberOfEvents records of a 32 bit event length in bytes and the event starting with its
+ * EVENT_HDR
+ */
+struct EVENT_BATCH_HDR {
+	uint32_t magic;
+	uint32_t numberOfEvents;
+	uint32_t burstID;
+	uint32_t length; // bytes including this header
+}__attribute__ ((__packed__));
+
+/*
+ * Packs serialized events of one burst into one multipart message with the layout described
+ * by EVENT_BATCH_HDR.
+ *
+ * Small parts are copied into a pooled batch buffer, large parts are referenced as separate
+ * zero copy parts. Every sender thread owns its own batcher.
+ */
+class EventBatcher {
+public:
+	EventBatcher(uint maxBatchBytes);
+	virtual ~EventBatcher();
+
+	bool isEmpty() const {
+		return numberOfEvents_ == 0;
+	}
+
+	uint getNumberOfEvents() const {
+		return numberOfEvents_;
+	}
+
+	uint getBurstID() const {
+		return burstID_;
+	}
+
+	/*
+	 * Number of bytes of the batch including all headers
+	 */
+	uint getBatchBytes() const {
+		return batchBytes_;
+	}
+
+	/**
+	 * @return Microseconds since the first event of the batch has been added
+	 */
+	uint64_t getAgeMicros() const;
+
+	/**
+	 * Adds the event to the batch and deletes it
+	 */
+	void addEvent(OutgoingEvent* event);
+
+	/**
+	 * @return The batch as one event to be sent. The batcher is empty afterwards
+	 */
+	OutgoingEvent* finishBatch();
+
+private:
+	/*
+	 * Keeps the batch buffer alive until ZMQ has released all parts pointing into it
+	 */
+	struct BatchBuffer {
+		char* data;
+		void* poolHint;
+		std::atomic<uint> references;
+	};
+
+	struct BatchSegment {
+		OutgoingPart part;
+		bool inBuffer;
+		uint bufferOffset;
+	};
+
+	const uint bufferSize_;
+	const uint maxCopyBytes_;
+
+	BatchBuffer* buffer_;
+	uint bufferLength_;
+	std::vector<BatchSegment> segments_;
+
+	uint numberOfEvents_;
+	uint burstID_;
+	uint batchBytes_;
+	uint64_t firstEventNanos_;
+
+	/**
+	 * @return The offset of length new bytes in the batch buffer
+	 */
+	uint appendToBuffer(const uint length);
+
+	static void releaseBatchBuffer(void* data, void* hint);
+};
+
+} /* namespace na62 */
+
+#endif /* EVENTBATCHER_H_ */
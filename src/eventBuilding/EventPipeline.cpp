@@ -0,0 +1,51 @@
+/*
+ * EventPipeline.cpp
+ *
+ *  Created on: Oct 16, 2026
+ *      Author: Jonas Kunze (kunze.jonas@gmail.com)
+ */
+
+#include "EventPipeline.h"
+
+#include <options/Logging.h>
+
+#include "../options/MyOptions.h"
+#include "L1Builder.h"
+#include "L2Builder.h"
+
+namespace na62 {
+
+PipelineStage EventPipeline::L1("L1", &L1Builder::processL1);
+PipelineStage EventPipeline::LKrRequest("LKrRequest",
+		&L1Builder::sendL1RequestsToCREAMS);
+PipelineStage EventPipeline::L2("L2", &L2Builder::processL2);
+PipelineStage EventPipeline::Storage("Storage", &L2Builder::sendToStorage);
+
+PipelineStage* const EventPipeline::Stages[] = { &L1, &LKrRequest, &L2,
+		&Storage };
+const uint EventPipeline::NumberOfStages = sizeof(Stages) / sizeof(Stages[0]);
+
+void EventPipeline::initialize() {
+	const int capacity = Options::GetInt(OPTION_PIPELINE_QUEUE_CAPACITY);
+	if (capacity <= 0) {
+		LOG_ERROR<< "The option " << OPTION_PIPELINE_QUEUE_CAPACITY
+		<< " must be larger than 0" << ENDL;
+		exit(1);
+	}
+
+	L1.configure(Options::GetInt(OPTION_PIPELINE_L1_CONCURRENCY), capacity);
+	LKrRequest.configure(Options::GetInt(OPTION_PIPELINE_LKR_REQUEST_CONCURRENCY),
+			capacity);
+	L2.configure(Options::GetInt(OPTION_PIPELINE_L2_CONCURRENCY), capacity);
+	Storage.configure(Options::GetInt(OPTION_PIPELINE_STORAGE_CONCURRENCY),
+			capacity);
+
+	for (uint i = 0; i != NumberOfStages; i++) {
+		if (Stages[i]->isQueued()) {
+			LOG_INFO<< "Pipeline stage " << Stages[i]->getName()
+			<< " runs in its own tasks" << ENDL;
+		}
+	}
+}
+
+} /* namespace na62 */
@@ -0,0 +1,43 @@
+/*
+ * EventPipeline.h
+ *
+ *  Created on: Oct 16, 2026
+ *      Author: Jonas Kunze (kunze.jonas@gmail.com)
+ */
+
+#pragma once
+#ifndef EVENTPIPELINE_H_
+#define EVENTPIPELINE_H_
+
+#include "PipelineStage.h"
+
+namespace na62 {
+
+/*
+ * The stages a complete L0 event passes after being built by the frame tasks:
+ *
+ *   L1 -> LKr request -> (LKr event building) -> L2 -> storage
+ *
+ * Every stage has its own concurrency limit (pipeline<Stage>Concurrency) and a bounded queue
+ * (pipelineQueueCapacity). A concurrency of 0 processes the stage inline within the thread
+ * finishing the previous one, which is the default for all stages.
+ */
+class EventPipeline {
+public:
+	static PipelineStage L1;
+	static PipelineStage LKrRequest;
+	static PipelineStage L2;
+	static PipelineStage Storage;
+
+	static void initialize();
+
+	/*
+	 * All stages in processing order for monitoring
+	 */
+	static PipelineStage* const Stages[];
+	static const uint NumberOfStages;
+};
+
+} /* namespace na62 */
+
+#endif /* EVENTPIPELINE_H_ */
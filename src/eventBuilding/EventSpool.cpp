@@ -0,0 +1,275 @@
+/*
+ * EventSpool.cpp
+ *
+ *  Created on: Oct 16, 2026
+ *      Author: Jonas Kunze (kunze.jonas@gmail.com)
+ */
+
+#include "EventSpool.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#include <string>
+
+#include <options/Logging.h>
+#include <options/Options.h>
+#include <structs/Event.h>
+
+#include "../options/MyOptions.h"
+#include "MergerSender.h"
+#include "OutputBufferPool.h"
+
+namespace na62 {
+
+/*
+ * Anything larger is regarded as corrupted spool data
+ */
+#define MAX_SPOOLED_EVENT_SIZE (64 << 20)
+
+EventSpool* EventSpool::drainer_ = nullptr;
+EventSpool* EventSpool::writer_ = nullptr;
+
+tbb::concurrent_bounded_queue<OutgoingEvent*> EventSpool::writeQueue_;
+
+int EventSpool::fd_ = -1;
+uint64_t EventSpool::maxSpoolBytes_;
+
+std::mutex EventSpool::mutex_;
+std::atomic<uint64_t> EventSpool::writeOffset_(0);
+std::atomic<uint64_t> EventSpool::readOffset_(0);
+
+std::atomic<uint64_t> EventSpool::eventsSpooled_(0);
+std::atomic<uint64_t> EventSpool::eventsReplayed_(0);
+std::atomic<uint64_t> EventSpool::eventsDropped_(0);
+
+EventSpool::EventSpool(bool writer) :
+		isWriter_(writer), running_(true) {
+}
+
+EventSpool::~EventSpool() {
+}
+
+void EventSpool::initialize() {
+	maxSpoolBytes_ = (uint64_t) Options::GetInt(OPTION_MAX_SPOOL_SIZE) << 20;
+
+	const std::string fileName = Options::GetString(OPTION_SPOOL_FILE);
+	if (!fileName.empty()) {
+		fd_ = open(fileName.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+		if (fd_ < 0) {
+			LOG_ERROR<< "Unable to open spool file " << fileName << ": "
+			<< strerror(errno) << ENDL;
+			exit(1);
+		}
+		LOG_INFO<< "Spooling events to " << fileName << " if the mergers are too slow" << ENDL;
+
+		writeQueue_.set_capacity(WRITE_QUEUE_CAPACITY);
+		writer_ = new EventSpool(true);
+		writer_->startThread("EventSpoolWriter");
+	}
+
+	/*
+	 * The drainer also reopens the queues if spooling is disabled
+	 */
+	drainer_ = new EventSpool(false);
+	drainer_->startThread("EventSpool");
+}
+
+bool EventSpool::writeFully(const char* data, uint length, uint64_t offset) {
+	while (length != 0) {
+		const ssize_t written = pwrite(fd_, data, length, offset);
+		if (written < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			return false;
+		}
+		data += written;
+		length -= written;
+		offset += written;
+	}
+	return true;
+}
+
+bool EventSpool::readFully(char* data, uint length, uint64_t offset) {
+	while (length != 0) {
+		const ssize_t bytesRead = pread(fd_, data, length, offset);
+		if (bytesRead <= 0) {
+			if (bytesRead < 0 && errno == EINTR) {
+				continue;
+			}
+			return false;
+		}
+		data += bytesRead;
+		length -= bytesRead;
+		offset += bytesRead;
+	}
+	return true;
+}
+
+void EventSpool::dropEvent(OutgoingEvent* event) {
+	for (const OutgoingPart& part : event->parts) {
+		part.freeFn(part.data, part.hint);
+	}
+	delete event;
+}
+
+void EventSpool::spoolEvent(OutgoingEvent* event) {
+	if (fd_ < 0 || !writeQueue_.try_push(event)) {
+		eventsDropped_.fetch_add(1, std::memory_order_relaxed);
+		dropEvent(event);
+	}
+}
+
+void EventSpool::writeEvent(OutgoingEvent* event) {
+	uint eventLength = 0;
+	for (const OutgoingPart& part : event->parts) {
+		eventLength += part.length;
+	}
+
+	bool spooled = false;
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		uint64_t offset = writeOffset_;
+		if (offset + eventLength <= maxSpoolBytes_) {
+			spooled = true;
+			for (const OutgoingPart& part : event->parts) {
+				if (!writeFully((const char*) part.data, part.length, offset)) {
+					LOG_ERROR<< "Unable to write to the spool file: " << strerror(errno) << ENDL;
+					spooled = false;
+					break;
+				}
+				offset += part.length;
+			}
+			if (spooled) {
+				writeOffset_ = offset;
+			}
+		}
+	}
+
+	if (spooled) {
+		eventsSpooled_.fetch_add(1, std::memory_order_relaxed);
+	} else {
+		eventsDropped_.fetch_add(1, std::memory_order_relaxed);
+	}
+	dropEvent(event);
+}
+
+bool EventSpool::replayNextEvent() {
+	const uint64_t offset = readOffset_;
+
+	EVENT_HDR hdr;
+	if (!readFully((char*) &hdr, sizeof(EVENT_HDR), offset)) {
+		return false;
+	}
+
+	const uint eventLength = hdr.length * 4;
+	if (eventLength < sizeof(EVENT_HDR) || eventLength > MAX_SPOOLED_EVENT_SIZE
+			|| offset + eventLength > writeOffset_) {
+		return false;
+	}
+
+	void* freeHint;
+	char* buffer = OutputBufferPool::getBuffer(hdr.triggerWord, eventLength,
+			freeHint);
+	if (!readFully(buffer, eventLength, offset)) {
+		OutputBufferPool::freeBuffer(buffer, freeHint);
+		return false;
+	}
+
+	OutgoingEvent* event = new OutgoingEvent();
+	event->burstID = hdr.burstID;
+	event->eventNumber = hdr.eventNum;
+	event->parts.push_back( { buffer, eventLength,
+			(zmq::free_fn*) OutputBufferPool::freeBuffer, freeHint });
+	MergerSender::enqueueEvent(event, hdr.eventNum, true);
+
+	readOffset_ = offset + eventLength;
+	eventsReplayed_.fetch_add(1, std::memory_order_relaxed);
+	return true;
+}
+
+void EventSpool::resetIfDrained() {
+	std::lock_guard<std::mutex> lock(mutex_);
+	if (readOffset_ != writeOffset_ || writeQueue_.size() > 0) {
+		return;
+	}
+
+	if (writeOffset_ != 0) {
+		if (ftruncate(fd_, 0) != 0) {
+			LOG_ERROR<< "Unable to truncate the spool file: " << strerror(errno) << ENDL;
+		}
+		readOffset_ = 0;
+		writeOffset_ = 0;
+	}
+
+	if (MergerSender::IsClosed()
+			&& MergerSender::GetNumberOfQueuedEvents()
+					<= MergerSender::GetLowWatermark()) {
+		LOG_INFO<< "Merger output queues drained: Stopped spooling" << ENDL;
+		MergerSender::reopen();
+	}
+}
+
+void EventSpool::thread() {
+	if (isWriter_) {
+		writeEvents();
+	} else {
+		drainEvents();
+	}
+}
+
+void EventSpool::writeEvents() {
+	OutgoingEvent* event;
+	try {
+		while (true) {
+			writeQueue_.pop(event);
+			writeEvent(event);
+		}
+	} catch (tbb::user_abort const& e) {
+		LOG_INFO<< "Stopping event spool writer with " << writeQueue_.size()
+		<< " events not written" << ENDL;
+	}
+}
+
+void EventSpool::drainEvents() {
+	while (running_) {
+		if (GetBytesPending() == 0 && !MergerSender::IsClosed()) {
+			usleep(10000);
+			continue;
+		}
+
+		if (MergerSender::GetNumberOfQueuedEvents()
+				> MergerSender::GetLowWatermark()) {
+			usleep(1000);
+			continue;
+		}
+
+		/*
+		 * Refill the queues up to twice the low watermark
+		 */
+		while (GetBytesPending() != 0
+				&& MergerSender::GetNumberOfQueuedEvents()
+						< 2 * MergerSender::GetLowWatermark() + 1) {
+			if (!replayNextEvent()) {
+				LOG_ERROR<< "Spool file corrupted: Dropping "
+				<< GetBytesPending() << " B of spooled events" << ENDL;
+				readOffset_ = writeOffset_.load();
+				break;
+			}
+		}
+
+		resetIfDrained();
+	}
+	LOG_INFO<< "Stopping event spool with " << GetBytesPending() << " B not replayed" << ENDL;
+}
+
+void EventSpool::onInterruption() {
+	running_ = false;
+	if (isWriter_) {
+		writeQueue_.abort();
+	}
+}
+
+} /* namespace na62 */
@@ -0,0 +1,132 @@
+/*
+ * EventSpool.h
+ *
+ *  Created on: Oct 16, 2026
+ *      Author: Jonas Kunze (kunze.jonas@gmail.com)
+ */
+
+#pragma once
+#ifndef EVENTSPOOL_H_
+#define EVENTSPOOL_H_
+
+#include <sys/types.h>
+#include <tbb/concurrent_queue.h>
+#include <utils/AExecutable.h>
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+
+namespace na62 {
+
+struct OutgoingEvent;
+
+/*
+ * Local disk spool for accepted events that do not fit into the merger output queues.
+ *
+ * Events are handed to a writer thread which appends them to the spool file in the merger
+ * event format, so the threads building events never wait for the disk. A drainer thread
+ * replays them to the MergerSenders as soon as the queues are below their low watermark and
+ * reopens the queues for new events when the spool is empty.
+ */
+class EventSpool: public AExecutable {
+public:
+	EventSpool(bool writer);
+	virtual ~EventSpool();
+
+	/**
+	 * Opens the spool file and starts the writer and the drainer
+	 */
+	static void initialize();
+
+	/**
+	 * Enqueues the event to be appended to the spool file by the writer thread. If the spool
+	 * is disabled or the writer cannot keep up the event is dropped
+	 */
+	static void spoolEvent(OutgoingEvent* event);
+
+	static uint64_t GetEventsSpooled() {
+		return eventsSpooled_;
+	}
+
+	static uint64_t GetEventsReplayed() {
+		return eventsReplayed_;
+	}
+
+	static uint64_t GetEventsDropped() {
+		return eventsDropped_;
+	}
+
+	/*
+	 * Number of spooled bytes not yet replayed
+	 */
+	static uint64_t GetBytesPending() {
+		return writeOffset_ - readOffset_;
+	}
+
+private:
+	/*
+	 * Maximum number of events waiting for the writer thread
+	 */
+	static const uint WRITE_QUEUE_CAPACITY = 4096;
+
+	static EventSpool* drainer_;
+	static EventSpool* writer_;
+
+	static tbb::concurrent_bounded_queue<OutgoingEvent*> writeQueue_;
+
+	static int fd_;
+	static uint64_t maxSpoolBytes_;
+
+	/*
+	 * Protects the write offset and the truncation of the file between the writer and the
+	 * drainer
+	 */
+	static std::mutex mutex_;
+	static std::atomic<uint64_t> writeOffset_;
+	static std::atomic<uint64_t> readOffset_;
+
+	static std::atomic<uint64_t> eventsSpooled_;
+	static std::atomic<uint64_t> eventsReplayed_;
+	static std::atomic<uint64_t> eventsDropped_;
+
+	const bool isWriter_;
+	bool running_;
+
+	void thread();
+	void onInterruption();
+
+	/**
+	 * Writes the enqueued events to the spool file
+	 */
+	void writeEvents();
+
+	/**
+	 * Replays the spooled events as soon as the merger queues are short enough
+	 */
+	void drainEvents();
+
+	/**
+	 * Appends the event to the spool file and releases all its parts
+	 */
+	static void writeEvent(OutgoingEvent* event);
+
+	/**
+	 * Reads the next event from the spool and enqueues it
+	 *
+	 * @return false if the spool is corrupted
+	 */
+	bool replayNextEvent();
+
+	/**
+	 * Truncates the spool file if everything has been replayed and reopens the queues
+	 */
+	void resetIfDrained();
+
+	static bool writeFully(const char* data, uint length, uint64_t offset);
+	static bool readFully(char* data, uint length, uint64_t offset);
+	static void dropEvent(OutgoingEvent* event);
+};
+
+} /* namespace na62 */
+
+#endif /* EVENTSPOOL_H_ */
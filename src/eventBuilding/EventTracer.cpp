@@ -0,0 +1,338 @@
+/*
+ * EventTracer.cpp
+ *
+ *  Created on: Oct 16, 2026
+ *      Author: Jonas Kunze (kunze.jonas@gmail.com)
+ */
+
+#include "EventTracer.h"
+
+#include <eventBuilding/Event.h>
+#include <options/Logging.h>
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <mutex>
+#include <sstream>
+
+#include "../options/MyOptions.h"
+
+namespace na62 {
+
+bool EventTracer::enabled_ = false;
+uint EventTracer::sampling_ = 0;
+
+EventTracer::Trace* EventTracer::traces_ = nullptr;
+uint EventTracer::traceMask_ = 0;
+
+thread_local EventTracer::ThreadHistograms* EventTracer::threadHistograms_ =
+		nullptr;
+
+tbb::spin_mutex EventTracer::histogramsMutex_;
+std::vector<EventTracer::ThreadHistograms*> EventTracer::allThreadHistograms_;
+
+/*
+ * Cumulative bucket counts of the last takeIntervalSummaries call
+ */
+static std::vector<std::vector<uint64_t> > lastCounts_;
+
+static std::mutex sampleMutex_;
+static std::ofstream sampleFile_;
+
+static const uint64_t EMPTY_TAG = ~0ull;
+
+/*
+ * Tag of an entry that is being reset by startTrace. It never matches a lookup
+ */
+static const uint64_t BUSY_TAG = ~0ull - 1;
+
+static inline uint64_t nowNanos() {
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(
+			std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static inline uint64_t makeTag(const uint eventNumber, const uint burstID) {
+	return (uint64_t) burstID << 32 | eventNumber;
+}
+
+void EventTracer::initialize() {
+	enabled_ = MyOptions::GetBool(OPTION_EVENT_TRACING);
+	if (!enabled_) {
+		return;
+	}
+
+	uint tableSize = 1;
+	while (tableSize < (uint) Options::GetInt(OPTION_EVENT_TRACE_TABLE_SIZE)) {
+		tableSize <<= 1;
+	}
+	traceMask_ = tableSize - 1;
+	traces_ = new Trace[tableSize];
+	for (uint i = 0; i != tableSize; i++) {
+		traces_[i].tag = EMPTY_TAG;
+	}
+
+	sampling_ = Options::GetInt(OPTION_EVENT_TRACE_SAMPLING);
+	if (sampling_ != 0) {
+		const std::string fileName = Options::GetString(
+		OPTION_EVENT_TRACE_FILE);
+		sampleFile_.open(fileName, std::ios::out | std::ios::app);
+		if (!sampleFile_.good()) {
+			LOG_ERROR<< "Unable to open event trace file " << fileName << ENDL;
+			exit(1);
+		}
+		LOG_INFO<< "Writing the trace of every " << sampling_ << ". event to "
+		<< fileName << ENDL;
+	}
+}
+
+const char* EventTracer::getStageName(const Stage stage) {
+	switch (stage) {
+	case FirstFragment:
+		return "FirstFragment";
+	case L0Complete:
+		return "L0Complete";
+	case L1Decision:
+		return "L1Decision";
+	case MRPSent:
+		return "MRPSent";
+	case LKrComplete:
+		return "LKrComplete";
+	case L2Decision:
+		return "L2Decision";
+	case SentToMerger:
+		return "SentToMerger";
+	default:
+		return "Unknown";
+	}
+}
+
+EventTracer::ThreadHistograms* EventTracer::getThreadHistograms() {
+	if (threadHistograms_ == nullptr) {
+		threadHistograms_ = new ThreadHistograms();
+		for (uint word = 0; word != 0xFF + 1; word++) {
+			threadHistograms_->triggerWords[word] = nullptr;
+		}
+		tbb::spin_mutex::scoped_lock my_lock(histogramsMutex_);
+		allThreadHistograms_.push_back(threadHistograms_);
+	}
+	return threadHistograms_;
+}
+
+EventTracer::Trace* EventTracer::getTrace(const uint eventNumber,
+		const uint burstID) {
+	Trace* trace = &traces_[eventNumber & traceMask_];
+	if (trace->tag.load(std::memory_order_acquire)
+			!= makeTag(eventNumber, burstID)) {
+		return nullptr;
+	}
+	return trace;
+}
+
+void EventTracer::startTrace(const uint eventNumber, const uint burstID) {
+	Trace* trace = &traces_[eventNumber & traceMask_];
+	const uint64_t tag = makeTag(eventNumber, burstID);
+	uint64_t oldTag = trace->tag.load(std::memory_order_relaxed);
+	if (oldTag == tag || oldTag == BUSY_TAG) {
+		return;
+	}
+
+	/*
+	 * Only the first fragment of the event wins the entry. It is marked busy while the
+	 * stamps of the previous event are cleared so that no other thread can look it up
+	 * with stale stamps. The release store of the tag publishes the cleared stamps
+	 */
+	if (!trace->tag.compare_exchange_strong(oldTag, BUSY_TAG,
+			std::memory_order_acquire)) {
+		return;
+	}
+	trace->stamps[FirstFragment].store(nowNanos(), std::memory_order_relaxed);
+	for (uint stage = FirstFragment + 1; stage != NumberOfStages; stage++) {
+		trace->stamps[stage].store(0, std::memory_order_relaxed);
+	}
+	trace->l1TriggerTypeWord.store(0, std::memory_order_relaxed);
+	trace->tag.store(tag, std::memory_order_release);
+}
+
+void EventTracer::addStamp(const uint eventNumber, const uint burstID,
+		const Stage stage) {
+	Trace* trace = getTrace(eventNumber, burstID);
+	if (trace == nullptr) {
+		return;
+	}
+
+	const uint64_t now = nowNanos();
+	trace->stamps[stage].store(now, std::memory_order_relaxed);
+
+	/*
+	 * Time since the last stage the event passed (MRPSent and LKrComplete are skipped
+	 * without LKr)
+	 */
+	uint64_t previous = 0;
+	for (int s = stage - 1; s >= 0 && previous == 0; s--) {
+		previous = trace->stamps[s].load(std::memory_order_relaxed);
+	}
+	if (previous == 0 || previous > now) {
+		return;
+	}
+
+	ThreadHistograms* histograms = getThreadHistograms();
+	histograms->stages[stage].record(now - previous);
+
+	if (stage == SentToMerger) {
+		const uint64_t total = now
+				- trace->stamps[FirstFragment].load(std::memory_order_relaxed);
+		histograms->stages[FirstFragment].record(total);
+
+		const uint8_t word = trace->l1TriggerTypeWord.load(
+				std::memory_order_relaxed);
+		LatencyHistogram* wordHistogram = histograms->triggerWords[word].load(
+				std::memory_order_relaxed);
+		if (wordHistogram == nullptr) {
+			wordHistogram = new LatencyHistogram();
+			histograms->triggerWords[word].store(wordHistogram,
+					std::memory_order_release);
+		}
+		wordHistogram->record(total);
+
+		if (sampling_ != 0 && eventNumber % sampling_ == 0) {
+			writeSample(trace, eventNumber, burstID, true);
+		}
+	}
+}
+
+void EventTracer::stamp(Event* event, const Stage stage) {
+	if (enabled_) {
+		addStamp(event->getEventNumber(), event->getBurstID(), stage);
+	}
+}
+
+void EventTracer::stampL1Decision(Event* event,
+		const uint8_t l1TriggerTypeWord) {
+	if (!enabled_) {
+		return;
+	}
+	Trace* trace = getTrace(event->getEventNumber(), event->getBurstID());
+	if (trace != nullptr) {
+		trace->l1TriggerTypeWord.store(l1TriggerTypeWord,
+				std::memory_order_relaxed);
+		addStamp(event->getEventNumber(), event->getBurstID(), L1Decision);
+	}
+}
+
+void EventTracer::finishRejected(Event* event) {
+	if (sampling_ == 0 || event->getEventNumber() % sampling_ != 0) {
+		return;
+	}
+	Trace* trace = getTrace(event->getEventNumber(), event->getBurstID());
+	if (trace != nullptr) {
+		writeSample(trace, event->getEventNumber(), event->getBurstID(), false);
+	}
+}
+
+void EventTracer::writeSample(Trace* trace, const uint eventNumber,
+		const uint burstID, const bool accepted) {
+	/*
+	 * burstID eventNumber L1TriggerWord accepted|rejected followed by the nanoseconds since
+	 * the first fragment of every stage the event has passed
+	 */
+	std::stringstream line;
+	const uint64_t first = trace->stamps[FirstFragment].load(
+			std::memory_order_relaxed);
+	line << burstID << " " << eventNumber << " 0x" << std::hex
+			<< (uint) trace->l1TriggerTypeWord.load(std::memory_order_relaxed)
+			<< std::dec << (accepted ? " accepted" : " rejected");
+	for (uint stage = FirstFragment + 1; stage != NumberOfStages; stage++) {
+		const uint64_t stamp = trace->stamps[stage].load(
+				std::memory_order_relaxed);
+		if (stamp != 0) {
+			line << " " << getStageName((Stage) stage) << "=" << stamp - first;
+		}
+	}
+	line << "\n";
+
+	std::lock_guard<std::mutex> lock(sampleMutex_);
+	sampleFile_ << line.str();
+}
+
+static void summarize(const std::string& name, std::vector<uint64_t>& counts,
+		std::vector<uint64_t>& lastCounts,
+		std::vector<EventTracer::LatencySummary>& summaries) {
+	if (lastCounts.empty()) {
+		lastCounts.resize(counts.size(), 0);
+	}
+
+	uint64_t events = 0;
+	for (uint i = 0; i != counts.size(); i++) {
+		const uint64_t current = counts[i];
+		counts[i] -= lastCounts[i];
+		lastCounts[i] = current;
+		events += counts[i];
+	}
+	if (events == 0) {
+		return;
+	}
+
+	const double quantiles[] = { 0.5, 0.9, 0.99, 0.999 };
+	uint64_t values[4] = { 0, 0, 0, 0 };
+	uint64_t seen = 0;
+	uint quantile = 0;
+	for (uint bucket = 0; bucket != counts.size() && quantile != 4;
+			bucket++) {
+		seen += counts[bucket];
+		while (quantile != 4 && seen >= quantiles[quantile] * events) {
+			values[quantile++] = LatencyHistogram::getBucketValue(bucket);
+		}
+	}
+	summaries.push_back( { name, events, values[0], values[1], values[2],
+			values[3] });
+}
+
+std::vector<EventTracer::LatencySummary> EventTracer::takeIntervalSummaries() {
+	std::vector<LatencySummary> summaries;
+	if (!enabled_) {
+		return summaries;
+	}
+
+	std::vector<ThreadHistograms*> threads;
+	{
+		tbb::spin_mutex::scoped_lock my_lock(histogramsMutex_);
+		threads = allThreadHistograms_;
+	}
+
+	lastCounts_.resize(NumberOfStages + 0xFF + 1);
+	std::vector<uint64_t> counts(LatencyHistogram::NUMBER_OF_BUCKETS);
+
+	for (uint stage = 0; stage != NumberOfStages; stage++) {
+		std::fill(counts.begin(), counts.end(), 0);
+		for (ThreadHistograms* thread : threads) {
+			thread->stages[stage].addTo(counts.data());
+		}
+		summarize(
+				stage == FirstFragment ?
+						"LatencyTotal" :
+						std::string("Latency") + getStageName((Stage) stage),
+				counts, lastCounts_[stage], summaries);
+	}
+
+	for (uint word = 0; word != 0xFF + 1; word++) {
+		bool used = false;
+		std::fill(counts.begin(), counts.end(), 0);
+		for (ThreadHistograms* thread : threads) {
+			LatencyHistogram* histogram = thread->triggerWords[word].load(
+					std::memory_order_acquire);
+			if (histogram != nullptr) {
+				histogram->addTo(counts.data());
+				used = true;
+			}
+		}
+		if (used) {
+			std::stringstream name;
+			name << "LatencyTotalL1Trigger0x" << std::hex << word;
+			summarize(name.str(), counts, lastCounts_[NumberOfStages + word],
+					summaries);
+		}
+	}
+	return summaries;
+}
+
+} /* namespace na62 */
@@ -0,0 +1,197 @@
+/*
+ * EventTracer.h
+ *
+ *  Created on: Oct 16, 2026
+ *      Author: Jonas Kunze (kunze.jonas@gmail.com)
+ */
+
+#pragma once
+#ifndef EVENTTRACER_H_
+#define EVENTTRACER_H_
+
+#include <sys/types.h>
+#include <tbb/spin_mutex.h>
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace na62 {
+class Event;
+
+/*
+ * Log-linear latency histogram with 16 sub buckets per power of two (< 6.25% error).
+ * Every histogram is only written by one thread so the counters are relaxed atomics.
+ */
+class LatencyHistogram {
+public:
+	static const uint SUB_BUCKET_BITS = 4;
+	static const uint SUB_BUCKETS = 1 << SUB_BUCKET_BITS;
+	static const uint NUMBER_OF_BUCKETS = (64 - SUB_BUCKET_BITS + 1)
+			* SUB_BUCKETS;
+
+	LatencyHistogram() {
+		for (uint i = 0; i != NUMBER_OF_BUCKETS; i++) {
+			counts_[i] = 0;
+		}
+	}
+
+	void record(const uint64_t nanos) {
+		std::atomic<uint64_t>& count = counts_[getBucket(nanos)];
+		count.store(count.load(std::memory_order_relaxed) + 1,
+				std::memory_order_relaxed);
+	}
+
+	void addTo(uint64_t* counts) const {
+		for (uint i = 0; i != NUMBER_OF_BUCKETS; i++) {
+			counts[i] += counts_[i].load(std::memory_order_relaxed);
+		}
+	}
+
+	static uint getBucket(const uint64_t nanos) {
+		if (nanos < SUB_BUCKETS) {
+			return nanos;
+		}
+		const uint shift = 63 - __builtin_clzll(nanos) - SUB_BUCKET_BITS;
+		return (shift + 1) * SUB_BUCKETS
+				+ ((nanos >> shift) & (SUB_BUCKETS - 1));
+	}
+
+	/**
+	 * @return The largest value stored in the given bucket
+	 */
+	static uint64_t getBucketValue(const uint bucket) {
+		if (bucket < SUB_BUCKETS) {
+			return bucket;
+		}
+		const uint shift = bucket / SUB_BUCKETS - 1;
+		return ((SUB_BUCKETS + bucket % SUB_BUCKETS + 1ull) << shift) - 1;
+	}
+
+private:
+	std::atomic<uint64_t> counts_[NUMBER_OF_BUCKETS];
+};
+
+/*
+ * Timestamps the events at every processing stage and feeds the time between consecutive
+ * stages into per thread histograms. The timestamps are kept in a table indexed by the
+ * event number so that the Event structure does not have to be changed. An event is only
+ * traced if its first fragment has been seen and its table entry has not been reused since.
+ *
+ * If eventTraceSampling is set every n-th event is written with all its timestamps to
+ * eventTraceFile as soon as it is sent to the merger or rejected.
+ */
+class EventTracer {
+public:
+	enum Stage {
+		FirstFragment,
+		L0Complete,
+		L1Decision,
+		MRPSent,
+		LKrComplete,
+		L2Decision,
+		SentToMerger,
+		NumberOfStages
+	};
+
+	struct LatencySummary {
+		std::string name;
+		uint64_t events;
+		uint64_t p50Nanos;
+		uint64_t p90Nanos;
+		uint64_t p99Nanos;
+		uint64_t p999Nanos;
+	};
+
+	static void initialize();
+
+	static inline bool IsEnabled() {
+		return enabled_;
+	}
+
+	/**
+	 * Starts tracing the event if this is its first fragment
+	 */
+	static inline void stampFirstFragment(const uint eventNumber,
+			const uint burstID) {
+		if (enabled_) {
+			startTrace(eventNumber, burstID);
+		}
+	}
+
+	static inline void stamp(const uint eventNumber, const uint burstID,
+			const Stage stage) {
+		if (enabled_) {
+			addStamp(eventNumber, burstID, stage);
+		}
+	}
+
+	static void stamp(Event* event, const Stage stage);
+
+	/**
+	 * Stamps the L1 decision and remembers the L1 trigger word for the per trigger statistics
+	 */
+	static void stampL1Decision(Event* event, const uint8_t l1TriggerTypeWord);
+
+	/**
+	 * Writes the trace of a rejected event if it is sampled
+	 */
+	static void finishRejected(Event* event);
+
+	/**
+	 * Merges the histograms of all threads and returns the percentiles of the latencies
+	 * recorded since the last call. Only called by the MonitorConnector
+	 */
+	static std::vector<LatencySummary> takeIntervalSummaries();
+
+	static const char* getStageName(const Stage stage);
+
+private:
+	struct Trace {
+		/*
+		 * burstID << 32 | eventNumber of the traced event
+		 */
+		std::atomic<uint64_t> tag;
+		std::atomic<uint64_t> stamps[NumberOfStages];
+		std::atomic<uint8_t> l1TriggerTypeWord;
+	};
+
+	/*
+	 * Histograms of one thread: the time since the previous stage for every stage (the
+	 * FirstFragment entry holds the total time until the event is sent to the merger) and
+	 * the total time per L1 trigger word which are allocated on first use
+	 */
+	struct ThreadHistograms {
+		LatencyHistogram stages[NumberOfStages];
+		std::atomic<LatencyHistogram*> triggerWords[0xFF + 1];
+	};
+
+	static bool enabled_;
+	static uint sampling_;
+
+	static Trace* traces_;
+	static uint traceMask_;
+
+	static thread_local ThreadHistograms* threadHistograms_;
+
+	/*
+	 * All thread histograms ever created. Only locked when a thread records its first
+	 * latency and by the monitoring
+	 */
+	static tbb::spin_mutex histogramsMutex_;
+	static std::vector<ThreadHistograms*> allThreadHistograms_;
+
+	static void startTrace(const uint eventNumber, const uint burstID);
+	static void addStamp(const uint eventNumber, const uint burstID,
+			const Stage stage);
+
+	static Trace* getTrace(const uint eventNumber, const uint burstID);
+	static ThreadHistograms* getThreadHistograms();
+
+	static void writeSample(Trace* trace, const uint eventNumber,
+			const uint burstID, const bool accepted);
+};
+
+} /* namespace na62 */
+
+#endif /* EVENTTRACER_H_ */
@@ -23,6 +23,7 @@
 #include <socket/NetworkHandler.h>
 #include <structs/Network.h>
 #include <algorithm>
+#include <chrono>
 #include <cstdbool>
 #include <iostream>
 #include <string>
@@ -30,17 +31,29 @@
 
 #include "../options/MyOptions.h"
 #include "../socket/HandleFrameTask.h"
+#include "EventAgingService.h"
+#include "EventPipeline.h"
+#include "EventTracer.h"
 #include "L2Builder.h"
+#include "TriggerTask.h"
 
 namespace na62 {
 
-std::atomic<uint64_t>* L1Builder::L1Triggers_ = new std::atomic<uint64_t>[0xFF
-		+ 1];
-
 bool L1Builder::requestZSuppressedLkrData_;
+bool L1Builder::sendL1Requests_;
 
 uint L1Builder::downscaleFactor_ = 0;
 
+thread_local L1Builder::L1Batch L1Builder::l1Batch_;
+uint L1Builder::l1BatchSize_ = 1;
+uint64_t L1Builder::l1BatchMaxDelayNanos_ = 0;
+std::atomic<uint64_t> L1Builder::l1BatchesProcessed_(0);
+
+static inline uint64_t nowNanos() {
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(
+			std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
 bool L1Builder::buildEvent(l0::MEPFragment* fragment, uint32_t burstID) {
 	Event *event = EventPool::GetEvent(fragment->getEventNumber());
 
@@ -57,20 +70,69 @@ bool L1Builder::buildEvent(l0::MEPFragment* fragment, uint32_t burstID) {
 		return false;
 	}
 
+	EventTracer::stampFirstFragment(fragment->getEventNumber(), burstID);
+
 	/*
 	 * Add new packet to Event
 	 */
-	if (event->addL0Event(fragment, burstID)) {
+	const bool complete =
+			EventAgingService::IsEnabled() ?
+					EventAgingService::addL0Fragment(event, fragment, burstID) :
+					event->addL0Event(fragment, burstID);
+	if (complete) {
+		EventTracer::stamp(event, EventTracer::L0Complete);
+
 		/*
-		 * This event is complete -> process it
+		 * This event is complete -> process it together with the next completed ones
 		 */
-		processL1(event);
+		if (l1BatchSize_ == 1) {
+			if (TriggerTask::IsEnabled() && !EventPipeline::L1.isQueued()) {
+				TriggerTask::enqueue(event, TriggerTask::L1);
+			} else {
+				EventPipeline::L1.push(event);
+			}
+			return true;
+		}
+
+		L1Batch& batch = l1Batch_;
+		if (batch.events.empty()) {
+			batch.firstEventNanos = nowNanos();
+		}
+		batch.events.push_back(event);
+		if (batch.events.size() >= l1BatchSize_) {
+			flushL1Batch();
+		} else {
+			flushL1BatchIfExpired();
+		}
 		return true;
 	}
 	return false;
 }
 
-void L1Builder::processL1(Event *event) {
+void L1Builder::flushL1Batch() {
+	L1Batch& batch = l1Batch_;
+	if (batch.events.empty()) {
+		return;
+	}
+
+	if (TriggerTask::IsEnabled() && !EventPipeline::L1.isQueued()) {
+		TriggerTask::enqueue(std::move(batch.events), TriggerTask::L1);
+		batch.events.clear();
+	} else {
+		EventPipeline::L1.push(batch.events.data(), batch.events.size());
+		batch.events.clear();
+	}
+}
+
+void L1Builder::flushL1BatchIfExpired() {
+	L1Batch& batch = l1Batch_;
+	if (!batch.events.empty()
+			&& nowNanos() - batch.firstEventNanos >= l1BatchMaxDelayNanos_) {
+		flushL1Batch();
+	}
+}
+
+uint8_t L1Builder::prepareL1(Event* event) {
 	uint8_t l0TriggerTypeWord = 1;
 	if (SourceIDManager::L0TP_ACTIVE) {
 		l0::MEPFragment* L0TPEvent = event->getL0TPSubevent()->getFragment(0);
@@ -86,38 +148,92 @@ void L1Builder::processL1(Event *event) {
 	l0::MEPFragment* tsFragment = event->getL0SubeventBySourceIDNum(
 			SourceIDManager::TS_SOURCEID_NUM)->getFragment(0);
 	event->setTimestamp(tsFragment->getTimestamp());
+	return l0TriggerTypeWord;
+}
 
-	/*
-	 * Process Level 1 trigger
-	 */
-	uint8_t l1TriggerTypeWord = L1TriggerProcessor::compute(event);
-	uint16_t L0L1Trigger(l0TriggerTypeWord | l1TriggerTypeWord << 8);
+void L1Builder::computeL1(Event** events, const uint numberOfEvents,
+		uint8_t* l1TriggerTypeWords) {
+	for (uint i = 0; i != numberOfEvents; i++) {
+		l1TriggerTypeWords[i] = L1TriggerProcessor::compute(events[i]);
+	}
+}
 
-	L1Triggers_[l1TriggerTypeWord].fetch_add(1, std::memory_order_relaxed); // The second 8 bits are the L1 trigger type word
-	event->setL1Processed(L0L1Trigger);
+void L1Builder::processL1(Event *event) {
+	processL1(&event, 1);
+}
+
+void L1Builder::processL1(Event** events, const uint numberOfEvents) {
+	const uint chunkSize = 64;
+	uint8_t l0TriggerTypeWords[chunkSize];
+	uint8_t l1TriggerTypeWords[chunkSize];
+	Event* acceptedEvents[chunkSize];
+
+	for (uint first = 0; first < numberOfEvents; first += chunkSize) {
+		const uint chunkEvents = std::min(chunkSize, numberOfEvents - first);
+
+		for (uint i = 0; i != chunkEvents; i++) {
+			l0TriggerTypeWords[i] = prepareL1(events[first + i]);
+		}
+
+		/*
+		 * Process Level 1 trigger
+		 */
+		computeL1(events + first, chunkEvents, l1TriggerTypeWords);
+
+		uint numberOfAcceptedEvents = 0;
+		for (uint i = 0; i != chunkEvents; i++) {
+			if (finishL1(events[first + i], l0TriggerTypeWords[i],
+					l1TriggerTypeWords[i])) {
+				acceptedEvents[numberOfAcceptedEvents++] = events[first + i];
+			}
+		}
 
-	if (SourceIDManager::NUMBER_OF_EXPECTED_CREAM_PACKETS_PER_EVENT != 0) {
-		if (L0L1Trigger != 0) {
+		if (numberOfAcceptedEvents != 0) {
 			/*
 			 * Only request accepted events from LKr
 			 */
-			sendL1RequestToCREAMS(event);
-		}
-	} else {
-		if (L0L1Trigger != 0) {
-			L2Builder::processL2(event);
+			if (SourceIDManager::NUMBER_OF_EXPECTED_CREAM_PACKETS_PER_EVENT != 0) {
+				EventPipeline::LKrRequest.push(acceptedEvents,
+						numberOfAcceptedEvents);
+			} else {
+				EventPipeline::L2.push(acceptedEvents, numberOfAcceptedEvents);
+			}
 		}
 	}
+	l1BatchesProcessed_.fetch_add(1, std::memory_order_relaxed);
+}
+
+bool L1Builder::finishL1(Event* event, uint8_t l0TriggerTypeWord,
+		uint8_t l1TriggerTypeWord) {
+	uint16_t L0L1Trigger(l0TriggerTypeWord | l1TriggerTypeWord << 8);
+
+	ThreadCounters::increment(ThreadCounters::L1_TRIGGERS + l1TriggerTypeWord); // The second 8 bits are the L1 trigger type word
+	event->setL1Processed(L0L1Trigger);
+	EventTracer::stampL1Decision(event, l1TriggerTypeWord);
 
 	/*
 	 * If the Event has been rejected by L1 we can destroy it now
 	 */
 	if (L0L1Trigger == 0) {
+		EventTracer::finishRejected(event);
 		EventPool::FreeEvent(event);
+		return false;
+	}
+	return true;
+}
+
+void L1Builder::sendL1RequestsToCREAMS(Event** events,
+		const uint numberOfEvents) {
+	for (uint i = 0; i != numberOfEvents; i++) {
+		EventTracer::stamp(events[i], EventTracer::MRPSent);
+		sendL1RequestToCREAMS(events[i]);
 	}
 }
 
 void L1Builder::sendL1RequestToCREAMS(Event* event) {
+	if (!sendL1Requests_) {
+		return;
+	}
 	cream::L1DistributionHandler::Async_RequestLKRDataMulticast(event,
 			requestZSuppressedLkrData_);
 }
@@ -9,10 +9,16 @@
 #define L1BUILDER_H_
 
 #include <tbb/task.h>
+#include <sys/types.h>
 #include <atomic>
 #include <cstdint>
+#include <algorithm>
+#include <vector>
 
+#include "../monitoring/ThreadCounters.h"
+#include "../benchmark/ThroughputBenchmark.h"
 #include "../options/MyOptions.h"
+#include "../socket/PcapReplayer.h"
 
 namespace na62 {
 class Event;
@@ -25,14 +31,51 @@ namespace na62 {
 
 class L1Builder: public tbb::task {
 private:
-	static std::atomic<uint64_t>* L1Triggers_;
-
-	static void processL1(Event *event);
-
 	static bool requestZSuppressedLkrData_;
 
+	/*
+	 * false if there is no NIC to send MRPs (pcap replay, benchmark). The requests are dropped before
+	 * they are queued as nobody would ever send them
+	 */
+	static bool sendL1Requests_;
+
 	static uint downscaleFactor_;
 
+	/*
+	 * Complete events are collected in a batch per thread and processed together as soon as
+	 * the batch has l1BatchSize events, the first event waits longer than l1BatchMaxDelay
+	 * or the thread has finished its current frames (flushL1Batch). The delay is checked
+	 * after every processed frame, not only when an event is added
+	 */
+	struct L1Batch {
+		std::vector<Event*> events;
+		uint64_t firstEventNanos;
+	};
+	static thread_local L1Batch l1Batch_;
+	static uint l1BatchSize_;
+	static uint64_t l1BatchMaxDelayNanos_;
+	static std::atomic<uint64_t> l1BatchesProcessed_;
+
+	/**
+	 * Takes the events from the L0TP and reference detector data
+	 */
+	static uint8_t prepareL1(Event* event);
+
+	/**
+	 * Runs the L1 trigger algorithm over all events back to back. This is the place for
+	 * trigger algorithms working on several events at once
+	 */
+	static void computeL1(Event** events, const uint numberOfEvents,
+			uint8_t* l1TriggerTypeWords);
+
+	/**
+	 * Accounting of an event after L1 has been computed. Rejected events are freed
+	 *
+	 * @return <true> if the event has been accepted by L1
+	 */
+	static bool finishL1(Event* event, uint8_t l0TriggerTypeWord,
+			uint8_t l1TriggerTypeWord);
+
 	/*
 	 * @return <true> if any packet has been sent (time has passed)
 	 */
@@ -47,18 +90,50 @@ public:
 	 */
 	static bool buildEvent(l0::MEPFragment* fragment, uint32_t burstID);
 
-	static inline std::atomic<uint64_t>* GetL1TriggerStats() {
-		return L1Triggers_;
+	/**
+	 * Processes the L1 trigger algorithm of the complete event
+	 */
+	static void processL1(Event *event);
+
+	/**
+	 * Processes the L1 trigger algorithm of all complete events
+	 */
+	static void processL1(Event** events, const uint numberOfEvents);
+
+	/**
+	 * Sends the LKr data requests of all L1 accepted events
+	 */
+	static void sendL1RequestsToCREAMS(Event** events, const uint numberOfEvents);
+
+	/**
+	 * Processes or enqueues the events collected by the calling thread
+	 */
+	static void flushL1Batch();
+
+	/**
+	 * Flushes the batch of the calling thread if its first event waits for too long
+	 */
+	static void flushL1BatchIfExpired();
+
+	static inline uint64_t GetL1BatchesProcessed() {
+		return l1BatchesProcessed_;
 	}
 
-	static void initialize() {
-		for (int i = 0; i != 0xFF + 1; i++) {
-			L1Triggers_[i] = 0;
-		}
+	static inline uint64_t GetL1TriggerStats(const uint8_t l1TriggerTypeWord) {
+		return ThreadCounters::sum(
+				ThreadCounters::L1_TRIGGERS + l1TriggerTypeWord);
+	}
 
+	static void initialize() {
 		requestZSuppressedLkrData_ = MyOptions::GetBool(OPTION_SEND_MRP_WITH_ZSUPPRESSION_FLAG);
+		sendL1Requests_ = !PcapReplayer::IsActive()
+				&& !ThroughputBenchmark::IsEnabled();
 
 		downscaleFactor_ = Options::GetInt(OPTION_L1_DOWNSCALE_FACTOR);
+
+		l1BatchSize_ = std::max(1, Options::GetInt(OPTION_L1_BATCH_SIZE));
+		l1BatchMaxDelayNanos_ = 1000ull
+				* Options::GetInt(OPTION_L1_BATCH_MAX_DELAY);
 	}
 };
 
@@ -13,16 +13,15 @@
 
 #include <l2/L2TriggerProcessor.h>
 #include <structs/Network.h>
+#include <algorithm>
+
+#include "EventPipeline.h"
+#include "EventTracer.h"
 #include "StorageHandler.h"
+#include "TriggerTask.h"
 
 namespace na62 {
 
-std::atomic<uint64_t>* L2Builder::L2Triggers_ = new std::atomic<uint64_t>[0xFF
-		+ 1];
-
-std::atomic<uint64_t> L2Builder::BytesSentToStorage_(0);
-std::atomic<uint64_t> L2Builder::EventsSentToStorage_(0);
-
 uint L2Builder::downscaleFactor_ = 0;
 
 bool L2Builder::buildEvent(cream::LkrFragment* fragment) {
@@ -42,16 +41,46 @@ bool L2Builder::buildEvent(cream::LkrFragment* fragment) {
 	 * Add new packet to EventCollector
 	 */
 	if (event->addLkrFragment(fragment, etherFrame->ip.saddr)) {
+		EventTracer::stamp(event, EventTracer::LKrComplete);
+
 		/*
 		 * This event is complete -> process it
 		 */
-		processL2(event);
+		if (TriggerTask::IsEnabled() && !EventPipeline::L2.isQueued()) {
+			TriggerTask::enqueue(event, TriggerTask::L2);
+		} else {
+			EventPipeline::L2.push(event);
+		}
 		return true;
 	}
 	return false;
 }
 
 void L2Builder::processL2(Event *event) {
+	processL2(&event, 1);
+}
+
+void L2Builder::processL2(Event** events, const uint numberOfEvents) {
+	const uint chunkSize = 64;
+	Event* acceptedEvents[chunkSize];
+
+	for (uint first = 0; first < numberOfEvents; first += chunkSize) {
+		const uint chunkEvents = std::min(chunkSize, numberOfEvents - first);
+
+		uint numberOfAcceptedEvents = 0;
+		for (uint i = 0; i != chunkEvents; i++) {
+			if (computeL2(events[first + i])) {
+				acceptedEvents[numberOfAcceptedEvents++] = events[first + i];
+			}
+		}
+
+		if (numberOfAcceptedEvents != 0) {
+			EventPipeline::Storage.push(acceptedEvents, numberOfAcceptedEvents);
+		}
+	}
+}
+
+bool L2Builder::computeL2(Event* event) {
 	if (!event->isWaitingForNonZSuppressedLKrData()) {
 		/*
 		 * L1 already passed but non zero suppressed LKr data not yet requested -> Process Level 2 trigger
@@ -64,32 +93,37 @@ void L2Builder::processL2(Event *event) {
 		 * Event has been processed and saved or rejected -> destroy, don't delete so that it can be reused if
 		 * during L2 no non zero suppressed LKr data has been requested
 		 */
-		if (!event->isWaitingForNonZSuppressedLKrData()) {
-			if (event->isL2Accepted()) {
-				/*
-				 * Send Event to merger
-				 */
-				BytesSentToStorage_.fetch_add(StorageHandler::SendEvent(event),
-						std::memory_order_relaxed);
-				;
-				EventsSentToStorage_.fetch_add(1, std::memory_order_relaxed);
-			}
-			L2Triggers_[L2Trigger].fetch_add(1, std::memory_order_relaxed);
-			EventPool::FreeEvent(event);
+		if (event->isWaitingForNonZSuppressedLKrData()) {
+			return false;
 		}
+		ThreadCounters::increment(ThreadCounters::L2_TRIGGERS + L2Trigger);
 	} else {
 		uint8_t L2Trigger = L2TriggerProcessor::onNonZSuppressedLKrDataReceived(
 				event);
 
 		event->setL2Processed(L2Trigger);
-		if (event->isL2Accepted()) {
-			BytesSentToStorage_.fetch_add(StorageHandler::SendEvent(event),
-					std::memory_order_relaxed);
-			EventsSentToStorage_.fetch_add(1, std::memory_order_relaxed);
-		}
-		L2Triggers_[L2Trigger].fetch_add(1, std::memory_order_relaxed);
-		EventPool::FreeEvent(event);
+		ThreadCounters::increment(ThreadCounters::L2_TRIGGERS + L2Trigger);
+	}
+
+	EventTracer::stamp(event, EventTracer::L2Decision);
+	if (event->isL2Accepted()) {
+		return true;
+	}
+	EventTracer::finishRejected(event);
+	EventPool::FreeEvent(event);
+	return false;
+}
+
+void L2Builder::sendToStorage(Event** events, const uint numberOfEvents) {
+	uint64_t bytesSent = 0;
+	for (uint i = 0; i != numberOfEvents; i++) {
+		/*
+		 * Send Event to merger. The StorageHandler frees the event
+		 */
+		bytesSent += StorageHandler::SendEvent(events[i]);
 	}
+	ThreadCounters::add(ThreadCounters::BYTES_SENT_TO_STORAGE, bytesSent);
+	ThreadCounters::add(ThreadCounters::EVENTS_SENT_TO_STORAGE, numberOfEvents);
 }
 }
 /* namespace na62 */
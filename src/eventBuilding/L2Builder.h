@@ -8,9 +8,11 @@
 #ifndef L2BUILDER_H_
 #define L2BUILDER_H_
 
+#include <sys/types.h>
 #include <atomic>
 #include <cstdint>
 
+#include "../monitoring/ThreadCounters.h"
 #include "../options/MyOptions.h"
 namespace na62 {
 class Event;
@@ -23,13 +25,15 @@ namespace na62 {
 
 class L2Builder {
 private:
-	static std::atomic<uint64_t>* L2Triggers_;
-
-	static std::atomic<uint64_t> BytesSentToStorage_;
-	static std::atomic<uint64_t> EventsSentToStorage_;
-
 	static uint downscaleFactor_;
 
+	/**
+	 * Processes the L2 trigger algorithm. Rejected events are freed
+	 *
+	 * @return <true> if the event has been accepted and should be sent to the mergers
+	 */
+	static bool computeL2(Event* event);
+
 public:
 	/**
 	 * Adds the fragment to the corresponding event and processes the L2 trigger
@@ -41,23 +45,31 @@ public:
 
 	static void processL2(Event *event);
 
-	static inline std::atomic<uint64_t>* GetL2TriggerStats() {
-		return L2Triggers_;
+	/**
+	 * Processes the L2 trigger algorithm of all events and passes the accepted ones
+	 * on to the storage stage
+	 */
+	static void processL2(Event** events, const uint numberOfEvents);
+
+	/**
+	 * Sends all events to the mergers
+	 */
+	static void sendToStorage(Event** events, const uint numberOfEvents);
+
+	static inline uint64_t GetL2TriggerStats(const uint8_t l2TriggerTypeWord) {
+		return ThreadCounters::sum(
+				ThreadCounters::L2_TRIGGERS + l2TriggerTypeWord);
 	}
 
 	static inline uint64_t GetBytesSentToStorage() {
-		return BytesSentToStorage_;
+		return ThreadCounters::sum(ThreadCounters::BYTES_SENT_TO_STORAGE);
 	}
 
 	static inline uint64_t GetEventsSentToStorage() {
-		return EventsSentToStorage_;
+		return ThreadCounters::sum(ThreadCounters::EVENTS_SENT_TO_STORAGE);
 	}
 
 	static void initialize() {
-		for (int i = 0; i != 0xFF + 1; i++) {
-			L2Triggers_[i] = 0;
-		}
-
 		downscaleFactor_ = Options::GetInt(OPTION_L2_DOWNSCALE_FACTOR);
 	}
 };
@@ -0,0 +1,299 @@
+/*
+ * MergerSender.cpp
+ *
+ *  Created on: Oct 16, 2026
+ *      Author: Jonas Kunze (kunze.jonas@gmail.com)
+ */
+
+#include "MergerSender.h"
+
+#include <asm-generic/errno-base.h>
+#include <socket/ZMQHandler.h>
+#include <zmq.h>
+#include <algorithm>
+#include <chrono>
+
+#include <options/Logging.h>
+#include <options/Options.h>
+
+#include "../options/MyOptions.h"
+#include "EventBatcher.h"
+#include "EventTracer.h"
+#include "OutputCompressor.h"
+
+namespace na62 {
+
+std::vector<MergerSender*> MergerSender::senders_;
+
+std::shared_ptr<const std::vector<std::string>> MergerSender::mergerAddresses_;
+std::atomic<uint> MergerSender::mergerGeneration_(0);
+
+std::atomic<uint64_t> MergerSender::queuedEvents_(0);
+uint MergerSender::highWatermark_;
+uint MergerSender::lowWatermark_;
+std::atomic<bool> MergerSender::closed_(false);
+
+std::atomic<uint64_t> MergerSender::eventsSent_(0);
+std::atomic<uint64_t> MergerSender::eventsDropped_(0);
+std::atomic<uint64_t> MergerSender::messagesSent_(0);
+
+uint MergerSender::maxBatchBytes_;
+uint MergerSender::maxBatchAgeMicros_;
+
+MergerSender::MergerSender(uint senderNum) :
+		senderNum_(senderNum), running_(true), socketGeneration_(0), batcher_(
+				nullptr) {
+	if (maxBatchBytes_ != 0) {
+		batcher_ = new EventBatcher(maxBatchBytes_);
+	}
+}
+
+MergerSender::~MergerSender() {
+	delete batcher_;
+}
+
+void MergerSender::initialize() {
+	highWatermark_ = Options::GetInt(OPTION_OUTPUT_QUEUE_HIGH_WATERMARK);
+	lowWatermark_ = std::min(highWatermark_,
+			(uint) Options::GetInt(OPTION_OUTPUT_QUEUE_LOW_WATERMARK));
+	maxBatchBytes_ = Options::GetInt(OPTION_OUTPUT_BATCH_SIZE);
+	maxBatchAgeMicros_ = Options::GetInt(OPTION_OUTPUT_BATCH_MAX_AGE);
+
+	const uint numberOfSenders = std::max(1,
+			Options::GetInt(OPTION_NUMBER_OF_MERGER_SENDERS));
+	for (uint senderNum = 0; senderNum != numberOfSenders; senderNum++) {
+		MergerSender* sender = new MergerSender(senderNum);
+		senders_.push_back(sender);
+		sender->startThread("MergerSender");
+	}
+}
+
+void MergerSender::setMergerAddresses(
+		const std::vector<std::string>& addresses) {
+	std::shared_ptr<const std::vector<std::string>> newAddresses = std::make_shared<
+			const std::vector<std::string>>(addresses);
+	std::atomic_store(&mergerAddresses_, newAddresses);
+	mergerGeneration_.fetch_add(1, std::memory_order_release);
+}
+
+bool MergerSender::enqueueEvent(OutgoingEvent* event, const uint eventNumber,
+		const bool force) {
+	if (!force) {
+		if (closed_) {
+			return false;
+		}
+		if (queuedEvents_ >= highWatermark_) {
+			closed_ = true;
+			LOG_ERROR<< "Merger output queues are full: Spooling events" << ENDL;
+			return false;
+		}
+	}
+	queuedEvents_.fetch_add(1, std::memory_order_relaxed);
+	MergerSender* sender = senders_[eventNumber % senders_.size()];
+	{
+		std::lock_guard<std::mutex> lock(sender->eventsMutex_);
+		sender->events_.push_back(event);
+	}
+	sender->eventsAvailable_.notify_one();
+	return true;
+}
+
+void MergerSender::stopAll() {
+	for (MergerSender* sender : senders_) {
+		sender->onInterruption();
+	}
+}
+
+void MergerSender::connectToMergers() {
+	destroySockets();
+
+	socketGeneration_ = mergerGeneration_.load(std::memory_order_acquire);
+	std::shared_ptr<const std::vector<std::string>> addresses =
+			std::atomic_load(&mergerAddresses_);
+	if (!addresses) {
+		return;
+	}
+
+	for (const std::string& address : *addresses) {
+		LOG_INFO<< "Sender " << senderNum_ << " connecting to merger: " << address << ENDL;
+		zmq::socket_t* socket = ZMQHandler::GenerateSocket("MergerSender", ZMQ_PUSH);
+		socket->connect(address.c_str());
+		sockets_.push_back(socket);
+	}
+}
+
+void MergerSender::destroySockets() {
+	for (auto socket : sockets_) {
+		ZMQHandler::DestroySocket(socket);
+	}
+	sockets_.clear();
+}
+
+void MergerSender::dropEvent(OutgoingEvent* event, uint firstPart) {
+	for (uint partNum = firstPart; partNum < event->parts.size(); partNum++) {
+		const OutgoingPart& part = event->parts[partNum];
+		part.freeFn(part.data, part.hint);
+	}
+	delete event;
+}
+
+bool MergerSender::sendEvent(OutgoingEvent* event) {
+	zmq::socket_t* socket = sockets_[event->burstID % sockets_.size()];
+
+	for (uint partNum = 0; partNum != event->parts.size(); partNum++) {
+		const OutgoingPart& part = event->parts[partNum];
+		/*
+		 * The message calls the free function as soon as ZMQ has sent it
+		 */
+		zmq::message_t zmqMessage(part.data, part.length, part.freeFn,
+				part.hint);
+		const int flags = partNum + 1 == event->parts.size() ? 0 : ZMQ_SNDMORE;
+
+		bool sent = false;
+		while (!sent && ZMQHandler::IsRunning()) {
+			try {
+				socket->send(zmqMessage, flags);
+				sent = true;
+			} catch (const zmq::error_t& ex) {
+				if (ex.num() != EINTR) { // try again if EINTR (signal caught)
+					LOG_ERROR << ex.what() << ENDL;
+					break;
+				}
+			}
+		}
+		if (!sent) {
+			dropEvent(event, partNum + 1);
+			return false;
+		}
+	}
+	delete event;
+	return true;
+}
+
+void MergerSender::transmit(OutgoingEvent* message,
+		const uint numberOfEvents) {
+	if (socketGeneration_ != mergerGeneration_.load(std::memory_order_acquire)
+			|| sockets_.empty()) {
+		connectToMergers();
+	}
+
+	if (sockets_.empty() || !running_) {
+		eventsDropped_.fetch_add(numberOfEvents, std::memory_order_relaxed);
+		dropEvent(message, 0);
+		return;
+	}
+
+	if (OutputCompressor::IsEnabled()) {
+		message = OutputCompressor::compress(message);
+	}
+
+	if (sendEvent(message)) {
+		eventsSent_.fetch_add(numberOfEvents, std::memory_order_relaxed);
+		messagesSent_.fetch_add(1, std::memory_order_relaxed);
+	} else {
+		/*
+		 * Reconnect with the next message
+		 */
+		eventsDropped_.fetch_add(numberOfEvents, std::memory_order_relaxed);
+		destroySockets();
+	}
+}
+
+void MergerSender::flushBatch() {
+	const uint numberOfEvents = batcher_->getNumberOfEvents();
+	transmit(batcher_->finishBatch(), numberOfEvents);
+}
+
+OutgoingEvent* MergerSender::popEvent(const bool withTimeout,
+		const uint64_t timeoutMicros) {
+	std::unique_lock<std::mutex> lock(eventsMutex_);
+	auto eventOrStop = [this]() {
+		return !events_.empty() || !running_;
+	};
+	if (withTimeout) {
+		eventsAvailable_.wait_for(lock,
+				std::chrono::microseconds(timeoutMicros), eventOrStop);
+	} else {
+		eventsAvailable_.wait(lock, eventOrStop);
+	}
+
+	if (events_.empty() || !running_) {
+		return nullptr;
+	}
+	OutgoingEvent* event = events_.front();
+	events_.pop_front();
+	return event;
+}
+
+void MergerSender::thread() {
+	OutgoingEvent* event;
+	while (running_) {
+		if (batcher_ == nullptr || batcher_->isEmpty()) {
+			event = popEvent(false, 0);
+		} else {
+			/*
+			 * Wait for more events at most until the batch is too old
+			 */
+			const uint64_t age = batcher_->getAgeMicros();
+			event = popEvent(true,
+					age < maxBatchAgeMicros_ ? maxBatchAgeMicros_ - age : 0);
+			if (event == nullptr) {
+				if (running_ && batcher_->getAgeMicros() >= maxBatchAgeMicros_) {
+					flushBatch();
+				}
+				continue;
+			}
+		}
+		if (event == nullptr) {
+			continue;
+		}
+		queuedEvents_.fetch_sub(1, std::memory_order_relaxed);
+		EventTracer::stamp(event->eventNumber, event->burstID,
+				EventTracer::SentToMerger);
+
+		if (batcher_ == nullptr) {
+			transmit(event, 1);
+			continue;
+		}
+
+		if (!batcher_->isEmpty() && batcher_->getBurstID() != event->burstID) {
+			flushBatch();
+		}
+		batcher_->addEvent(event);
+		if (batcher_->getBatchBytes() >= maxBatchBytes_) {
+			flushBatch();
+		}
+	}
+
+	if (batcher_ != nullptr && !batcher_->isEmpty()) {
+		eventsDropped_.fetch_add(batcher_->getNumberOfEvents(),
+				std::memory_order_relaxed);
+		dropEvent(batcher_->finishBatch(), 0);
+	}
+
+	/*
+	 * Release the data of all events that have not been sent
+	 */
+	std::deque<OutgoingEvent*> unsentEvents;
+	{
+		std::lock_guard<std::mutex> lock(eventsMutex_);
+		unsentEvents.swap(events_);
+	}
+	for (OutgoingEvent* unsentEvent : unsentEvents) {
+		queuedEvents_.fetch_sub(1, std::memory_order_relaxed);
+		eventsDropped_.fetch_add(1, std::memory_order_relaxed);
+		dropEvent(unsentEvent, 0);
+	}
+	destroySockets();
+	LOG_INFO<< "Stopping merger sender " << senderNum_ << ENDL;
+}
+
+void MergerSender::onInterruption() {
+	{
+		std::lock_guard<std::mutex> lock(eventsMutex_);
+		running_ = false;
+	}
+	eventsAvailable_.notify_all();
+}
+
+} /* namespace na62 */
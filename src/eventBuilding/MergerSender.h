@@ -0,0 +1,208 @@
+/*
+ * MergerSender.h
+ *
+ *  Created on: Oct 16, 2026
+ *      Author: Jonas Kunze (kunze.jonas@gmail.com)
+ */
+
+#pragma once
+#ifndef MERGERSENDER_H_
+#define MERGERSENDER_H_
+
+#include <sys/types.h>
+#include <utils/AExecutable.h>
+#include <zmq.hpp>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace na62 {
+
+class EventBatcher;
+
+/*
+ * One part of a serialized event. freeFn is called with data and hint as soon as the part is
+ * not needed anymore, either by ZMQ after sending it or by the sender if it is dropped
+ */
+struct OutgoingPart {
+	void* data;
+	uint length;
+	zmq::free_fn* freeFn;
+	void* hint;
+};
+
+/*
+ * A single serialized event or a message containing several events (eventNumber 0)
+ */
+struct OutgoingEvent {
+	uint burstID;
+	uint eventNumber;
+	std::vector<OutgoingPart> parts;
+};
+
+/*
+ * Thread sending serialized events to the mergers.
+ *
+ * Every sender owns its own sockets to all mergers and is fed by its own queue so that the
+ * TBB workers only enqueue the events and never wait for the network. The merger list is
+ * published as an immutable address list: Every sender reconnects as soon as it sees a new
+ * generation without any lock on the send path.
+ *
+ * If outputBatchSize is set the events of one burst are packed into multi event messages
+ * which are sent as soon as they reach that size, get older than outputBatchMaxAge or the
+ * burst changes.
+ */
+class MergerSender: public AExecutable {
+public:
+	MergerSender(uint senderNum);
+	virtual ~MergerSender();
+
+	/**
+	 * Starts the configured number of sender threads
+	 */
+	static void initialize();
+
+	/**
+	 * Publishes a new list of merger addresses. The senders connect to the new mergers
+	 * before sending their next event
+	 */
+	static void setMergerAddresses(const std::vector<std::string>& addresses);
+
+	/**
+	 * Passes the event to one of the senders. The event is deleted after sending.
+	 *
+	 * As soon as the high watermark of queued events is reached the queues are closed for new
+	 * events until the EventSpool has replayed all spooled events and the queues are below
+	 * the low watermark again.
+	 *
+	 * @param force Enqueue the event even if the queues are closed. Used by the EventSpool
+	 *
+	 * @return false if the event has not been enqueued and should be spooled
+	 */
+	static bool enqueueEvent(OutgoingEvent* event, const uint eventNumber,
+			const bool force = false);
+
+	/**
+	 * Accept new events again after the spool has been drained
+	 */
+	static void reopen() {
+		closed_ = false;
+	}
+
+	static bool IsClosed() {
+		return closed_;
+	}
+
+	static uint GetLowWatermark() {
+		return lowWatermark_;
+	}
+
+	/**
+	 * Stops all senders. Events that have not been sent yet are dropped
+	 */
+	static void stopAll();
+
+	static uint64_t GetNumberOfQueuedEvents() {
+		return queuedEvents_;
+	}
+
+	static uint64_t GetEventsSent() {
+		return eventsSent_;
+	}
+
+	static uint64_t GetEventsDropped() {
+		return eventsDropped_;
+	}
+
+	/*
+	 * Number of ZMQ messages sent. Equals the number of events sent without batching
+	 */
+	static uint64_t GetMessagesSent() {
+		return messagesSent_;
+	}
+
+private:
+	uint senderNum_;
+
+	/*
+	 * Written under eventsMutex_ so that a waiting sender cannot miss the stop, read without
+	 * the lock on the send path
+	 */
+	std::atomic<bool> running_;
+
+	/*
+	 * A plain queue with a condition variable instead of a concurrent_bounded_queue so that
+	 * the sender can wait for new events until its batch gets too old
+	 */
+	std::mutex eventsMutex_;
+	std::condition_variable eventsAvailable_;
+	std::deque<OutgoingEvent*> events_;
+
+	/*
+	 * The sockets connected to the mergers of generation socketGeneration_
+	 */
+	std::vector<zmq::socket_t*> sockets_;
+	uint socketGeneration_;
+
+	/*
+	 * nullptr if batching is disabled
+	 */
+	EventBatcher* batcher_;
+	static uint maxBatchBytes_;
+	static uint maxBatchAgeMicros_;
+
+	static std::vector<MergerSender*> senders_;
+
+	static std::shared_ptr<const std::vector<std::string>> mergerAddresses_;
+	static std::atomic<uint> mergerGeneration_;
+
+	static std::atomic<uint64_t> queuedEvents_;
+	static uint highWatermark_;
+	static uint lowWatermark_;
+	static std::atomic<bool> closed_;
+
+	static std::atomic<uint64_t> eventsSent_;
+	static std::atomic<uint64_t> eventsDropped_;
+	static std::atomic<uint64_t> messagesSent_;
+
+	void thread();
+	void onInterruption();
+
+	void connectToMergers();
+	void destroySockets();
+
+	/**
+	 * Waits until an event is queued or the sender is stopped
+	 *
+	 * @param timeoutMicros Maximum time to wait if withTimeout is true
+	 *
+	 * @return nullptr if the timeout has passed or the sender is stopped
+	 */
+	OutgoingEvent* popEvent(const bool withTimeout, const uint64_t timeoutMicros);
+
+	/**
+	 * @return false if the event could not be sent
+	 */
+	bool sendEvent(OutgoingEvent* event);
+
+	/**
+	 * Sends the message containing numberOfEvents events or drops it if no merger is available
+	 */
+	void transmit(OutgoingEvent* message, const uint numberOfEvents);
+
+	void flushBatch();
+
+	/**
+	 * Calls the free functions of the parts starting at firstPart and deletes the event
+	 */
+	static void dropEvent(OutgoingEvent* event, uint firstPart);
+};
+
+} /* namespace na62 */
+
+#endif /* MERGERSENDER_H_ */
@@ -0,0 +1,103 @@
+/*
+ * OutputBufferPool.cpp
+ *
+ *  Created on: Oct 16, 2026
+ *      Author: Jonas Kunze (kunze.jonas@gmail.com)
+ */
+
+#include "OutputBufferPool.h"
+
+#include <algorithm>
+
+#include <options/Options.h>
+
+#include "../options/MyOptions.h"
+
+namespace na62 {
+
+const uint OutputBufferPool::MIN_BUFFER_SIZE_LOG2;
+const uint OutputBufferPool::NUMBER_OF_SIZE_CLASSES;
+
+OutputBufferPool::FreeList OutputBufferPool::freeLists_[0x100][NUMBER_OF_SIZE_CLASSES];
+OutputBufferPool::FreeList OutputBufferPool::internalFreeLists_[NUMBER_OF_INTERNAL_POOLS][NUMBER_OF_SIZE_CLASSES];
+
+std::atomic<uint64_t> OutputBufferPool::hits_(0);
+std::atomic<uint64_t> OutputBufferPool::misses_(0);
+std::atomic<uint64_t> OutputBufferPool::buffersCached_(0);
+
+void OutputBufferPool::initialize() {
+	/*
+	 * Limit the memory of every free list but keep at least a few buffers of each size
+	 */
+	const uint cacheBytes = Options::GetInt(OPTION_OUTPUT_BUFFER_CACHE_SIZE);
+	for (auto& freeLists : freeLists_) {
+		initializeFreeLists(freeLists, cacheBytes);
+	}
+	for (auto& freeLists : internalFreeLists_) {
+		initializeFreeLists(freeLists, cacheBytes);
+	}
+}
+
+void OutputBufferPool::initializeFreeLists(FreeList* freeLists,
+		const uint cacheBytes) {
+	for (uint sizeClass = 0; sizeClass != NUMBER_OF_SIZE_CLASSES; sizeClass++) {
+		FreeList& list = freeLists[sizeClass];
+		list.bufferSize = 1u << (MIN_BUFFER_SIZE_LOG2 + sizeClass);
+		list.maxBuffers = std::max(4u, cacheBytes / list.bufferSize);
+	}
+}
+
+char* OutputBufferPool::takeBuffer(FreeList* freeLists, const uint size,
+		void*& freeHint) {
+	const uint sizeClass = getSizeClass(size);
+	if (sizeClass >= NUMBER_OF_SIZE_CLASSES) {
+		freeHint = nullptr;
+		return nullptr;
+	}
+
+	FreeList& list = freeLists[sizeClass];
+	freeHint = &list;
+	tbb::spin_mutex::scoped_lock my_lock(list.mutex);
+	if (list.buffers.empty()) {
+		return nullptr;
+	}
+	char* buffer = list.buffers.back();
+	list.buffers.pop_back();
+	buffersCached_.fetch_sub(1, std::memory_order_relaxed);
+	return buffer;
+}
+
+char* OutputBufferPool::getBuffer(const uint8_t triggerType, const uint size,
+		void*& freeHint) {
+	char* buffer = takeBuffer(freeLists_[triggerType], size, freeHint);
+	if (buffer != nullptr) {
+		hits_.fetch_add(1, std::memory_order_relaxed);
+		return buffer;
+	}
+	misses_.fetch_add(1, std::memory_order_relaxed);
+	return allocateBuffer(size, freeHint);
+}
+
+char* OutputBufferPool::getInternalBuffer(const InternalPool pool,
+		const uint size, void*& freeHint) {
+	char* buffer = takeBuffer(internalFreeLists_[pool], size, freeHint);
+	if (buffer != nullptr) {
+		return buffer;
+	}
+	return allocateBuffer(size, freeHint);
+}
+
+void OutputBufferPool::freeBuffer(void* data, void* hint) {
+	FreeList* list = (FreeList*) hint;
+	if (list != nullptr) {
+		tbb::spin_mutex::scoped_lock my_lock(list->mutex);
+		if (list->buffers.size() < list->maxBuffers) {
+			list->buffers.push_back((char*) data);
+			buffersCached_.fetch_add(1, std::memory_order_relaxed);
+			return;
+		}
+	}
+	delete[] (char*) data;
+}
+
+} /* namespace na62 */
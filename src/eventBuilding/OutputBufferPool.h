@@ -0,0 +1,123 @@
+/*
+ * OutputBufferPool.h
+ *
+ *  Created on: Oct 16, 2026
+ *      Author: Jonas Kunze (kunze.jonas@gmail.com)
+ */
+
+#pragma once
+#ifndef OUTPUTBUFFERPOOL_H_
+#define OUTPUTBUFFERPOOL_H_
+
+#include <sys/types.h>
+#include <tbb/spin_mutex.h>
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+namespace na62 {
+
+/*
+ * Pool of the buffers serialized events are written to before they are sent to the merger.
+ *
+ * The buffers are organized in power of two size classes from 1 kB to 2 MB. Every trigger
+ * type has its own free lists as calibration and physics events have very different sizes.
+ * Buffers not holding a single event (batches, compressed messages) have separate free lists
+ * per InternalPool so that they neither compete with the events nor show up in the hit rate.
+ * The buffers are returned to their free list by freeBuffer which is used as ZMQ free callback.
+ */
+class OutputBufferPool {
+public:
+	enum InternalPool {
+		EVENT_BATCHES = 0, COMPRESSED_MESSAGES = 1, NUMBER_OF_INTERNAL_POOLS = 2
+	};
+
+	static void initialize();
+
+	/**
+	 * @param freeHint Set to the hint that has to be passed to freeBuffer together with the
+	 * returned buffer
+	 *
+	 * @return A buffer of at least size bytes
+	 */
+	static char* getBuffer(const uint8_t triggerType, const uint size,
+			void*& freeHint);
+
+	/**
+	 * Same as getBuffer but for the buffers used by the merger output stages. Not counted in
+	 * GetHits/GetMisses
+	 */
+	static char* getInternalBuffer(const InternalPool pool, const uint size,
+			void*& freeHint);
+
+	/**
+	 * Returns the buffer to its free list or deletes it if the list is full. Can be passed to
+	 * zmq::message_t as free function
+	 */
+	static void freeBuffer(void* data, void* hint);
+
+	/*
+	 * Number of event buffers taken from a free list
+	 */
+	static uint64_t GetHits() {
+		return hits_;
+	}
+
+	/*
+	 * Number of event buffers that had to be allocated
+	 */
+	static uint64_t GetMisses() {
+		return misses_;
+	}
+
+	static uint64_t GetBuffersCached() {
+		return buffersCached_;
+	}
+
+private:
+	struct FreeList {
+		tbb::spin_mutex mutex;
+		std::vector<char*> buffers;
+		uint bufferSize;
+		uint maxBuffers;
+	};
+
+	static const uint MIN_BUFFER_SIZE_LOG2 = 10;
+	static const uint NUMBER_OF_SIZE_CLASSES = 12;
+
+	static FreeList freeLists_[0x100][NUMBER_OF_SIZE_CLASSES];
+	static FreeList internalFreeLists_[NUMBER_OF_INTERNAL_POOLS][NUMBER_OF_SIZE_CLASSES];
+
+	static std::atomic<uint64_t> hits_;
+	static std::atomic<uint64_t> misses_;
+	static std::atomic<uint64_t> buffersCached_;
+
+	/**
+	 * @param freeLists The free lists of all size classes of one trigger type or internal pool
+	 * @return nullptr if no buffer was cached
+	 */
+	static char* takeBuffer(FreeList* freeLists, const uint size,
+			void*& freeHint);
+
+	static void initializeFreeLists(FreeList* freeLists, const uint cacheBytes);
+
+	/**
+	 * Allocates a new buffer fitting into the free list returned by takeBuffer
+	 */
+	static inline char* allocateBuffer(const uint size, void* freeHint) {
+		return new char[
+				freeHint == nullptr ? size : ((FreeList*) freeHint)->bufferSize];
+	}
+
+	static inline uint getSizeClass(const uint size) {
+		uint sizeClass = 0;
+		while ((1u << (MIN_BUFFER_SIZE_LOG2 + sizeClass)) < size) {
+			sizeClass++;
+		}
+		return sizeClass;
+	}
+};
+
+} /* namespace na62 */
+
+#endif /* OUTPUTBUFFERPOOL_H_ */
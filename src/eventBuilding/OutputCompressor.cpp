@@ -0,0 +1,129 @@
+/*
+ * OutputCompressor.cpp
+ *
+ *  Created on: Oct 16, 2026
+ *      Author: Jonas Kunze (kunze.jonas@gmail.com)
+ */
+
+#include "OutputCompressor.h"
+
+#include <lz4.h>
+#include <lz4hc.h>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <vector>
+
+#include <options/Logging.h>
+#include <options/Options.h>
+
+#include "../options/MyOptions.h"
+#include "MergerSender.h"
+#include "OutputBufferPool.h"
+
+namespace na62 {
+
+uint OutputCompressor::level_ = 0;
+uint OutputCompressor::acceleration_ = 1;
+
+std::atomic<uint64_t> OutputCompressor::bytesIn_(0);
+std::atomic<uint64_t> OutputCompressor::bytesOut_(0);
+std::atomic<uint64_t> OutputCompressor::nanosSpent_(0);
+
+static uint64_t nowNanos() {
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(
+			std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void OutputCompressor::initialize() {
+	level_ = std::max(0, Options::GetInt(OPTION_OUTPUT_COMPRESSION_LEVEL));
+	acceleration_ = std::max(1,
+			Options::GetInt(OPTION_OUTPUT_COMPRESSION_ACCELERATION));
+	if (level_ != 0) {
+		LOG_INFO<< "Compressing merger output with " << (level_ == 1 ? "LZ4" : "LZ4HC")
+		<< " level " << level_ << ENDL;
+	}
+}
+
+OutgoingEvent* OutputCompressor::compress(OutgoingEvent* message) {
+	const uint64_t start = nowNanos();
+
+	uint uncompressedLength = 0;
+	for (const OutgoingPart& part : message->parts) {
+		uncompressedLength += part.length;
+	}
+
+	/*
+	 * LZ4 needs contiguous input -> gather multipart messages in a per thread buffer
+	 */
+	const char* input;
+	static thread_local std::vector<char> gatherBuffer;
+	if (message->parts.size() == 1) {
+		input = (const char*) message->parts[0].data;
+	} else {
+		gatherBuffer.resize(uncompressedLength);
+		uint offset = 0;
+		for (const OutgoingPart& part : message->parts) {
+			memcpy(gatherBuffer.data() + offset, part.data, part.length);
+			offset += part.length;
+		}
+		input = gatherBuffer.data();
+	}
+
+	const uint capacity = sizeof(COMPRESSED_MESSAGE_HDR)
+			+ LZ4_compressBound(uncompressedLength);
+	void* freeHint;
+	char* buffer = OutputBufferPool::getInternalBuffer(
+			OutputBufferPool::COMPRESSED_MESSAGES, capacity, freeHint);
+	char* output = buffer + sizeof(COMPRESSED_MESSAGE_HDR);
+	const int outputCapacity = capacity - sizeof(COMPRESSED_MESSAGE_HDR);
+
+	int compressedLength;
+	if (level_ == 1) {
+		compressedLength = LZ4_compress_fast(input, output, uncompressedLength,
+				outputCapacity, acceleration_);
+	} else {
+		compressedLength = LZ4_compress_HC(input, output, uncompressedLength,
+				outputCapacity, level_);
+	}
+
+	bytesIn_.fetch_add(uncompressedLength, std::memory_order_relaxed);
+
+	if (compressedLength <= 0
+			|| compressedLength + sizeof(COMPRESSED_MESSAGE_HDR)
+					>= uncompressedLength) {
+		OutputBufferPool::freeBuffer(buffer, freeHint);
+		bytesOut_.fetch_add(uncompressedLength, std::memory_order_relaxed);
+		nanosSpent_.fetch_add(nowNanos() - start, std::memory_order_relaxed);
+		return message;
+	}
+
+	COMPRESSED_MESSAGE_HDR* hdr = (COMPRESSED_MESSAGE_HDR*) buffer;
+	hdr->magic = COMPRESSED_MESSAGE_MAGIC;
+	hdr->codec = level_ == 1 ? CODEC_LZ4 : CODEC_LZ4HC;
+	hdr->level = level_ == 1 ? acceleration_ : level_;
+	hdr->reserved = 0;
+	hdr->uncompressedLength = uncompressedLength;
+	hdr->compressedLength = compressedLength;
+
+	OutgoingEvent* compressed = new OutgoingEvent();
+	compressed->burstID = message->burstID;
+	compressed->eventNumber = message->eventNumber;
+	compressed->parts.push_back( { buffer, (uint) (sizeof(COMPRESSED_MESSAGE_HDR)
+			+ compressedLength), (zmq::free_fn*) OutputBufferPool::freeBuffer,
+			freeHint });
+
+	/*
+	 * The original data is not needed anymore
+	 */
+	for (const OutgoingPart& part : message->parts) {
+		part.freeFn(part.data, part.hint);
+	}
+	delete message;
+
+	bytesOut_.fetch_add(compressed->parts[0].length, std::memory_order_relaxed);
+	nanosSpent_.fetch_add(nowNanos() - start, std::memory_order_relaxed);
+	return compressed;
+}
+
+} /* namespace na62 */
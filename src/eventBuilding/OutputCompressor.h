@@ -0,0 +1,89 @@
+/*
+ * OutputCompressor.h
+ *
+ *  Created on: Oct 16, 2026
+ *      Author: Jonas Kunze (kunze.jonas@gmail.com)
+ */
+
+#pragma once
+#ifndef OUTPUTCOMPRESSOR_H_
+#define OUTPUTCOMPRESSOR_H_
+
+#include <sys/types.h>
+#include <atomic>
+#include <cstdint>
+
+/*
+ * The upper byte differs from the format byte of EVENT_HDR and from EVENT_BATCH_MAGIC
+ */
+#define COMPRESSED_MESSAGE_MAGIC 0xC04D5A62
+
+namespace na62 {
+
+struct OutgoingEvent;
+
+/*
+ * Header of a compressed merger message. It is followed by compressedLength bytes which
+ * decompress to the original message: A single event or an EVENT_BATCH_HDR batch
+ */
+struct COMPRESSED_MESSAGE_HDR {
+	uint32_t magic;
+	uint8_t codec;
+	uint8_t level;
+	uint16_t reserved;
+	uint32_t uncompressedLength;
+	uint32_t compressedLength;
+}__attribute__ ((__packed__));
+
+/*
+ * Optional LZ4 compression of the messages sent to the mergers. Runs in the MergerSender
+ * threads on every message (single event or batch).
+ *
+ * outputCompressionLevel 1 uses the fast LZ4 compressor with outputCompressionAcceleration,
+ * higher levels use LZ4HC with that level. Messages that do not get smaller are sent unchanged.
+ */
+class OutputCompressor {
+public:
+	enum Codec
+		: uint8_t {
+			CODEC_LZ4 = 1, CODEC_LZ4HC = 2
+	};
+
+	static void initialize();
+
+	static bool IsEnabled() {
+		return level_ != 0;
+	}
+
+	/**
+	 * Compresses all parts of the message into one pooled buffer. The parts of the original
+	 * message are released
+	 *
+	 * @return The compressed message or the original one if compression does not pay off
+	 */
+	static OutgoingEvent* compress(OutgoingEvent* message);
+
+	static uint64_t GetBytesIn() {
+		return bytesIn_;
+	}
+
+	static uint64_t GetBytesOut() {
+		return bytesOut_;
+	}
+
+	static uint64_t GetNanosSpent() {
+		return nanosSpent_;
+	}
+
+private:
+	static uint level_;
+	static uint acceleration_;
+
+	static std::atomic<uint64_t> bytesIn_;
+	static std::atomic<uint64_t> bytesOut_;
+	static std::atomic<uint64_t> nanosSpent_;
+};
+
+} /* namespace na62 */
+
+#endif /* OUTPUTCOMPRESSOR_H_ */
@@ -0,0 +1,151 @@
+/*
+ * PipelineStage.cpp
+ *
+ *  Created on: Oct 16, 2026
+ *      Author: Jonas Kunze (kunze.jonas@gmail.com)
+ */
+
+#include "PipelineStage.h"
+
+#include <tbb/task.h>
+#include <algorithm>
+#include <chrono>
+
+#include "../topology/NodeArena.h"
+
+namespace na62 {
+
+/*
+ * Maximum number of events a worker takes from the queue at once
+ */
+#define MAX_EVENTS_PER_DRAIN 64
+
+class PipelineStageTask: public tbb::task {
+public:
+	PipelineStageTask(PipelineStage* stage) :
+			stage_(stage) {
+	}
+
+	tbb::task* execute() {
+		stage_->drain();
+		return nullptr;
+	}
+
+private:
+	PipelineStage* stage_;
+};
+
+/*
+ * Functor running the worker within a NodeArena
+ */
+struct PipelineStageInArena {
+	PipelineStage* stage;
+
+	void operator()() const {
+		tbb::task::spawn_root_and_wait(
+				*new (tbb::task::allocate_root()) PipelineStageTask(stage));
+	}
+};
+
+thread_local uint64_t PipelineStage::nestedNanos_ = 0;
+
+static inline uint64_t nowNanos() {
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(
+			std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+PipelineStage::PipelineStage(std::string name, Processor processor) :
+		name_(name), processor_(processor), concurrency_(0), capacity_(0), queueDepth_(
+				0), activeWorkers_(0), eventsProcessed_(0), nanosSpent_(0), callerRuns_(
+				0) {
+}
+
+void PipelineStage::configure(const uint concurrency, const uint capacity) {
+	concurrency_ = concurrency;
+	capacity_ = std::max(1u, capacity);
+}
+
+void PipelineStage::process(Event** events, const uint numberOfEvents) {
+	/*
+	 * Stages running inline within this one must not be accounted twice
+	 */
+	const uint64_t outerNestedNanos = nestedNanos_;
+	nestedNanos_ = 0;
+
+	const uint64_t start = nowNanos();
+	processor_(events, numberOfEvents);
+	const uint64_t elapsed = nowNanos() - start;
+
+	nanosSpent_.fetch_add(elapsed - nestedNanos_, std::memory_order_relaxed);
+	nestedNanos_ = outerNestedNanos + elapsed;
+	eventsProcessed_.fetch_add(numberOfEvents, std::memory_order_relaxed);
+}
+
+void PipelineStage::push(Event** events, const uint numberOfEvents) {
+	if (concurrency_ == 0) {
+		process(events, numberOfEvents);
+		return;
+	}
+
+	/*
+	 * Backpressure: the caller does the work if the stage cannot keep up
+	 */
+	if (queueDepth_.load(std::memory_order_relaxed) + (int) numberOfEvents
+			> (int) capacity_) {
+		callerRuns_.fetch_add(1, std::memory_order_relaxed);
+		process(events, numberOfEvents);
+		return;
+	}
+
+	for (uint i = 0; i != numberOfEvents; i++) {
+		queue_.push(events[i]);
+	}
+	queueDepth_.fetch_add(numberOfEvents, std::memory_order_relaxed);
+	spawnWorker();
+}
+
+void PipelineStage::spawnWorker() {
+	uint active = activeWorkers_.load(std::memory_order_relaxed);
+	do {
+		if (active >= concurrency_) {
+			return;
+		}
+	} while (!activeWorkers_.compare_exchange_weak(active, active + 1));
+
+	NodeArena* arena = NodeArena::getCurrentThreadArena();
+	if (arena != nullptr) {
+		PipelineStageInArena functor = { this };
+		arena->enqueue(functor);
+	} else {
+		tbb::task::enqueue(
+				*new (tbb::task::allocate_root()) PipelineStageTask(this),
+				tbb::priority_t::priority_normal);
+	}
+}
+
+void PipelineStage::drain() {
+	Event* events[MAX_EVENTS_PER_DRAIN];
+	while (true) {
+		uint numberOfEvents = 0;
+		while (numberOfEvents != MAX_EVENTS_PER_DRAIN
+				&& queue_.try_pop(events[numberOfEvents])) {
+			numberOfEvents++;
+		}
+		if (numberOfEvents == 0) {
+			break;
+		}
+		queueDepth_.fetch_sub(numberOfEvents, std::memory_order_relaxed);
+		process(events, numberOfEvents);
+	}
+
+	activeWorkers_.fetch_sub(1);
+
+	/*
+	 * Events pushed after the last try_pop but before the decrement would not get a worker
+	 */
+	if (!queue_.empty()) {
+		spawnWorker();
+	}
+}
+
+} /* namespace na62 */
@@ -0,0 +1,110 @@
+/*
+ * PipelineStage.h
+ *
+ *  Created on: Oct 16, 2026
+ *      Author: Jonas Kunze (kunze.jonas@gmail.com)
+ */
+
+#pragma once
+#ifndef PIPELINESTAGE_H_
+#define PIPELINESTAGE_H_
+
+#include <sys/types.h>
+#include <tbb/concurrent_queue.h>
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+namespace na62 {
+class Event;
+
+/*
+ * One stage of the event processing pipeline (see EventPipeline).
+ *
+ * Events pushed to the stage are stored in a bounded queue and processed by at most
+ * concurrency TBB tasks. If the queue is full the pushing thread processes the events itself
+ * so that a slow stage slows down the previous ones instead of growing without limit.
+ * With a concurrency of 0 the events are always processed by the pushing thread.
+ */
+class PipelineStage {
+public:
+	typedef void (*Processor)(Event** events, const uint numberOfEvents);
+
+	PipelineStage(std::string name, Processor processor);
+
+	void configure(const uint concurrency, const uint capacity);
+
+	void push(Event* event) {
+		push(&event, 1);
+	}
+
+	void push(Event** events, const uint numberOfEvents);
+
+	/**
+	 * Processes queued events until the queue is empty. Called by the worker tasks
+	 */
+	void drain();
+
+	/**
+	 * @return <true> if events are queued and processed by worker tasks, <false> if the
+	 * stage runs inline
+	 */
+	bool isQueued() const {
+		return concurrency_ != 0;
+	}
+
+	const std::string& getName() const {
+		return name_;
+	}
+
+	uint getQueueDepth() const {
+		return std::max(0, queueDepth_.load(std::memory_order_relaxed));
+	}
+
+	uint64_t getEventsProcessed() const {
+		return eventsProcessed_;
+	}
+
+	uint64_t getNanosSpent() const {
+		return nanosSpent_;
+	}
+
+	/*
+	 * Number of times the pushing thread had to process the events as the queue was full
+	 */
+	uint64_t getCallerRuns() const {
+		return callerRuns_;
+	}
+
+private:
+	const std::string name_;
+	const Processor processor_;
+
+	uint concurrency_;
+	uint capacity_;
+
+	tbb::concurrent_queue<Event*> queue_;
+	std::atomic<int> queueDepth_;
+	std::atomic<uint> activeWorkers_;
+
+	std::atomic<uint64_t> eventsProcessed_;
+	std::atomic<uint64_t> nanosSpent_;
+	std::atomic<uint64_t> callerRuns_;
+
+	/*
+	 * Time spent by the calling thread in stages processed inline by the current stage
+	 */
+	static thread_local uint64_t nestedNanos_;
+
+	void process(Event** events, const uint numberOfEvents);
+
+	/**
+	 * Starts a new worker task if less than concurrency workers are active
+	 */
+	void spawnWorker();
+};
+
+} /* namespace na62 */
+
+#endif /* PIPELINESTAGE_H_ */
@@ -8,10 +8,11 @@
 #include "StorageHandler.h"
 
 #include <boost/algorithm/string.hpp>
+#include <algorithm>
 #include <asm-generic/errno-base.h>
 #include <eventBuilding/Event.h>
+#include <eventBuilding/EventPool.h>
 #include <eventBuilding/SourceIDManager.h>
-#include <tbb/spin_mutex.h>
 #include <sstream>
 
 #include <l0/MEPFragment.h>
@@ -30,15 +31,24 @@
 #include <glog/logging.h>
 
 #include "../options/MyOptions.h"
+#include "EventSpool.h"
+#include "MergerSender.h"
+#include "OutputBufferPool.h"
+#include "OutputCompressor.h"
 
 namespace na62 {
 
-std::vector<zmq::socket_t*> StorageHandler::mergerSockets_;
-
-std::atomic<uint> StorageHandler::InitialEventBufferSize_;
 int StorageHandler::TotalNumberOfDetectors_;
 
-tbb::spin_mutex StorageHandler::sendMutex_;
+bool StorageHandler::zeroCopyOutput_ = false;
+
+/*
+ * Payloads smaller than this are copied to the scratch buffer as a separate ZMQ part
+ * would be more expensive than the copy
+ */
+#define MIN_ZERO_COPY_BYTES 256
+
+static const char zeroPadding[4] = { 0, 0, 0, 0 };
 
 std::vector<std::string> StorageHandler::GetMergerAddresses(
 		std::string mergerList) {
@@ -63,19 +73,10 @@ std::vector<std::string> StorageHandler::GetMergerAddresses(
 }
 
 void StorageHandler::setMergers(std::string mergerList) {
-	tbb::spin_mutex::scoped_lock my_lock(sendMutex_);
-	for (auto socket : mergerSockets_) {
-		ZMQHandler::DestroySocket(socket);
-	}
-	mergerSockets_.clear();
-
-	for (std::string address : GetMergerAddresses(mergerList)) {
-		LOG_INFO<< "Connecting to merger: " << address;
-		zmq::socket_t* socket = ZMQHandler::GenerateSocket("StorageHandler", ZMQ_PUSH);
-		socket->connect(address.c_str());
-		mergerSockets_.push_back(socket);
-	}
-
+	/*
+	 * The senders connect to the new mergers themselves
+	 */
+	MergerSender::setMergerAddresses(GetMergerAddresses(mergerList));
 }
 
 void StorageHandler::initialize() {
@@ -99,14 +100,16 @@ void StorageHandler::initialize() {
 		TotalNumberOfDetectors_++;
 	}
 
-	InitialEventBufferSize_ = 1000;
+	OutputBufferPool::initialize();
+	OutputCompressor::initialize();
+	MergerSender::initialize();
+	EventSpool::initialize();
+
+	zeroCopyOutput_ = Options::GetBool(OPTION_ZERO_COPY_OUTPUT);
 }
 
 void StorageHandler::onShutDown() {
-	for (auto socket : mergerSockets_) {
-		ZMQHandler::DestroySocket(socket);
-	}
-	mergerSockets_.clear();
+	MergerSender::stopAll();
 }
 
 char* StorageHandler::ResizeBuffer(char* buffer, const int oldLength,
@@ -117,13 +120,7 @@ char* StorageHandler::ResizeBuffer(char* buffer, const int oldLength,
 	return newBuffer;
 }
 
-EVENT_HDR* StorageHandler::GenerateEventBuffer(const Event* event) {
-
-	uint eventBufferSize = InitialEventBufferSize_;
-	char* eventBuffer = new char[InitialEventBufferSize_];
-
-	struct EVENT_HDR* header = (struct EVENT_HDR*) eventBuffer;
-
+void StorageHandler::writeEventHeader(EVENT_HDR* header, const Event* event) {
 	header->eventNum = event->getEventNumber();
 	header->format = 0x62; // TODO: update current format
 	// header->length will be written later on
@@ -136,6 +133,60 @@ EVENT_HDR* StorageHandler::GenerateEventBuffer(const Event* event) {
 	header->reserved2 = 0;
 	header->processingID = event->getProcessingID();
 	header->SOBtimestamp = 0; // Will be set by the merger
+}
+
+static inline uint align32(const uint length) {
+	return (length + 3) & ~3u;
+}
+
+uint StorageHandler::calculateCreamDataLength(cream::LkrFragment** fragments,
+		uint numberOfFragments) {
+	uint length = 0;
+	for (uint fragmentNum = 0; fragmentNum != numberOfFragments;
+			fragmentNum++) {
+		length += align32(fragments[fragmentNum]->getEventLength());
+	}
+	return length;
+}
+
+uint StorageHandler::calculateEventLength(const Event* event) {
+	uint eventLength = sizeof(struct EVENT_HDR) + 4 * TotalNumberOfDetectors_;
+
+	for (int sourceNum = 0;
+			sourceNum != SourceIDManager::NUMBER_OF_L0_DATA_SOURCES;
+			sourceNum++) {
+		l0::Subevent* subevent = event->getL0SubeventBySourceIDNum(sourceNum);
+		for (uint i = 0; i != subevent->getNumberOfFragments(); i++) {
+			eventLength += align32(
+					subevent->getFragment(i)->getPayloadLength()
+							+ sizeof(struct L0_BLOCK_HDR));
+		}
+	}
+
+	if (SourceIDManager::NUMBER_OF_EXPECTED_LKR_CREAM_FRAGMENTS != 0) {
+		eventLength += calculateCreamDataLength(
+				event->getZSuppressedLkrFragments(),
+				event->getNumberOfZSuppressedLkrFragments());
+	}
+
+	if (SourceIDManager::MUV1_NUMBER_OF_FRAGMENTS != 0) {
+		eventLength += calculateCreamDataLength(event->getMuv1Fragments(),
+				event->getNumberOfMuv1Fragments());
+	}
+
+	if (SourceIDManager::MUV2_NUMBER_OF_FRAGMENTS != 0) {
+		eventLength += calculateCreamDataLength(event->getMuv2Fragments(),
+				event->getNumberOfMuv2Fragments());
+	}
+
+	return eventLength + sizeof(EVENT_TRAILER);
+}
+
+EVENT_HDR* StorageHandler::GenerateEventBuffer(const Event* event,
+		char* eventBuffer, const uint eventLength) {
+	struct EVENT_HDR* header = (struct EVENT_HDR*) eventBuffer;
+	writeEventHeader(header, event);
+	header->length = eventLength / 4;
 
 	uint sizeOfPointerTable = 4 * TotalNumberOfDetectors_;
 	uint pointerTableOffset = sizeof(struct EVENT_HDR);
@@ -146,12 +197,6 @@ EVENT_HDR* StorageHandler::GenerateEventBuffer(const Event* event) {
 			sourceNum++) {
 		l0::Subevent* subevent = event->getL0SubeventBySourceIDNum(sourceNum);
 
-		if (eventOffset + 4 > eventBufferSize) {
-			eventBuffer = ResizeBuffer(eventBuffer, eventBufferSize,
-					eventBufferSize + 1000);
-			eventBufferSize += 1000;
-		}
-
 		/*
 		 * Put the sub-detector  into the pointer table
 		 */
@@ -168,11 +213,6 @@ EVENT_HDR* StorageHandler::GenerateEventBuffer(const Event* event) {
 		for (uint i = 0; i != subevent->getNumberOfFragments(); i++) {
 			l0::MEPFragment* e = subevent->getFragment(i);
 			payloadLength = e->getPayloadLength() + sizeof(struct L0_BLOCK_HDR);
-			if (eventOffset + payloadLength > eventBufferSize) {
-				eventBuffer = ResizeBuffer(eventBuffer, eventBufferSize,
-						eventBufferSize + payloadLength);
-				eventBufferSize += payloadLength;
-			}
 
 			struct L0_BLOCK_HDR* blockHdr = (struct L0_BLOCK_HDR*) (eventBuffer
 					+ eventOffset);
@@ -188,10 +228,9 @@ EVENT_HDR* StorageHandler::GenerateEventBuffer(const Event* event) {
 			/*
 			 * 32-bit alignment
 			 */
-			if (eventOffset % 4 != 0) {
-				memset(eventBuffer + eventOffset, 0, eventOffset % 4);
-				eventOffset += eventOffset % 4;
-			}
+			memset(eventBuffer + eventOffset, 0,
+					align32(eventOffset) - eventOffset);
+			eventOffset = align32(eventOffset);
 		}
 	}
 
@@ -199,21 +238,21 @@ EVENT_HDR* StorageHandler::GenerateEventBuffer(const Event* event) {
 	 * Write the LKr data
 	 */
 	if (SourceIDManager::NUMBER_OF_EXPECTED_LKR_CREAM_FRAGMENTS != 0) {
-		writeCreamData(eventBuffer, eventOffset, eventBufferSize,
-				pointerTableOffset, event->getZSuppressedLkrFragments(),
+		writeCreamData(eventBuffer, eventOffset, pointerTableOffset,
+				event->getZSuppressedLkrFragments(),
 				event->getNumberOfZSuppressedLkrFragments(), SOURCE_ID_LKr);
 	}
 
 	if (SourceIDManager::MUV1_NUMBER_OF_FRAGMENTS != 0) {
-		writeCreamData(eventBuffer, eventOffset, eventBufferSize,
-				pointerTableOffset, event->getMuv1Fragments(),
-				event->getNumberOfMuv1Fragments(), SOURCE_ID_MUV1);
+		writeCreamData(eventBuffer, eventOffset, pointerTableOffset,
+				event->getMuv1Fragments(), event->getNumberOfMuv1Fragments(),
+				SOURCE_ID_MUV1);
 	}
 
 	if (SourceIDManager::MUV2_NUMBER_OF_FRAGMENTS != 0) {
-		writeCreamData(eventBuffer, eventOffset, eventBufferSize,
-				pointerTableOffset, event->getMuv2Fragments(),
-				event->getNumberOfMuv2Fragments(), SOURCE_ID_MUV2);
+		writeCreamData(eventBuffer, eventOffset, pointerTableOffset,
+				event->getMuv2Fragments(), event->getNumberOfMuv2Fragments(),
+				SOURCE_ID_MUV2);
 	}
 
 	/*
@@ -223,34 +262,12 @@ EVENT_HDR* StorageHandler::GenerateEventBuffer(const Event* event) {
 	trailer->eventNum = event->getEventNumber();
 	trailer->reserved = 0;
 
-	const int eventLength = eventOffset + 4/*trailer*/;
-
-	if (eventBufferSize > InitialEventBufferSize_) {
-		InitialEventBufferSize_ = eventBufferSize;
-	}
-
-	/*
-	 * header may have been overwritten -> redefine it
-	 */
-	header = (struct EVENT_HDR*) eventBuffer;
-
-	header->length = eventLength / 4;
-
 	return header;
 }
 
-char* StorageHandler::writeCreamData(char*& eventBuffer, uint& eventOffset,
-		uint& eventBufferSize, uint& pointerTableOffset,
-		cream::LkrFragment** fragments, uint numberOfFragments, uint sourceID) {
-	/*
-	 * Write the LKr data
-	 */
-	if (eventOffset + 4 > eventBufferSize) {
-		eventBuffer = ResizeBuffer(eventBuffer, eventBufferSize,
-				eventBufferSize + 1000);
-		eventBufferSize += 1000;
-	}
-
+void StorageHandler::writeCreamData(char* eventBuffer, uint& eventOffset,
+		uint& pointerTableOffset, cream::LkrFragment** fragments,
+		uint numberOfFragments, uint sourceID) {
 	uint eventOffset32 = eventOffset / 4;
 	/*
 	 * Put the LKr into the pointer table
@@ -263,12 +280,6 @@ char* StorageHandler::writeCreamData(char*& eventBuffer, uint& eventOffset,
 			fragmentNum++) {
 		cream::LkrFragment* e = fragments[fragmentNum];
 
-		if (eventOffset + e->getEventLength() > eventBufferSize) {
-			eventBuffer = ResizeBuffer(eventBuffer, eventBufferSize,
-					eventBufferSize + e->getEventLength());
-			eventBufferSize += e->getEventLength();
-		}
-
 		memcpy(eventBuffer + eventOffset, e->getDataWithHeader(),
 				e->getEventLength());
 		eventOffset += e->getEventLength();
@@ -276,43 +287,215 @@ char* StorageHandler::writeCreamData(char*& eventBuffer, uint& eventOffset,
 		/*
 		 * 32-bit alignment
 		 */
-		if (eventOffset % 4 != 0) {
-			memset(eventBuffer + eventOffset, 0, eventOffset % 4);
-			eventOffset += eventOffset % 4;
+		memset(eventBuffer + eventOffset, 0, align32(eventOffset) - eventOffset);
+		eventOffset = align32(eventOffset);
+	}
+}
+
+uint StorageHandler::EventParts::appendScratch(const uint length) {
+	if (scratchLength + length > scratchSize) {
+		const uint newSize = std::max(2 * scratchSize, scratchLength + length);
+		scratch = ResizeBuffer(scratch, scratchLength, newSize);
+		scratchSize = newSize;
+	}
+
+	/*
+	 * Consecutive scratch ranges are sent as one part
+	 */
+	if (!segments.empty() && segments.back().data == nullptr) {
+		segments.back().length += length;
+	} else {
+		segments.push_back( { nullptr, scratchLength, length });
+	}
+
+	const uint offset = scratchLength;
+	scratchLength += length;
+	eventLength += length;
+	return offset;
+}
+
+void StorageHandler::EventParts::appendData(const char* data,
+		const uint length) {
+	if (length < MIN_ZERO_COPY_BYTES) {
+		memcpy(scratch + appendScratch(length), data, length);
+		ThreadCounters::add(ThreadCounters::STORAGE_BYTES_COPIED, length);
+	} else {
+		segments.push_back( { data, 0, length });
+		eventLength += length;
+		ThreadCounters::add(ThreadCounters::STORAGE_BYTES_ZERO_COPY, length);
+	}
+}
+
+void StorageHandler::EventParts::appendPadding() {
+	/*
+	 * 32-bit alignment
+	 */
+	const uint padding = (4 - eventLength % 4) % 4;
+	if (padding != 0) {
+		memcpy(scratch + appendScratch(padding), zeroPadding, padding);
+	}
+}
+
+void StorageHandler::appendCreamParts(EventParts& parts,
+		uint& pointerTableOffset, cream::LkrFragment** fragments,
+		uint numberOfFragments, uint sourceID) {
+	uint eventOffset32 = parts.eventLength / 4;
+	std::memcpy(parts.scratch + pointerTableOffset, &eventOffset32, 3);
+	std::memset(parts.scratch + pointerTableOffset + 3, sourceID, 1);
+	pointerTableOffset += 4;
+
+	for (uint fragmentNum = 0; fragmentNum != numberOfFragments;
+			fragmentNum++) {
+		cream::LkrFragment* e = fragments[fragmentNum];
+		parts.appendData(e->getDataWithHeader(), e->getEventLength());
+		parts.appendPadding();
+	}
+}
+
+void StorageHandler::releaseMultipartContext(MultipartContext* context,
+		uint references) {
+	if (context->references.fetch_sub(references) == references) {
+		EventPool::FreeEvent(context->event);
+		delete[] context->scratch;
+		delete context;
+	}
+}
+
+void StorageHandler::freeMultipartPart(void*, void* hint) {
+	releaseMultipartContext((MultipartContext*) hint, 1);
+}
+
+int StorageHandler::SendEventMultipart(Event* event) {
+	EventParts parts;
+	parts.scratchSize = 64 + 8 * TotalNumberOfDetectors_;
+	parts.scratch = new char[parts.scratchSize];
+	parts.scratchLength = 0;
+	parts.eventLength = 0;
+
+	const uint headerOffset = parts.appendScratch(
+			sizeof(struct EVENT_HDR) + 4 * TotalNumberOfDetectors_);
+	writeEventHeader((struct EVENT_HDR*) (parts.scratch + headerOffset), event);
+	uint pointerTableOffset = headerOffset + sizeof(struct EVENT_HDR);
+
+	for (int sourceNum = 0;
+			sourceNum != SourceIDManager::NUMBER_OF_L0_DATA_SOURCES;
+			sourceNum++) {
+		l0::Subevent* subevent = event->getL0SubeventBySourceIDNum(sourceNum);
+
+		uint eventOffset32 = parts.eventLength / 4;
+		std::memcpy(parts.scratch + pointerTableOffset, &eventOffset32, 3);
+		std::memset(parts.scratch + pointerTableOffset + 3,
+				SourceIDManager::SourceNumToID(sourceNum), 1);
+		pointerTableOffset += 4;
+
+		for (uint i = 0; i != subevent->getNumberOfFragments(); i++) {
+			l0::MEPFragment* e = subevent->getFragment(i);
+			const uint blockHdrOffset = parts.appendScratch(
+					sizeof(struct L0_BLOCK_HDR));
+			struct L0_BLOCK_HDR* blockHdr = (struct L0_BLOCK_HDR*) (parts.scratch
+					+ blockHdrOffset);
+			blockHdr->dataBlockSize = e->getPayloadLength()
+					+ sizeof(struct L0_BLOCK_HDR);
+			blockHdr->sourceSubID = e->getSourceSubID();
+			blockHdr->reserved = 0;
+
+			parts.appendData((const char*) e->getPayload(),
+					e->getPayloadLength());
+			parts.appendPadding();
 		}
 	}
 
-	return eventBuffer;
+	if (SourceIDManager::NUMBER_OF_EXPECTED_LKR_CREAM_FRAGMENTS != 0) {
+		appendCreamParts(parts, pointerTableOffset,
+				event->getZSuppressedLkrFragments(),
+				event->getNumberOfZSuppressedLkrFragments(), SOURCE_ID_LKr);
+	}
+
+	if (SourceIDManager::MUV1_NUMBER_OF_FRAGMENTS != 0) {
+		appendCreamParts(parts, pointerTableOffset, event->getMuv1Fragments(),
+				event->getNumberOfMuv1Fragments(), SOURCE_ID_MUV1);
+	}
+
+	if (SourceIDManager::MUV2_NUMBER_OF_FRAGMENTS != 0) {
+		appendCreamParts(parts, pointerTableOffset, event->getMuv2Fragments(),
+				event->getNumberOfMuv2Fragments(), SOURCE_ID_MUV2);
+	}
+
+	/*
+	 * Trailer
+	 */
+	EVENT_TRAILER* trailer = (EVENT_TRAILER*) (parts.scratch
+			+ parts.appendScratch(sizeof(EVENT_TRAILER)));
+	trailer->eventNum = event->getEventNumber();
+	trailer->reserved = 0;
+
+	const int eventLength = parts.eventLength;
+	((struct EVENT_HDR*) (parts.scratch + headerOffset))->length = eventLength
+			/ 4;
+
+	/*
+	 * The event is freed by the free callback of the last part released by ZMQ. The
+	 * additional reference protects it while the parts are still being sent
+	 */
+	MultipartContext* context = new MultipartContext();
+	context->event = event;
+	context->scratch = parts.scratch;
+	context->references = parts.segments.size() + 1;
+
+	OutgoingEvent* outgoingEvent = new OutgoingEvent();
+	outgoingEvent->burstID = event->getBurstID();
+	outgoingEvent->eventNumber = event->getEventNumber();
+	outgoingEvent->parts.reserve(parts.segments.size());
+	for (const OutputSegment& segment : parts.segments) {
+		const char* data =
+				segment.data != nullptr ?
+						segment.data : parts.scratch + segment.scratchOffset;
+		outgoingEvent->parts.push_back( { (void*) data, segment.length,
+				(zmq::free_fn*) freeMultipartPart, context });
+	}
+	if (!MergerSender::enqueueEvent(outgoingEvent, event->getEventNumber())) {
+		EventSpool::spoolEvent(outgoingEvent);
+	}
+
+	releaseMultipartContext(context, 1);
+
+	return eventLength;
 }
 
-int StorageHandler::SendEvent(const Event* event) {
+int StorageHandler::SendEvent(Event* event) {
+	if (zeroCopyOutput_) {
+		return SendEventMultipart(event);
+	}
+
 	/*
-	 * TODO: Use multimessage instead of creating a separate buffer and copying the MEP data into it
+	 * The exact size is known in advance -> the buffer never has to be resized
 	 */
-	const EVENT_HDR* data = GenerateEventBuffer(event);
+	const int eventLength = calculateEventLength(event);
+	void* freeHint;
+	char* eventBuffer = OutputBufferPool::getBuffer(
+			event->getTriggerTypeWord(), eventLength, freeHint);
+	GenerateEventBuffer(event, eventBuffer, eventLength);
+	const uint burstID = event->getBurstID();
+	const uint eventNumber = event->getEventNumber();
+	ThreadCounters::add(ThreadCounters::STORAGE_BYTES_COPIED, eventLength);
 
 	/*
-	 * Send the event to the merger with a zero copy message
+	 * All data has been copied -> the event can be reused
 	 */
-	zmq::message_t zmqMessage((void*) data, data->length * 4,
-			(zmq::free_fn*) ZMQHandler::freeZmqMessage);
-
-	while (ZMQHandler::IsRunning()) {
-		tbb::spin_mutex::scoped_lock my_lock(sendMutex_);
-		try {
-			mergerSockets_[event->getBurstID() % mergerSockets_.size()]->send(
-					zmqMessage);
-			break;
-		} catch (const zmq::error_t& ex) {
-			if (ex.num() != EINTR) { // try again if EINTR (signal caught)
-				LOG_ERROR << ex.what() << ENDL;
-
-				onShutDown();
-				return 0;
-			}
-		}
+	EventPool::FreeEvent(event);
+
+	/*
+	 * The buffer returns to the pool as soon as ZMQ has sent it
+	 */
+	OutgoingEvent* outgoingEvent = new OutgoingEvent();
+	outgoingEvent->burstID = burstID;
+	outgoingEvent->eventNumber = eventNumber;
+	outgoingEvent->parts.push_back( { eventBuffer, (uint) eventLength,
+			(zmq::free_fn*) OutputBufferPool::freeBuffer, freeHint });
+	if (!MergerSender::enqueueEvent(outgoingEvent, eventNumber)) {
+		EventSpool::spoolEvent(outgoingEvent);
 	}
 
-	return data->length * 4;
+	return eventLength;
 }
 } /* namespace na62 */
@@ -14,6 +14,8 @@
 #include <string>
 #include <vector>
 
+#include "../monitoring/ThreadCounters.h"
+
 namespace na62 {
 class Event;
 struct EVENT_HDR;
@@ -23,10 +25,6 @@ class LkrFragment;
 } /* namespace cream */
 } /* namespace na62 */
 
-namespace tbb {
-class spin_mutex;
-} /* namespace tbb */
-
 namespace zmq {
 class socket_t;
 } /* namespace zmq */
@@ -38,9 +36,22 @@ public:
 	static void initialize();
 	static void onShutDown();
 
-	static int SendEvent(const Event* event);
+	/**
+	 * Serializes the event and passes it to a MergerSender. The event is freed afterwards.
+	 * With zero copy output the event is freed as soon as ZMQ does not need its fragments
+	 * anymore
+	 *
+	 * @return The number of bytes enqueued
+	 */
+	static int SendEvent(Event* event);
 
-	static std::string GetMergerAddress();
+	static uint64_t GetBytesCopied() {
+		return ThreadCounters::sum(ThreadCounters::STORAGE_BYTES_COPIED);
+	}
+
+	static uint64_t GetBytesSentZeroCopy() {
+		return ThreadCounters::sum(ThreadCounters::STORAGE_BYTES_ZERO_COPY);
+	}
 
 	/**
 	 * Change the list of mergers to be used for sending data to
@@ -49,29 +60,94 @@ public:
 	static void setMergers(std::string mergerList);
 
 private:
+	/*
+	 * One part of a multipart event. Either pointing to fragment data or to a range of the
+	 * scratch buffer
+	 */
+	struct OutputSegment {
+		const char* data;
+		uint scratchOffset;
+		uint length;
+	};
+
+	/*
+	 * The parts of an event being assembled. Headers, padding and small payloads are written
+	 * to the scratch buffer
+	 */
+	struct EventParts {
+		char* scratch;
+		uint scratchSize;
+		uint scratchLength;
+		std::vector<OutputSegment> segments;
+
+		/*
+		 * Number of bytes of the event described by the segments
+		 */
+		uint eventLength;
+
+		/**
+		 * @return The offset of length new bytes in the scratch buffer
+		 */
+		uint appendScratch(const uint length);
+		void appendData(const char* data, const uint length);
+		void appendPadding();
+	};
+
+	/*
+	 * Keeps the event alive until ZMQ has freed all parts referencing its fragments
+	 */
+	struct MultipartContext {
+		Event* event;
+		char* scratch;
+		std::atomic<uint> references;
+	};
+
 	static char* ResizeBuffer(char* buffer, const int oldLength,
 			const int newLength);
 
 	static std::vector<std::string> GetMergerAddresses(std::string mergerList);
 
+	/**
+	 * @return The number of bytes of the serialized event including padding and trailer
+	 */
+	static uint calculateEventLength(const Event* event);
+
+	static uint calculateCreamDataLength(cream::LkrFragment** fragments,
+			uint numberOfFragments);
+
 	/**
 	 * Generates the raw data as it should be send to the merger
+	 *
+	 * @param eventBuffer Buffer of at least eventLength bytes
+	 * @param eventLength The length returned by calculateEventLength
 	 */
-	static EVENT_HDR* GenerateEventBuffer(const Event* event);
+	static EVENT_HDR* GenerateEventBuffer(const Event* event, char* eventBuffer,
+			const uint eventLength);
 
-	static char* writeCreamData(char*& eventBuffer, uint& eventOffset,
-			uint& eventBufferSize, uint& pointerTableOffset,
+	static void writeEventHeader(EVENT_HDR* header, const Event* event);
+
+	/**
+	 * Sends the header, pointer table and trailer from a scratch buffer and the fragment
+	 * payloads as separate zero copy parts of one multipart message
+	 */
+	static int SendEventMultipart(Event* event);
+
+	static void appendCreamParts(EventParts& parts, uint& pointerTableOffset,
 			cream::LkrFragment** fragments, uint numberOfFragments,
 			uint sourceID);
-	/*
-	 * One Socket for every EventBuilder
-	 */
-	static std::vector<zmq::socket_t*> mergerSockets_;
-	static tbb::spin_mutex sendMutex_;
 
-	static std::atomic<uint> InitialEventBufferSize_;
+	static void releaseMultipartContext(MultipartContext* context,
+			uint references);
+
+	static void freeMultipartPart(void* data, void* hint);
+
+	static void writeCreamData(char* eventBuffer, uint& eventOffset,
+			uint& pointerTableOffset, cream::LkrFragment** fragments,
+			uint numberOfFragments, uint sourceID);
 	static int TotalNumberOfDetectors_;
 
+	static bool zeroCopyOutput_;
+
 };
 
 } /* namespace na62 */
@@ -0,0 +1,66 @@
+/*
+ * TriggerTask.cpp
+ *
+ *  Created on: Oct 16, 2026
+ *      Author: Jonas Kunze (kunze.jonas@gmail.com)
+ */
+
+#include "TriggerTask.h"
+
+#include "../topology/NodeArena.h"
+#include "L1Builder.h"
+#include "L2Builder.h"
+
+namespace na62 {
+
+bool TriggerTask::enabled_ = false;
+std::atomic<uint> TriggerTask::queuedTasksNum_(0);
+
+/*
+ * Functor running the task within a NodeArena
+ */
+struct TriggerInArena {
+	mutable std::vector<Event*> events;
+	TriggerTask::Level level;
+
+	void operator()() const {
+		tbb::task::spawn_root_and_wait(
+				*new (tbb::task::allocate_root()) TriggerTask(std::move(events),
+						level));
+	}
+};
+
+TriggerTask::TriggerTask(std::vector<Event*>&& events, Level level) :
+		events_(std::move(events)), level_(level) {
+}
+
+tbb::task* TriggerTask::execute() {
+	if (level_ == L1) {
+		L1Builder::processL1(events_.data(), events_.size());
+	} else {
+		for (Event* event : events_) {
+			L2Builder::processL2(event);
+		}
+	}
+	queuedTasksNum_.fetch_sub(events_.size(), std::memory_order_relaxed);
+	return nullptr;
+}
+
+void TriggerTask::enqueue(Event* event, Level level) {
+	enqueue(std::vector<Event*>(1, event), level);
+}
+
+void TriggerTask::enqueue(std::vector<Event*>&& events, Level level) {
+	queuedTasksNum_.fetch_add(events.size(), std::memory_order_relaxed);
+	NodeArena* arena = NodeArena::getCurrentThreadArena();
+	if (arena != nullptr) {
+		TriggerInArena functor = { std::move(events), level };
+		arena->enqueue(functor);
+	} else {
+		tbb::task::enqueue(
+				*new (tbb::task::allocate_root()) TriggerTask(std::move(events),
+						level), tbb::priority_t::priority_normal);
+	}
+}
+
+} /* namespace na62 */
@@ -0,0 +1,74 @@
+/*
+ * TriggerTask.h
+ *
+ *  Created on: Oct 16, 2026
+ *      Author: Jonas Kunze (kunze.jonas@gmail.com)
+ */
+
+#pragma once
+#ifndef TRIGGERTASK_H_
+#define TRIGGERTASK_H_
+
+#include <tbb/task.h>
+#include <sys/types.h>
+#include <atomic>
+#include <vector>
+
+namespace na62 {
+class Event;
+
+/*
+ * Runs the L1 or L2 processing of complete events in the TBB pool. Used in run-to-completion
+ * mode where the fragments are added to the events by the receiving PacketHandler threads
+ * which should not be blocked by the trigger algorithms.
+ */
+class TriggerTask: public tbb::task {
+public:
+	enum Level {
+		L1 = 1, L2 = 2
+	};
+
+	TriggerTask(std::vector<Event*>&& events, Level level);
+
+	tbb::task* execute();
+
+	/**
+	 * If disabled the L1Builder and L2Builder process complete events within the calling thread
+	 */
+	static inline void setEnabled(bool enabled) {
+		enabled_ = enabled;
+	}
+
+	static inline bool IsEnabled() {
+		return enabled_;
+	}
+
+	/**
+	 * Enqueues the processing of the event into the arena of the calling PacketHandler or,
+	 * if it has none, into the current arena
+	 */
+	static void enqueue(Event* event, Level level);
+
+	/**
+	 * Enqueues one task processing all events one after the other
+	 */
+	static void enqueue(std::vector<Event*>&& events, Level level);
+
+	/**
+	 * @return The number of events enqueued but not yet processed
+	 */
+	static inline uint getNumberOfQueuedTasks() {
+		return queuedTasksNum_;
+	}
+
+private:
+	std::vector<Event*> events_;
+	const Level level_;
+
+	static bool enabled_;
+	static std::atomic<uint> queuedTasksNum_;
+};
+
+} /* namespace na62 */
+
+#endif /* TRIGGERTASK_H_ */
@@ -21,6 +21,7 @@
 
 #include "../eventBuilding/StorageHandler.h"
 #include "../options/MyOptions.h"
+#include "HighResolutionSampler.h"
 #include "../socket/PacketHandler.h"
 
 namespace na62 {
@@ -67,6 +68,8 @@ void CommandConnector::thread() {
 			} else if (command == "runningmergers") {
 				std::string mergerList=strings[1];
 				StorageHandler::setMergers(mergerList);
+			} else if (command == "dump_samples") {
+				monitoring::HighResolutionSampler::requestDump(strings[1]);
 			}
 		}
 	}
@@ -0,0 +1,182 @@
+/*
+ * HighResolutionSampler.cpp
+ *
+ *  Created on: Oct 16, 2026
+ *      Author: Jonas Kunze (kunze.jonas@gmail.com)
+ */
+
+#include "HighResolutionSampler.h"
+
+#include <unistd.h>
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <sstream>
+#include <thread>
+
+#include <options/Logging.h>
+#include <socket/NetworkHandler.h>
+
+#include "../eventBuilding/EventPipeline.h"
+#include "../eventBuilding/EventSpool.h"
+#include "../eventBuilding/L2Builder.h"
+#include "../eventBuilding/MergerSender.h"
+#include "../eventBuilding/TriggerTask.h"
+#include "../options/MyOptions.h"
+#include "../socket/FragmentStore.h"
+#include "../socket/HandleFrameTask.h"
+#include "../socket/PacketHandler.h"
+
+namespace na62 {
+namespace monitoring {
+
+std::atomic<bool> HighResolutionSampler::dumpRequested_(false);
+std::mutex HighResolutionSampler::reasonMutex_;
+std::string HighResolutionSampler::dumpReason_;
+
+static inline uint64_t nowMicros() {
+	return std::chrono::duration_cast<std::chrono::microseconds>(
+			std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+HighResolutionSampler::HighResolutionSampler() :
+		intervalMillis_(
+				std::max(1, Options::GetInt(OPTION_SAMPLER_INTERVAL))), numberOfSamples_(
+				0), running_(true), autoDump_(
+				Options::GetBool(OPTION_SAMPLER_AUTO_DUMP)), dumpDirectory_(
+				Options::GetString(OPTION_SAMPLER_DUMP_DIRECTORY)), postTriggerSamples_(
+				1000 / intervalMillis_), minMicrosBetweenAutoDumps_(
+				1000000ull * Options::GetInt(OPTION_SAMPLER_MIN_DUMP_INTERVAL)), lastAutoDumpMicros_(
+				0), samplesUntilAutoDump_(0) {
+	const uint history = std::max(1, Options::GetInt(OPTION_SAMPLER_HISTORY));
+	ring_.resize(std::max(2u, history * 1000 / intervalMillis_));
+}
+
+HighResolutionSampler::~HighResolutionSampler() {
+}
+
+bool HighResolutionSampler::IsEnabled() {
+	return Options::GetInt(OPTION_SAMPLER_INTERVAL) > 0;
+}
+
+void HighResolutionSampler::requestDump(const std::string& reason) {
+	{
+		std::lock_guard<std::mutex> lock(reasonMutex_);
+		dumpReason_ = reason;
+	}
+	dumpRequested_ = true;
+}
+
+void HighResolutionSampler::onInterruption() {
+	running_ = false;
+}
+
+void HighResolutionSampler::takeSample(Sample& sample) {
+	sample.timeMicros = nowMicros();
+	sample.burstID = PacketHandler::getCurrentBurstId();
+	sample.queuedTasks = HandleFrameTask::getNumberOfQeuedTasks();
+	sample.queuedTriggerTasks = TriggerTask::getNumberOfQueuedTasks();
+	sample.mergerQueuedEvents = MergerSender::GetNumberOfQueuedEvents();
+	sample.framesReceived = NetworkHandler::GetFramesReceived();
+	sample.bytesReceived = NetworkHandler::GetBytesReceived();
+	sample.framesDropped = NetworkHandler::GetFramesDropped();
+	sample.ipFragmentsDropped = FragmentStore::getNumberOfDroppedFragments();
+	sample.eventsToMerger = L2Builder::GetEventsSentToStorage();
+	sample.mergerEventsDropped = MergerSender::GetEventsDropped();
+	sample.spooledEvents = EventSpool::GetEventsSpooled();
+	sample.l1QueueDepth = EventPipeline::L1.getQueueDepth();
+	sample.l2QueueDepth = EventPipeline::L2.getQueueDepth();
+}
+
+bool HighResolutionSampler::hasDrops(const Sample& sample,
+		const Sample& previous) {
+	return sample.framesDropped != previous.framesDropped
+			|| sample.ipFragmentsDropped != previous.ipFragmentsDropped
+			|| sample.mergerEventsDropped != previous.mergerEventsDropped
+			|| sample.spooledEvents != previous.spooledEvents;
+}
+
+void HighResolutionSampler::thread() {
+	LOG_INFO<< "Sampling the key counters every " << intervalMillis_
+	<< " ms for the last " << ring_.size() * intervalMillis_ / 1000
+	<< " s" << ENDL;
+
+	while (running_) {
+		Sample& sample = ring_[numberOfSamples_ % ring_.size()];
+		takeSample(sample);
+
+		if (autoDump_ && numberOfSamples_ != 0 && samplesUntilAutoDump_ == 0
+				&& hasDrops(sample,
+						ring_[(numberOfSamples_ - 1) % ring_.size()])
+				&& sample.timeMicros - lastAutoDumpMicros_
+						>= minMicrosBetweenAutoDumps_) {
+			samplesUntilAutoDump_ = postTriggerSamples_ + 1;
+			lastAutoDumpMicros_ = sample.timeMicros;
+		}
+		numberOfSamples_++;
+
+		if (samplesUntilAutoDump_ != 0 && --samplesUntilAutoDump_ == 0) {
+			dump("drops");
+		}
+		if (dumpRequested_.exchange(false)) {
+			std::string reason;
+			{
+				std::lock_guard<std::mutex> lock(reasonMutex_);
+				reason = dumpReason_;
+			}
+			dump(reason);
+		}
+
+		usleep(intervalMillis_ * 1000);
+	}
+}
+
+void HighResolutionSampler::dump(const std::string& reason) {
+	std::vector<Sample> samples;
+	const uint64_t available = std::min<uint64_t>(numberOfSamples_,
+			ring_.size());
+	samples.reserve(available);
+	for (uint64_t i = numberOfSamples_ - available; i != numberOfSamples_;
+			i++) {
+		samples.push_back(ring_[i % ring_.size()]);
+	}
+
+	std::stringstream fileName;
+	fileName << dumpDirectory_ << "/na62-farm-samples-"
+			<< PacketHandler::getCurrentBurstId() << "-" << nowMicros() << ".csv";
+
+	/*
+	 * Writing takes longer than a sampling interval
+	 */
+	std::thread(writeSamples, std::move(samples), fileName.str(), reason).detach();
+}
+
+void HighResolutionSampler::writeSamples(std::vector<Sample> samples,
+		const std::string fileName, const std::string reason) {
+	std::ofstream file(fileName);
+	if (!file.good()) {
+		LOG_ERROR<< "Unable to write the counter samples to " << fileName
+		<< ENDL;
+		return;
+	}
+
+	file << "# reason: " << reason << "\n";
+	file << "timeMicros,burstID,queuedTasks,queuedTriggerTasks,"
+			"mergerQueuedEvents,framesReceived,bytesReceived,framesDropped,"
+			"ipFragmentsDropped,eventsToMerger,mergerEventsDropped,"
+			"spooledEvents,l1QueueDepth,l2QueueDepth\n";
+	for (const Sample& s : samples) {
+		file << s.timeMicros << "," << s.burstID << "," << s.queuedTasks << ","
+				<< s.queuedTriggerTasks << "," << s.mergerQueuedEvents << ","
+				<< s.framesReceived << "," << s.bytesReceived << ","
+				<< s.framesDropped << "," << s.ipFragmentsDropped << ","
+				<< s.eventsToMerger << "," << s.mergerEventsDropped << ","
+				<< s.spooledEvents << "," << s.l1QueueDepth << ","
+				<< s.l2QueueDepth << "\n";
+	}
+	LOG_INFO<< "Wrote " << samples.size() << " counter samples (" << reason
+	<< ") to " << fileName << ENDL;
+}
+
+} /* namespace monitoring */
+} /* namespace na62 */
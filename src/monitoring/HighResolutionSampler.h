@@ -0,0 +1,102 @@
+/*
+ * HighResolutionSampler.h
+ *
+ *  Created on: Oct 16, 2026
+ *      Author: Jonas Kunze (kunze.jonas@gmail.com)
+ */
+
+#pragma once
+#ifndef HIGHRESOLUTIONSAMPLER_H_
+#define HIGHRESOLUTIONSAMPLER_H_
+
+#include <sys/types.h>
+#include <utils/AExecutable.h>
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace na62 {
+namespace monitoring {
+
+/*
+ * Samples a fixed set of key counters every samplerInterval milliseconds into a ring
+ * covering the last samplerHistory seconds. Micro bursts like a 50 ms spike of queued tasks
+ * are invisible in the one second monitoring but can be seen here.
+ *
+ * The ring is written to a CSV file in samplerDumpDirectory on the dump_samples command or
+ * automatically shortly after frames or events have been dropped.
+ */
+class HighResolutionSampler: public AExecutable {
+public:
+	HighResolutionSampler();
+	virtual ~HighResolutionSampler();
+
+	static bool IsEnabled();
+
+	/**
+	 * Dumps the ring with the next sample. Can be called from any thread
+	 */
+	static void requestDump(const std::string& reason);
+
+private:
+	struct Sample {
+		uint64_t timeMicros;
+		uint32_t burstID;
+		uint32_t queuedTasks;
+		uint32_t queuedTriggerTasks;
+		uint32_t mergerQueuedEvents;
+		uint64_t framesReceived;
+		uint64_t bytesReceived;
+		uint64_t framesDropped;
+		uint64_t ipFragmentsDropped;
+		uint64_t eventsToMerger;
+		uint64_t mergerEventsDropped;
+		uint64_t spooledEvents;
+		uint32_t l1QueueDepth;
+		uint32_t l2QueueDepth;
+	};
+
+	const uint intervalMillis_;
+	std::vector<Sample> ring_;
+	uint64_t numberOfSamples_;
+	bool running_;
+
+	const bool autoDump_;
+	const std::string dumpDirectory_;
+	/*
+	 * Drops trigger a dump this many samples later to also record the aftermath
+	 */
+	const uint postTriggerSamples_;
+	const uint64_t minMicrosBetweenAutoDumps_;
+	uint64_t lastAutoDumpMicros_;
+	uint samplesUntilAutoDump_;
+
+	static std::atomic<bool> dumpRequested_;
+	static std::mutex reasonMutex_;
+	static std::string dumpReason_;
+
+	void thread();
+	void onInterruption();
+
+	void takeSample(Sample& sample);
+
+	/**
+	 * @return true if anything has been dropped since the previous sample
+	 */
+	static bool hasDrops(const Sample& sample, const Sample& previous);
+
+	/**
+	 * Writes a copy of the ring in chronological order in a separate thread
+	 */
+	void dump(const std::string& reason);
+
+	static void writeSamples(std::vector<Sample> samples,
+			const std::string fileName, const std::string reason);
+};
+
+} /* namespace monitoring */
+} /* namespace na62 */
+
+#endif /* HIGHRESOLUTIONSAMPLER_H_ */
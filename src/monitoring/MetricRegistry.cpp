@@ -0,0 +1,102 @@
+/*
+ * MetricRegistry.cpp
+ *
+ *  Created on: Oct 16, 2026
+ *      Author: Jonas Kunze (kunze.jonas@gmail.com)
+ */
+
+#include "MetricRegistry.h"
+
+#include <options/Logging.h>
+#include <algorithm>
+#include <set>
+#include <sstream>
+
+namespace na62 {
+namespace monitoring {
+
+std::vector<MetricRegistry::MetricInfo> MetricRegistry::metrics_;
+std::vector<uint64_t> MetricRegistry::values_;
+std::vector<uint64_t> MetricRegistry::lastValues_;
+std::vector<uint64_t> MetricRegistry::differentials_;
+
+std::mutex MetricRegistry::publishMutex_;
+std::vector<uint64_t> MetricRegistry::publishedValues_;
+
+uint MetricRegistry::registerMetric(const std::string& name, const Type type,
+		const std::string& labels) {
+	values_.push_back(0);
+	lastValues_.push_back(0);
+	differentials_.push_back(0);
+
+	std::lock_guard<std::mutex> lock(publishMutex_);
+	metrics_.push_back( { name, labels, type });
+	publishedValues_.push_back(0);
+	return metrics_.size() - 1;
+}
+
+void MetricRegistry::updateDifferentials() {
+	for (uint handle = 0; handle != values_.size(); handle++) {
+		differentials_[handle] = values_[handle] - lastValues_[handle];
+		lastValues_[handle] = values_[handle];
+	}
+}
+
+void MetricRegistry::publish() {
+	std::lock_guard<std::mutex> lock(publishMutex_);
+	std::copy(values_.begin(), values_.end(), publishedValues_.begin());
+}
+
+void MetricRegistry::logValues() {
+	std::stringstream line;
+	for (uint handle = 0; handle != values_.size(); handle++) {
+		const uint64_t value =
+				metrics_[handle].type == COUNTER ?
+						differentials_[handle] : values_[handle];
+		if (value == 0) {
+			continue;
+		}
+		line << metrics_[handle].name;
+		if (!metrics_[handle].labels.empty()) {
+			line << "{" << metrics_[handle].labels << "}";
+		}
+		line << "=" << value << " ";
+	}
+	LOG_INFO<< line.str() << ENDL;
+}
+
+std::string MetricRegistry::toPrometheusText() {
+	std::lock_guard<std::mutex> lock(publishMutex_);
+
+	/*
+	 * All samples of one metric family have to be written together
+	 */
+	std::vector<uint> order(metrics_.size());
+	for (uint handle = 0; handle != order.size(); handle++) {
+		order[handle] = handle;
+	}
+	std::stable_sort(order.begin(), order.end(), [](uint a, uint b) {
+		return metrics_[a].name < metrics_[b].name;
+	});
+
+	std::stringstream text;
+	const std::string* lastName = nullptr;
+	for (uint handle : order) {
+		const MetricInfo& metric = metrics_[handle];
+		const std::string suffix = metric.type == COUNTER ? "_total" : "";
+		if (lastName == nullptr || *lastName != metric.name) {
+			text << "# TYPE na62_farm_" << metric.name << suffix
+					<< (metric.type == COUNTER ? " counter\n" : " gauge\n");
+			lastName = &metric.name;
+		}
+		text << "na62_farm_" << metric.name << suffix;
+		if (!metric.labels.empty()) {
+			text << "{" << metric.labels << "}";
+		}
+		text << " " << publishedValues_[handle] << "\n";
+	}
+	return text.str();
+}
+
+} /* namespace monitoring */
+} /* namespace na62 */
@@ -0,0 +1,105 @@
+/*
+ * MetricRegistry.h
+ *
+ *  Created on: Oct 16, 2026
+ *      Author: Jonas Kunze (kunze.jonas@gmail.com)
+ */
+
+#pragma once
+#ifndef METRICREGISTRY_H_
+#define METRICREGISTRY_H_
+
+#include <sys/types.h>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace na62 {
+namespace monitoring {
+
+/*
+ * All metrics published by the MonitorConnector. Metrics are registered once and then
+ * addressed by their integer handle. The values are stored in flat arrays and the
+ * differentials of all counters are computed at once by updateDifferentials.
+ *
+ * Only the MonitorConnector thread registers and sets metrics. The last published values
+ * can be read by other threads via toPrometheusText.
+ */
+class MetricRegistry {
+public:
+	enum Type {
+		/*
+		 * Monotonic value: the differential since the last update is available
+		 */
+		COUNTER,
+		/*
+		 * Current value like a queue depth or a ratio
+		 */
+		GAUGE
+	};
+
+	/**
+	 * @param labels Prometheus labels like detector="0x10" or an empty string
+	 *
+	 * @return The handle of the new metric
+	 */
+	static uint registerMetric(const std::string& name, const Type type,
+			const std::string& labels = "");
+
+	static inline void set(const uint handle, const uint64_t value) {
+		values_[handle] = value;
+	}
+
+	/**
+	 * @return The increase of the counter between the last two updateDifferentials calls
+	 */
+	static inline uint64_t getDifferential(const uint handle) {
+		return differentials_[handle];
+	}
+
+	/**
+	 * Computes the differentials of all counters. To be called after all counters have been
+	 * set and before derived gauges are calculated
+	 */
+	static void updateDifferentials();
+
+	/**
+	 * Makes the current values visible to toPrometheusText
+	 */
+	static void publish();
+
+	/**
+	 * Writes all metrics with their differential (counters) or value (gauges) to the log in
+	 * one line
+	 */
+	static void logValues();
+
+	/**
+	 * @return The last published values in the Prometheus text exposition format
+	 */
+	static std::string toPrometheusText();
+
+private:
+	struct MetricInfo {
+		std::string name;
+		std::string labels;
+		Type type;
+	};
+
+	static std::vector<MetricInfo> metrics_;
+	static std::vector<uint64_t> values_;
+	static std::vector<uint64_t> lastValues_;
+	static std::vector<uint64_t> differentials_;
+
+	/*
+	 * Protects metrics_ and publishedValues_ against the readers of toPrometheusText
+	 */
+	static std::mutex publishMutex_;
+	static std::vector<uint64_t> publishedValues_;
+};
+
+} /* namespace monitoring */
+} /* namespace na62 */
+
+#endif /* METRICREGISTRY_H_ */
@@ -0,0 +1,109 @@
+/*
+ * MetricsEndpoint.cpp
+ *
+ *  Created on: Oct 16, 2026
+ *      Author: Jonas Kunze (kunze.jonas@gmail.com)
+ */
+
+#include "MetricsEndpoint.h"
+
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+
+#include <options/Logging.h>
+
+#include "MetricRegistry.h"
+
+namespace na62 {
+namespace monitoring {
+
+MetricsEndpoint::MetricsEndpoint(const std::string& socketPath) :
+		socketPath_(socketPath), listenSocket_(-1), running_(true) {
+}
+
+MetricsEndpoint::~MetricsEndpoint() {
+	if (listenSocket_ >= 0) {
+		close(listenSocket_);
+		unlink(socketPath_.c_str());
+	}
+}
+
+void MetricsEndpoint::onInterruption() {
+	running_ = false;
+}
+
+void MetricsEndpoint::thread() {
+	struct sockaddr_un address;
+	memset(&address, 0, sizeof(address));
+	address.sun_family = AF_UNIX;
+	if (socketPath_.size() >= sizeof(address.sun_path)) {
+		LOG_ERROR<< "Metrics socket path too long: " << socketPath_ << ENDL;
+		return;
+	}
+	strcpy(address.sun_path, socketPath_.c_str());
+
+	listenSocket_ = socket(AF_UNIX, SOCK_STREAM, 0);
+	unlink(socketPath_.c_str());
+	if (listenSocket_ < 0
+			|| bind(listenSocket_, (struct sockaddr*) &address, sizeof(address))
+					!= 0 || listen(listenSocket_, 4) != 0) {
+		LOG_ERROR<< "Unable to open the metrics socket " << socketPath_ << ": "
+		<< strerror(errno) << ENDL;
+		return;
+	}
+	LOG_INFO<< "Serving metrics at " << socketPath_ << ENDL;
+
+	while (running_) {
+		/*
+		 * Wake up regularly to check whether we should stop
+		 */
+		struct pollfd pollSocket = { listenSocket_, POLLIN, 0 };
+		if (poll(&pollSocket, 1, 100) <= 0) {
+			continue;
+		}
+
+		const int clientSocket = accept(listenSocket_, nullptr, nullptr);
+		if (clientSocket < 0) {
+			continue;
+		}
+		serveClient(clientSocket);
+		close(clientSocket);
+	}
+}
+
+void MetricsEndpoint::serveClient(const int clientSocket) {
+	/*
+	 * The request itself is not interpreted: every path returns the metrics
+	 */
+	struct timeval timeout = { 0, 100000 };
+	setsockopt(clientSocket, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+	setsockopt(clientSocket, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+	char request[1024];
+	if (recv(clientSocket, request, sizeof(request), 0) < 0) {
+		return;
+	}
+
+	const std::string body = MetricRegistry::toPrometheusText();
+	const std::string response = "HTTP/1.0 200 OK\r\n"
+			"Content-Type: text/plain; version=0.0.4\r\n"
+			"Content-Length: " + std::to_string(body.size()) + "\r\n\r\n"
+			+ body;
+
+	size_t sent = 0;
+	while (sent != response.size()) {
+		const ssize_t result = send(clientSocket, response.data() + sent,
+				response.size() - sent, MSG_NOSIGNAL);
+		if (result <= 0) {
+			return;
+		}
+		sent += result;
+	}
+}
+
+} /* namespace monitoring */
+} /* namespace na62 */
@@ -0,0 +1,42 @@
+/*
+ * MetricsEndpoint.h
+ *
+ *  Created on: Oct 16, 2026
+ *      Author: Jonas Kunze (kunze.jonas@gmail.com)
+ */
+
+#pragma once
+#ifndef METRICSENDPOINT_H_
+#define METRICSENDPOINT_H_
+
+#include <utils/AExecutable.h>
+#include <string>
+
+namespace na62 {
+namespace monitoring {
+
+/*
+ * Serves the metrics of the MetricRegistry in the Prometheus text format on a local unix
+ * socket. Every connection gets a minimal HTTP response so that the endpoint can be read by
+ * curl --unix-socket <path> http://localhost/metrics or by a Prometheus proxy.
+ */
+class MetricsEndpoint: public AExecutable {
+public:
+	MetricsEndpoint(const std::string& socketPath);
+	virtual ~MetricsEndpoint();
+
+private:
+	const std::string socketPath_;
+	int listenSocket_;
+	bool running_;
+
+	void thread();
+	void onInterruption();
+
+	void serveClient(const int clientSocket);
+};
+
+} /* namespace monitoring */
+} /* namespace na62 */
+
+#endif /* METRICSENDPOINT_H_ */
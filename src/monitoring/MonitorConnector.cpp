@@ -15,8 +15,6 @@
 #include <boost/date_time/time_duration.hpp>
 #include <sstream>
 
-#include "../socket/HandleFrameTask.h"
-
 #include <iostream>
 
 #include <eventBuilding/SourceIDManager.h>
@@ -28,24 +26,290 @@
 #include <eventBuilding/UnfinishedEventsCollector.h>
 #include <options/Logging.h>
 
+#include "../benchmark/ThroughputBenchmark.h"
+#include "../eventBuilding/EventAgingService.h"
 #include "../eventBuilding/L1Builder.h"
 #include "../eventBuilding/L2Builder.h"
+#include "../eventBuilding/EventPipeline.h"
+#include "../eventBuilding/EventSpool.h"
+#include "../eventBuilding/EventTracer.h"
+#include "../eventBuilding/MergerSender.h"
+#include "../eventBuilding/OutputBufferPool.h"
+#include "../eventBuilding/OutputCompressor.h"
+#include "../eventBuilding/StorageHandler.h"
+#include "../eventBuilding/TriggerTask.h"
 #include "../socket/HandleFrameTask.h"
 #include "../socket/FragmentStore.h"
+#include "../socket/FrameBufferPool.h"
+#include "../socket/FrameValidator.h"
+#include "../socket/IdleStrategy.h"
 #include "../socket/PacketHandler.h"
+#include "../socket/PcapReplayer.h"
+#include "../socket/SlowPathHandler.h"
+#include "../options/MyOptions.h"
+#include "MetricRegistry.h"
 
 using namespace boost::interprocess;
 
 namespace na62 {
 namespace monitoring {
 
+/*
+ * Metrics with a fixed name. The order has to match FixedMetricDefinitions
+ */
+enum FixedMetric {
+	ENQUEUED_TASKS,
+	ENQUEUED_TRIGGER_TASKS,
+	BURST_ID,
+	NEXT_BURST_ID,
+	STATE_METRIC,
+	SLEEPS,
+	SPINS,
+	SPIN_MICROS,
+	WAIT_MICROS,
+	SLEEP_MICROS,
+	SEND_TIMER,
+	SPAWNED_TASKS,
+	FRAMES_VALIDATED,
+	FRAME_HEADER_ERRORS,
+	FRAME_CHECKSUM_ERRORS,
+	SLOW_PATH_FRAMES,
+	SLOW_PATH_FRAMES_DROPPED,
+	L1_BATCHES_PROCESSED,
+	FRAMES_PROCESSED_INLINE,
+	AGGREGATION_SIZE,
+	FRAMES_COPIED,
+	FRAME_ALLOCATIONS,
+	FRAME_BYTES_COPIED,
+	FRAME_BUFFERS_MOVED_TO_HEAP,
+	FRAME_ALLOCATIONS_PER_1000_FRAMES,
+	FRAME_BYTES_COPIED_PER_FRAME,
+	IP_FRAGMENTS_RECEIVED,
+	IP_DATAGRAMS_REASSEMBLED,
+	IP_FRAGMENTS_DROPPED,
+	IP_DATAGRAMS_UNFINISHED,
+	IP_DATAGRAMS_EVICTED,
+	IP_FRAGMENT_BYTES_HELD,
+	STORAGE_BYTES_COPIED,
+	STORAGE_BYTES_ZERO_COPY,
+	MERGER_EVENTS_SENT,
+	MERGER_MESSAGES_SENT,
+	MERGER_EVENTS_DROPPED,
+	MERGER_QUEUED_EVENTS,
+	COMPRESSION_BYTES_IN,
+	COMPRESSION_BYTES_OUT,
+	COMPRESSION_NANOS,
+	COMPRESSION_RATIO_PERCENT,
+	COMPRESSION_PICOS_PER_BYTE,
+	MERGER_QUEUES_CLOSED,
+	SPOOLED_EVENTS,
+	SPOOL_REPLAYED_EVENTS,
+	SPOOL_DROPPED_EVENTS,
+	SPOOL_BYTES_PENDING,
+	AGED_EVENTS_DROPPED,
+	AGING_TABLE_COLLISIONS,
+	AGING_LATE_FRAGMENTS,
+	AGING_EVENTS_IN_FLIGHT,
+	OUTPUT_BUFFER_HITS,
+	OUTPUT_BUFFER_MISSES,
+	OUTPUT_BUFFERS_CACHED,
+	OUTPUT_BUFFER_HIT_RATE_PERCENT,
+	FRAMES_REPLAYED,
+	BYTES_REPLAYED,
+	UNKNOWN_SOURCE_ID_FRAMES,
+	UNKNOWN_CREAM_FRAMES,
+	BYTES_RECEIVED,
+	FRAMES_RECEIVED,
+	FRAME_SIZE,
+	BYTES_TO_MERGER,
+	EVENTS_TO_MERGER,
+	L1_MRPS_SENT,
+	L1_TRIGGERS_SENT,
+	FRAMES_SENT,
+	OUT_FRAMES_QUEUED,
+	NUMBER_OF_FIXED_METRICS
+};
+
+struct FixedMetricDefinition {
+	const char* name;
+	MetricRegistry::Type type;
+};
+
+static const FixedMetricDefinition FixedMetricDefinitions[] = {
+		{ "EnqueuedTasks", MetricRegistry::GAUGE },
+		{ "EnqueuedTriggerTasks", MetricRegistry::GAUGE },
+		{ "BurstID", MetricRegistry::GAUGE },
+		{ "NextBurstID", MetricRegistry::GAUGE },
+		{ "State", MetricRegistry::GAUGE },
+		{ "Sleeps", MetricRegistry::COUNTER },
+		{ "Spins", MetricRegistry::COUNTER },
+		{ "SpinMicros", MetricRegistry::COUNTER },
+		{ "WaitMicros", MetricRegistry::COUNTER },
+		{ "SleepMicros", MetricRegistry::COUNTER },
+		{ "SendTimer", MetricRegistry::GAUGE },
+		{ "SpawnedTasks", MetricRegistry::COUNTER },
+		{ "FramesValidated", MetricRegistry::COUNTER },
+		{ "FrameHeaderErrors", MetricRegistry::COUNTER },
+		{ "FrameChecksumErrors", MetricRegistry::COUNTER },
+		{ "SlowPathFrames", MetricRegistry::COUNTER },
+		{ "SlowPathFramesDropped", MetricRegistry::COUNTER },
+		{ "L1BatchesProcessed", MetricRegistry::COUNTER },
+		{ "FramesProcessedInline", MetricRegistry::COUNTER },
+		{ "AggregationSize", MetricRegistry::GAUGE },
+		{ "FramesCopied", MetricRegistry::COUNTER },
+		{ "FrameAllocations", MetricRegistry::COUNTER },
+		{ "FrameBytesCopied", MetricRegistry::COUNTER },
+		{ "FrameBuffersMovedToHeap", MetricRegistry::COUNTER },
+		{ "FrameAllocationsPer1000Frames", MetricRegistry::GAUGE },
+		{ "FrameBytesCopiedPerFrame", MetricRegistry::GAUGE },
+		{ "IPFragmentsReceived", MetricRegistry::COUNTER },
+		{ "IPDatagramsReassembled", MetricRegistry::COUNTER },
+		{ "IPFragmentsDropped", MetricRegistry::COUNTER },
+		{ "IPDatagramsUnfinished", MetricRegistry::GAUGE },
+		{ "IPDatagramsEvicted", MetricRegistry::COUNTER },
+		{ "IPFragmentBytesHeld", MetricRegistry::GAUGE },
+		{ "StorageBytesCopied", MetricRegistry::COUNTER },
+		{ "StorageBytesZeroCopy", MetricRegistry::COUNTER },
+		{ "MergerEventsSent", MetricRegistry::COUNTER },
+		{ "MergerMessagesSent", MetricRegistry::COUNTER },
+		{ "MergerEventsDropped", MetricRegistry::COUNTER },
+		{ "MergerQueuedEvents", MetricRegistry::GAUGE },
+		{ "CompressionBytesIn", MetricRegistry::COUNTER },
+		{ "CompressionBytesOut", MetricRegistry::COUNTER },
+		{ "CompressionNanos", MetricRegistry::COUNTER },
+		{ "CompressionRatioPercent", MetricRegistry::GAUGE },
+		{ "CompressionPicosPerByte", MetricRegistry::GAUGE },
+		{ "MergerQueuesClosed", MetricRegistry::GAUGE },
+		{ "SpooledEvents", MetricRegistry::COUNTER },
+		{ "SpoolReplayedEvents", MetricRegistry::COUNTER },
+		{ "SpoolDroppedEvents", MetricRegistry::COUNTER },
+		{ "SpoolBytesPending", MetricRegistry::GAUGE },
+		{ "AgedEventsDropped", MetricRegistry::COUNTER },
+		{ "AgingTableCollisions", MetricRegistry::COUNTER },
+		{ "AgingLateFragments", MetricRegistry::COUNTER },
+		{ "AgingEventsInFlight", MetricRegistry::GAUGE },
+		{ "OutputBufferHits", MetricRegistry::COUNTER },
+		{ "OutputBufferMisses", MetricRegistry::COUNTER },
+		{ "OutputBuffersCached", MetricRegistry::GAUGE },
+		{ "OutputBufferHitRatePercent", MetricRegistry::GAUGE },
+		{ "FramesReplayed", MetricRegistry::COUNTER },
+		{ "BytesReplayed", MetricRegistry::COUNTER },
+		{ "UnknownSourceIDFrames", MetricRegistry::COUNTER },
+		{ "UnknownCREAMFrames", MetricRegistry::COUNTER },
+		{ "BytesReceived", MetricRegistry::COUNTER },
+		{ "FramesReceived", MetricRegistry::COUNTER },
+		{ "FrameSize", MetricRegistry::GAUGE },
+		{ "BytesToMerger", MetricRegistry::COUNTER },
+		{ "EventsToMerger", MetricRegistry::COUNTER },
+		{ "L1MRPsSent", MetricRegistry::COUNTER },
+		{ "L1TriggersSent", MetricRegistry::COUNTER },
+		{ "FramesSent", MetricRegistry::COUNTER },
+		{ "OutFramesQueued", MetricRegistry::GAUGE } };
+
+static_assert(
+		sizeof(FixedMetricDefinitions) / sizeof(FixedMetricDefinition)
+				== NUMBER_OF_FIXED_METRICS,
+		"FixedMetricDefinitions does not match FixedMetric");
+
+/*
+ * Metrics per detector (source number) and per pipeline stage
+ */
+enum DetectorMetric {
+	DETECTOR_MEPS_RECEIVED,
+	DETECTOR_EVENTS_RECEIVED,
+	DETECTOR_BYTES_RECEIVED,
+	DETECTOR_NON_REQUESTED_CREAM_FRAGMENTS,
+	DETECTOR_AGED_EVENTS_MISSING,
+	NUMBER_OF_DETECTOR_METRICS
+};
+
+enum PipelineMetric {
+	PIPELINE_QUEUE_DEPTH,
+	PIPELINE_PROCESSED,
+	PIPELINE_NANOS,
+	PIPELINE_CALLER_RUNS,
+	PIPELINE_NANOS_PER_EVENT,
+	NUMBER_OF_PIPELINE_METRICS
+};
+
+static std::string hexLabel(const char* label, const uint value) {
+	std::stringstream stream;
+	stream << label << "=\"0x" << std::hex << value << "\"";
+	return stream.str();
+}
+
 STATE MonitorConnector::currentState_;
 MonitorConnector::MonitorConnector() :
-		timer_(monitoringService) {
+		timer_(monitoringService), logInterval_(
+				Options::GetInt(OPTION_MONITOR_LOG_INTERVAL)), updatesSinceLog_(
+				0) {
+	registerMetrics();
 
 	LOG_INFO<<"Started monitor connector";
 }
 
+void MonitorConnector::registerMetrics() {
+	for (uint metric = 0; metric != NUMBER_OF_FIXED_METRICS; metric++) {
+		metrics_.push_back(
+				MetricRegistry::registerMetric(
+						FixedMetricDefinitions[metric].name,
+						FixedMetricDefinitions[metric].type));
+	}
+
+	for (uint word = 0; word != 0x100; word++) {
+		l1TriggerMetrics_[word] = MetricRegistry::registerMetric("L1Triggers",
+				MetricRegistry::COUNTER, hexLabel("word", word));
+		l2TriggerMetrics_[word] = MetricRegistry::registerMetric("L2Triggers",
+				MetricRegistry::COUNTER, hexLabel("word", word));
+	}
+
+	/*
+	 * The LKr statistics are stored at SourceIDManager::NUMBER_OF_L0_DATA_SOURCES
+	 */
+	const uint lkrSourceNum = SourceIDManager::NUMBER_OF_L0_DATA_SOURCES;
+	for (uint sourceNum = 0; sourceNum <= lkrSourceNum; sourceNum++) {
+		const uint sourceID =
+				sourceNum == lkrSourceNum ?
+						SOURCE_ID_LKr : SourceIDManager::SourceNumToID(sourceNum);
+		const std::string label = hexLabel("detector", sourceID);
+		detectorMetrics_.push_back(
+				MetricRegistry::registerMetric("DetectorMEPsReceived",
+						MetricRegistry::COUNTER, label));
+		detectorMetrics_.push_back(
+				MetricRegistry::registerMetric("DetectorEventsReceived",
+						MetricRegistry::COUNTER, label));
+		detectorMetrics_.push_back(
+				MetricRegistry::registerMetric("DetectorBytesReceived",
+						MetricRegistry::COUNTER, label));
+		detectorMetrics_.push_back(
+				MetricRegistry::registerMetric("DetectorNonRequestedCreamFrags",
+						MetricRegistry::COUNTER, label));
+		detectorMetrics_.push_back(
+				MetricRegistry::registerMetric("DetectorAgedEventsMissing",
+						MetricRegistry::COUNTER, label));
+	}
+
+	for (uint i = 0; i != EventPipeline::NumberOfStages; i++) {
+		const std::string label = "stage=\""
+				+ EventPipeline::Stages[i]->getName() + "\"";
+		pipelineMetrics_.push_back(
+				MetricRegistry::registerMetric("PipelineQueueDepth",
+						MetricRegistry::GAUGE, label));
+		pipelineMetrics_.push_back(
+				MetricRegistry::registerMetric("PipelineProcessed",
+						MetricRegistry::COUNTER, label));
+		pipelineMetrics_.push_back(
+				MetricRegistry::registerMetric("PipelineNanos",
+						MetricRegistry::COUNTER, label));
+		pipelineMetrics_.push_back(
+				MetricRegistry::registerMetric("PipelineCallerRuns",
+						MetricRegistry::COUNTER, label));
+		pipelineMetrics_.push_back(
+				MetricRegistry::registerMetric("PipelineNanosPerEvent",
+						MetricRegistry::GAUGE, label));
+	}
+}
+
 void MonitorConnector::thread() {
 
 	timer_.expires_from_now(boost::posix_time::milliseconds(1000));
@@ -76,26 +340,136 @@ void MonitorConnector::handleUpdate() {
 
 	IPCHandler::updateState(currentState_);
 
-	LOG_INFO<<"Enqueued tasks:\t" << HandleFrameTask::getNumberOfQeuedTasks();
+	const std::vector<uint>& m = metrics_;
 
-	LOG_INFO<<"IPFragments:\t" << FragmentStore::getNumberOfReceivedFragments()<<"/"<<FragmentStore::getNumberOfReassembledFrames() <<"/"<<FragmentStore::getNumberOfUnfinishedFrames();
+	MetricRegistry::set(m[ENQUEUED_TASKS],
+			HandleFrameTask::getNumberOfQeuedTasks());
+	MetricRegistry::set(m[ENQUEUED_TRIGGER_TASKS],
+			TriggerTask::getNumberOfQueuedTasks());
+	MetricRegistry::set(m[BURST_ID], PacketHandler::getCurrentBurstId());
+	MetricRegistry::set(m[NEXT_BURST_ID], PacketHandler::getNextBurstId());
+	MetricRegistry::set(m[STATE_METRIC], currentState_);
 
-	LOG_INFO<<"BurstID:\t" << PacketHandler::getCurrentBurstId();
-	LOG_INFO<<"NextBurstID:\t" << PacketHandler::getNextBurstId();
+	MetricRegistry::set(m[SLEEPS], PacketHandler::sleeps_);
+	MetricRegistry::set(m[SPINS], PacketHandler::spins_);
 
-	LOG_INFO<<"State:\t" << currentState_;
-
-	setDifferentialData("Sleeps", PacketHandler::sleeps_);
-	setDifferentialData("Spins", PacketHandler::spins_);
-	setContinuousData("SendTimer",
+	/*
+	 * Time the PacketHandlers spent in each idle tier
+	 */
+	MetricRegistry::set(m[SPIN_MICROS],
+			IdleStrategy::GetMicrosInTier(IdleStrategy::SPIN));
+	MetricRegistry::set(m[WAIT_MICROS],
+			IdleStrategy::GetMicrosInTier(IdleStrategy::WAIT));
+	MetricRegistry::set(m[SLEEP_MICROS],
+			IdleStrategy::GetMicrosInTier(IdleStrategy::SLEEP));
+	MetricRegistry::set(m[SEND_TIMER],
 			PacketHandler::sendTimer.elapsed().wall / 1000);
-	setDifferentialData("SpawnedTasks",
+	MetricRegistry::set(m[SPAWNED_TASKS],
 			PacketHandler::frameHandleTasksSpawned_);
-	setContinuousData("AggregationSize",
-			NetworkHandler::GetFramesReceived()
-					/ (float) PacketHandler::frameHandleTasksSpawned_);
+	MetricRegistry::set(m[FRAMES_VALIDATED],
+			FrameValidator::GetFramesValidated());
+	MetricRegistry::set(m[FRAME_HEADER_ERRORS],
+			FrameValidator::GetHeaderErrors());
+	MetricRegistry::set(m[FRAME_CHECKSUM_ERRORS],
+			FrameValidator::GetChecksumErrors());
+	MetricRegistry::set(m[SLOW_PATH_FRAMES],
+			SlowPathHandler::GetFramesProcessed());
+	MetricRegistry::set(m[SLOW_PATH_FRAMES_DROPPED],
+			SlowPathHandler::GetFramesDropped());
+	MetricRegistry::set(m[L1_BATCHES_PROCESSED],
+			L1Builder::GetL1BatchesProcessed());
+	MetricRegistry::set(m[FRAMES_PROCESSED_INLINE],
+			PacketHandler::framesProcessedInline_);
+	if (PacketHandler::frameHandleTasksSpawned_ != 0) {
+		MetricRegistry::set(m[AGGREGATION_SIZE],
+				NetworkHandler::GetFramesReceived()
+						/ PacketHandler::frameHandleTasksSpawned_);
+	}
 
-	NetworkHandler::PrintStats();
+	/*
+	 * Heap allocations and bytes copied for received frames
+	 */
+	MetricRegistry::set(m[FRAMES_COPIED], FrameBufferPool::GetFramesCopied());
+	MetricRegistry::set(m[FRAME_ALLOCATIONS],
+			FrameBufferPool::GetAllocations());
+	MetricRegistry::set(m[FRAME_BYTES_COPIED],
+			FrameBufferPool::GetBytesCopied());
+	MetricRegistry::set(m[FRAME_BUFFERS_MOVED_TO_HEAP],
+			FrameBufferPool::GetBuffersMovedToHeap());
+
+	MetricRegistry::set(m[IP_FRAGMENTS_RECEIVED],
+			FragmentStore::getNumberOfReceivedFragments());
+	MetricRegistry::set(m[IP_DATAGRAMS_REASSEMBLED],
+			FragmentStore::getNumberOfReassembledFrames());
+	MetricRegistry::set(m[IP_FRAGMENTS_DROPPED],
+			FragmentStore::getNumberOfDroppedFragments());
+	MetricRegistry::set(m[IP_DATAGRAMS_UNFINISHED],
+			FragmentStore::getNumberOfUnfinishedFrames());
+	MetricRegistry::set(m[IP_DATAGRAMS_EVICTED],
+			FragmentStore::getNumberOfEvictedDatagrams());
+	MetricRegistry::set(m[IP_FRAGMENT_BYTES_HELD],
+			FragmentStore::getNumberOfBytesHeld());
+
+	MetricRegistry::set(m[STORAGE_BYTES_COPIED],
+			StorageHandler::GetBytesCopied());
+	MetricRegistry::set(m[STORAGE_BYTES_ZERO_COPY],
+			StorageHandler::GetBytesSentZeroCopy());
+	MetricRegistry::set(m[MERGER_EVENTS_SENT], MergerSender::GetEventsSent());
+	MetricRegistry::set(m[MERGER_MESSAGES_SENT],
+			MergerSender::GetMessagesSent());
+	MetricRegistry::set(m[MERGER_EVENTS_DROPPED],
+			MergerSender::GetEventsDropped());
+	MetricRegistry::set(m[MERGER_QUEUED_EVENTS],
+			MergerSender::GetNumberOfQueuedEvents());
+	if (OutputCompressor::IsEnabled()) {
+		MetricRegistry::set(m[COMPRESSION_BYTES_IN],
+				OutputCompressor::GetBytesIn());
+		MetricRegistry::set(m[COMPRESSION_BYTES_OUT],
+				OutputCompressor::GetBytesOut());
+		MetricRegistry::set(m[COMPRESSION_NANOS],
+				OutputCompressor::GetNanosSpent());
+	}
+	MetricRegistry::set(m[MERGER_QUEUES_CLOSED], MergerSender::IsClosed());
+	MetricRegistry::set(m[SPOOLED_EVENTS], EventSpool::GetEventsSpooled());
+	MetricRegistry::set(m[SPOOL_REPLAYED_EVENTS],
+			EventSpool::GetEventsReplayed());
+	MetricRegistry::set(m[SPOOL_DROPPED_EVENTS], EventSpool::GetEventsDropped());
+	MetricRegistry::set(m[SPOOL_BYTES_PENDING], EventSpool::GetBytesPending());
+	if (EventAgingService::IsEnabled()) {
+		MetricRegistry::set(m[AGED_EVENTS_DROPPED],
+				EventAgingService::GetEventsDropped());
+		MetricRegistry::set(m[AGING_TABLE_COLLISIONS],
+				EventAgingService::GetTableCollisions());
+		MetricRegistry::set(m[AGING_LATE_FRAGMENTS],
+				EventAgingService::GetLateFragments());
+		MetricRegistry::set(m[AGING_EVENTS_IN_FLIGHT],
+				EventAgingService::GetEventsInFlight());
+	}
+	MetricRegistry::set(m[OUTPUT_BUFFER_HITS], OutputBufferPool::GetHits());
+	MetricRegistry::set(m[OUTPUT_BUFFER_MISSES], OutputBufferPool::GetMisses());
+	MetricRegistry::set(m[OUTPUT_BUFFERS_CACHED],
+			OutputBufferPool::GetBuffersCached());
+
+	for (uint i = 0; i != EventPipeline::NumberOfStages; i++) {
+		const PipelineStage* stage = EventPipeline::Stages[i];
+		const uint* stageMetrics = &pipelineMetrics_[i
+				* NUMBER_OF_PIPELINE_METRICS];
+		MetricRegistry::set(stageMetrics[PIPELINE_QUEUE_DEPTH],
+				stage->getQueueDepth());
+		MetricRegistry::set(stageMetrics[PIPELINE_PROCESSED],
+				stage->getEventsProcessed());
+		MetricRegistry::set(stageMetrics[PIPELINE_NANOS],
+				stage->getNanosSpent());
+		MetricRegistry::set(stageMetrics[PIPELINE_CALLER_RUNS],
+				stage->getCallerRuns());
+	}
+
+	if (PcapReplayer::IsActive()) {
+		MetricRegistry::set(m[FRAMES_REPLAYED],
+				PcapReplayer::GetFramesReplayed());
+		MetricRegistry::set(m[BYTES_REPLAYED],
+				PcapReplayer::GetBytesReplayed());
+	}
 
 	IPCHandler::sendStatistics("PF_BytesReceived",
 			std::to_string(NetworkHandler::GetBytesReceived()));
@@ -104,7 +478,6 @@ void MonitorConnector::handleUpdate() {
 	IPCHandler::sendStatistics("PF_PacksDropped",
 			std::to_string(NetworkHandler::GetFramesDropped()));
 
-	LOG_INFO<<"########################";
 	/*
 	 * Number of Events and data rate from all detectors
 	 */
@@ -112,31 +485,29 @@ void MonitorConnector::handleUpdate() {
 	for (int soruceIDNum = SourceIDManager::NUMBER_OF_L0_DATA_SOURCES - 1;
 			soruceIDNum >= 0; soruceIDNum--) {
 		uint8_t sourceID = SourceIDManager::SourceNumToID(soruceIDNum);
+		const uint* sourceMetrics = &detectorMetrics_[soruceIDNum
+				* NUMBER_OF_DETECTOR_METRICS];
 		statistics << "0x" << std::hex << (int) sourceID << ";";
 
 		if (SourceIDManager::getExpectedPacksBySourceID(sourceID) > 0) {
-			setDetectorDifferentialData("MEPsReceived",
-					HandleFrameTask::GetMEPsReceivedBySourceNum(soruceIDNum)
-							/ SourceIDManager::getExpectedPacksBySourceID(
-									sourceID), sourceID);
-
-			statistics << std::dec
-					<< HandleFrameTask::GetMEPsReceivedBySourceNum(soruceIDNum)
-							/ SourceIDManager::getExpectedPacksBySourceID(
-									sourceID) << ";";
+			const uint64_t meps = HandleFrameTask::GetMEPsReceivedBySourceNum(
+					soruceIDNum)
+					/ SourceIDManager::getExpectedPacksBySourceID(sourceID);
+			MetricRegistry::set(sourceMetrics[DETECTOR_MEPS_RECEIVED], meps);
+			statistics << std::dec << meps << ";";
 		}
 
-		setDetectorDifferentialData("EventsReceived",
-				Event::getMissingEventsBySourceNum(soruceIDNum), sourceID);
-		statistics << std::dec
-				<< Event::getMissingEventsBySourceNum(soruceIDNum) << ";";
-
-		setDetectorDifferentialData("BytesReceived",
-				HandleFrameTask::GetBytesReceivedBySourceNum(soruceIDNum),
-				sourceID);
-		statistics << std::dec
-				<< HandleFrameTask::GetBytesReceivedBySourceNum(soruceIDNum)
-				<< ";";
+		const uint64_t events = Event::getMissingEventsBySourceNum(soruceIDNum);
+		MetricRegistry::set(sourceMetrics[DETECTOR_EVENTS_RECEIVED], events);
+		statistics << std::dec << events << ";";
+
+		const uint64_t bytes = HandleFrameTask::GetBytesReceivedBySourceNum(
+				soruceIDNum);
+		MetricRegistry::set(sourceMetrics[DETECTOR_BYTES_RECEIVED], bytes);
+		statistics << std::dec << bytes << ";";
+
+		MetricRegistry::set(sourceMetrics[DETECTOR_AGED_EVENTS_MISSING],
+				EventAgingService::GetMissingEventsBySourceNum(soruceIDNum));
 	}
 
 	if (SourceIDManager::NUMBER_OF_EXPECTED_CREAM_PACKETS_PER_EVENT != 0) {
@@ -145,55 +516,74 @@ void MonitorConnector::handleUpdate() {
 		/*
 		 * Store CREAM specific statistics stored at SourceIDManager::NUMBER_OF_L0_DATA_SOURCES as sourceNum
 		 */
-		setDetectorDifferentialData("MEPsReceived",
-				HandleFrameTask::GetMEPsReceivedBySourceNum(
-						SourceIDManager::NUMBER_OF_L0_DATA_SOURCES)
-						/ (SourceIDManager::NUMBER_OF_EXPECTED_CREAM_PACKETS_PER_EVENT),
-				SOURCE_ID_LKr);
-		statistics << std::dec
-				<< HandleFrameTask::GetMEPsReceivedBySourceNum(
-						SourceIDManager::NUMBER_OF_L0_DATA_SOURCES)
-						/ (SourceIDManager::NUMBER_OF_EXPECTED_CREAM_PACKETS_PER_EVENT)
-				<< ";";
-
-		setDetectorDifferentialData("EventsReceived",
-				Event::getMissingEventsBySourceNum(
-						SourceIDManager::NUMBER_OF_L0_DATA_SOURCES),
-				SOURCE_ID_LKr);
-
-		statistics << std::dec
-				<< Event::getMissingEventsBySourceNum(
-						SourceIDManager::NUMBER_OF_L0_DATA_SOURCES) << ";";
-
-		setDetectorDifferentialData("BytesReceived",
-				HandleFrameTask::GetBytesReceivedBySourceNum(
-						SourceIDManager::NUMBER_OF_L0_DATA_SOURCES),
-				SOURCE_ID_LKr);
-		statistics << std::dec
-				<< HandleFrameTask::GetBytesReceivedBySourceNum(
-						SourceIDManager::NUMBER_OF_L0_DATA_SOURCES) << ";";
-
-		setDetectorDifferentialData("NonRequestedCreamFrags",
-				Event::getNumberOfNonRequestedCreamFragments(),
-				SOURCE_ID_LKr);
+		const uint lkrSourceNum = SourceIDManager::NUMBER_OF_L0_DATA_SOURCES;
+		const uint* lkrMetrics = &detectorMetrics_[lkrSourceNum
+				* NUMBER_OF_DETECTOR_METRICS];
+
+		const uint64_t meps = HandleFrameTask::GetMEPsReceivedBySourceNum(
+				lkrSourceNum)
+				/ (SourceIDManager::NUMBER_OF_EXPECTED_CREAM_PACKETS_PER_EVENT);
+		MetricRegistry::set(lkrMetrics[DETECTOR_MEPS_RECEIVED], meps);
+		statistics << std::dec << meps << ";";
+
+		const uint64_t events = Event::getMissingEventsBySourceNum(
+				lkrSourceNum);
+		MetricRegistry::set(lkrMetrics[DETECTOR_EVENTS_RECEIVED], events);
+		statistics << std::dec << events << ";";
+
+		const uint64_t bytes = HandleFrameTask::GetBytesReceivedBySourceNum(
+				lkrSourceNum);
+		MetricRegistry::set(lkrMetrics[DETECTOR_BYTES_RECEIVED], bytes);
+		statistics << std::dec << bytes << ";";
+
+		MetricRegistry::set(lkrMetrics[DETECTOR_NON_REQUESTED_CREAM_FRAGMENTS],
+				Event::getNumberOfNonRequestedCreamFragments());
 	}
 
 	IPCHandler::sendStatistics("DetectorData", statistics.str());
 
+	/*
+	 * Frames dropped because of unknown source IDs or inactive CREAMs
+	 */
+	std::stringstream unknownSourceIDs;
+	uint64_t unknownSourceIDFrames = 0;
+	for (uint sourceID = 0; sourceID != 0x100; sourceID++) {
+		uint64_t frames = HandleFrameTask::GetUnknownSourceIDFrames(sourceID);
+		if (frames != 0) {
+			unknownSourceIDs << "0x" << std::hex << sourceID << ";" << std::dec
+					<< frames << ";";
+			unknownSourceIDFrames += frames;
+		}
+	}
+	std::stringstream unknownCREAMs;
+	uint64_t unknownCREAMFrames = 0;
+	for (uint crateID = 0; crateID != 0x100; crateID++) {
+		for (uint creamID = 0; creamID != 0x100; creamID++) {
+			uint64_t frames = HandleFrameTask::GetUnknownCREAMFrames(crateID,
+					creamID);
+			if (frames != 0) {
+				unknownCREAMs << crateID << ":" << creamID << ";" << frames
+						<< ";";
+				unknownCREAMFrames += frames;
+			}
+		}
+	}
+	MetricRegistry::set(m[UNKNOWN_SOURCE_ID_FRAMES], unknownSourceIDFrames);
+	MetricRegistry::set(m[UNKNOWN_CREAM_FRAMES], unknownCREAMFrames);
+	IPCHandler::sendStatistics("UnknownSourceIDs", unknownSourceIDs.str());
+	IPCHandler::sendStatistics("UnknownCREAMs", unknownCREAMs.str());
+
 	/*
 	 * Trigger word statistics
 	 */
 	std::stringstream L1Stats;
 	std::stringstream L2Stats;
 	for (int wordNum = 0x00; wordNum <= 0xFF; wordNum++) {
-		std::stringstream stream;
-		stream << std::hex << wordNum;
-
-		uint64_t L1Trigs = L1Builder::GetL1TriggerStats()[wordNum];
-		uint64_t L2Trigs = L2Builder::GetL2TriggerStats()[wordNum];
+		uint64_t L1Trigs = L1Builder::GetL1TriggerStats(wordNum);
+		uint64_t L2Trigs = L2Builder::GetL2TriggerStats(wordNum);
 
-		setDifferentialData("L1Triggers" + stream.str(), L1Trigs);
-		setDifferentialData("L2Triggers" + stream.str(), L2Trigs);
+		MetricRegistry::set(l1TriggerMetrics_[wordNum], L1Trigs);
+		MetricRegistry::set(l2TriggerMetrics_[wordNum], L2Trigs);
 
 		if (L1Trigs > 0) {
 			L1Stats << "0b";
@@ -208,101 +598,126 @@ void MonitorConnector::handleUpdate() {
 		}
 	}
 
-	LOG_INFO<<"########################";
-
-	setDifferentialData("BytesReceived", NetworkHandler::GetBytesReceived());
-	setDifferentialData("FramesReceived", NetworkHandler::GetFramesReceived());
-	if (getDifferentialValue("FramesReceived") != 0) {
-		setContinuousData("FrameSize",
-				getDifferentialValue("BytesReceived")
-						/ getDifferentialValue("FramesReceived"));
-	}
+	MetricRegistry::set(m[BYTES_RECEIVED], NetworkHandler::GetBytesReceived());
+	MetricRegistry::set(m[FRAMES_RECEIVED],
+			NetworkHandler::GetFramesReceived());
 
 	IPCHandler::sendStatistics("L1TriggerData", L1Stats.str());
 	IPCHandler::sendStatistics("L2TriggerData", L2Stats.str());
-	uint32_t bytesToStorage = L2Builder::GetBytesSentToStorage();
-	uint32_t eventsToStorage = L2Builder::GetEventsSentToStorage();
+	uint64_t bytesToStorage = L2Builder::GetBytesSentToStorage();
+	uint64_t eventsToStorage = L2Builder::GetEventsSentToStorage();
 
-	setDifferentialData("BytesToMerger", bytesToStorage);
-	setDifferentialData("EventsToMerger", eventsToStorage);
+	MetricRegistry::set(m[BYTES_TO_MERGER], bytesToStorage);
+	MetricRegistry::set(m[EVENTS_TO_MERGER], eventsToStorage);
 
 	IPCHandler::sendStatistics("BytesToMerger", std::to_string(bytesToStorage));
 	IPCHandler::sendStatistics("EventsToMerger",
 			std::to_string(eventsToStorage));
 
-	setDifferentialData("L1MRPsSent",
+	MetricRegistry::set(m[L1_MRPS_SENT],
 			cream::L1DistributionHandler::GetL1MRPsSent());
 	IPCHandler::sendStatistics("L1MRPsSent",
 			std::to_string(cream::L1DistributionHandler::GetL1MRPsSent()));
 
-	setDifferentialData("L1TriggersSent",
+	MetricRegistry::set(m[L1_TRIGGERS_SENT],
 			cream::L1DistributionHandler::GetL1TriggersSent());
 	IPCHandler::sendStatistics("L1TriggersSent",
 			std::to_string(cream::L1DistributionHandler::GetL1TriggersSent()));
 
-	setDifferentialData("FramesSent", NetworkHandler::GetFramesSent());
-	setContinuousData("OutFramesQueued",
+	MetricRegistry::set(m[FRAMES_SENT], NetworkHandler::GetFramesSent());
+	MetricRegistry::set(m[OUT_FRAMES_QUEUED],
 			NetworkHandler::getNumberOfEnqueuedSendFrames());
 
-	LOG_INFO<<"IPFragments:\t" << FragmentStore::getNumberOfReceivedFragments()<<"/"<<FragmentStore::getNumberOfReassembledFrames() <<"/"<<FragmentStore::getNumberOfUnfinishedFrames();
-	LOG_INFO<<"=======================================";
-
-	IPCHandler::sendStatistics("UnfinishedEventsData",
-			UnfinishedEventsCollector::toJson());
-}
-
-uint64_t MonitorConnector::setDifferentialData(std::string key,
-		uint64_t value) {
-
-	if (differentialInts_.find(key) == differentialInts_.end()) {
-		differentialInts_[key + LAST_VALUE_SUFFIX] = 0;
-		differentialInts_[key] = 0;
+	/*
+	 * Ratios of the changes within the last second
+	 */
+	MetricRegistry::updateDifferentials();
+
+	if (MetricRegistry::getDifferential(m[FRAMES_COPIED]) != 0) {
+		MetricRegistry::set(m[FRAME_ALLOCATIONS_PER_1000_FRAMES],
+				1000 * MetricRegistry::getDifferential(m[FRAME_ALLOCATIONS])
+						/ MetricRegistry::getDifferential(m[FRAMES_COPIED]));
+		MetricRegistry::set(m[FRAME_BYTES_COPIED_PER_FRAME],
+				MetricRegistry::getDifferential(m[FRAME_BYTES_COPIED])
+						/ MetricRegistry::getDifferential(m[FRAMES_COPIED]));
 	}
-	uint64_t lastValue = differentialInts_[key];
-
-	if (value != 0) {
-		if (key == "BytesReceived") {
-			LOG_INFO<<key << ":\t" << Utils::FormatSize(value - differentialInts_[key]) << " (" << Utils::FormatSize(value) <<")";
-		} else {
-			LOG_INFO<<key << ":\t" << std::to_string(value - differentialInts_[key]) << " (" << std::to_string(value) <<")";
+	if (MetricRegistry::getDifferential(m[COMPRESSION_BYTES_IN]) != 0) {
+		MetricRegistry::set(m[COMPRESSION_RATIO_PERCENT],
+				100 * MetricRegistry::getDifferential(m[COMPRESSION_BYTES_OUT])
+						/ MetricRegistry::getDifferential(
+								m[COMPRESSION_BYTES_IN]));
+		MetricRegistry::set(m[COMPRESSION_PICOS_PER_BYTE],
+				1000 * MetricRegistry::getDifferential(m[COMPRESSION_NANOS])
+						/ MetricRegistry::getDifferential(
+								m[COMPRESSION_BYTES_IN]));
+	}
+	const uint64_t outputBufferRequests = MetricRegistry::getDifferential(
+			m[OUTPUT_BUFFER_HITS])
+			+ MetricRegistry::getDifferential(m[OUTPUT_BUFFER_MISSES]);
+	if (outputBufferRequests != 0) {
+		MetricRegistry::set(m[OUTPUT_BUFFER_HIT_RATE_PERCENT],
+				100 * MetricRegistry::getDifferential(m[OUTPUT_BUFFER_HITS])
+						/ outputBufferRequests);
+	}
+	if (MetricRegistry::getDifferential(m[FRAMES_RECEIVED]) != 0) {
+		MetricRegistry::set(m[FRAME_SIZE],
+				MetricRegistry::getDifferential(m[BYTES_RECEIVED])
+						/ MetricRegistry::getDifferential(m[FRAMES_RECEIVED]));
+	}
+	for (uint i = 0; i != EventPipeline::NumberOfStages; i++) {
+		const uint* stageMetrics = &pipelineMetrics_[i
+				* NUMBER_OF_PIPELINE_METRICS];
+		const uint64_t processed = MetricRegistry::getDifferential(
+				stageMetrics[PIPELINE_PROCESSED]);
+		if (processed != 0) {
+			MetricRegistry::set(stageMetrics[PIPELINE_NANOS_PER_EVENT],
+					MetricRegistry::getDifferential(
+							stageMetrics[PIPELINE_NANOS]) / processed);
 		}
-
 	}
 
-	differentialInts_[key + LAST_VALUE_SUFFIX] = differentialInts_[key];
-	differentialInts_[key] = value;
-	return value - lastValue;
-}
-
-uint64_t MonitorConnector::getDifferentialValue(std::string key) {
-	if (differentialInts_.find(key) != differentialInts_.end()) {
-		return differentialInts_[key]
-				- differentialInts_[key + LAST_VALUE_SUFFIX];
+	for (const EventTracer::LatencySummary& latency :
+			EventTracer::takeIntervalSummaries()) {
+		setLatencyData(latency.name, latency.events, latency.p50Nanos,
+				latency.p90Nanos, latency.p99Nanos, latency.p999Nanos);
 	}
-	return 0;
-}
 
-void MonitorConnector::setDetectorDifferentialData(std::string key,
-		uint64_t value, uint8_t detectorID) {
-	uint64_t lastValue;
-	if (detectorDifferentialInts_.find(detectorID)
-			== detectorDifferentialInts_.end()) {
-		detectorDifferentialInts_[detectorID] =
-				std::map<std::string, uint64_t>();
-		detectorDifferentialInts_[detectorID][key + LAST_VALUE_SUFFIX] = 0;
-		detectorDifferentialInts_[detectorID][key] = 0;
-	}
-	lastValue = detectorDifferentialInts_[detectorID][key];
+	MetricRegistry::publish();
 
-	LOG_INFO<<key << std::to_string((int) detectorID) << ":\t" << std::to_string(value - lastValue) << "( " <<std::to_string(value)<<")";
+	if (logInterval_ != 0 && ++updatesSinceLog_ >= logInterval_) {
+		updatesSinceLog_ = 0;
+		MetricRegistry::logValues();
+		if (!PcapReplayer::IsActive() && !ThroughputBenchmark::IsEnabled()) {
+			NetworkHandler::PrintStats();
+		}
+	}
 
-	detectorDifferentialInts_[detectorID][key + LAST_VALUE_SUFFIX] =
-			detectorDifferentialInts_[detectorID][key];
-	detectorDifferentialInts_[detectorID][key] = value;
+	IPCHandler::sendStatistics("UnfinishedEventsData",
+			UnfinishedEventsCollector::toJson());
 }
 
-void MonitorConnector::setContinuousData(std::string key, uint64_t value) {
-	LOG_INFO<<key << ":\t" << std::to_string(value);
+void MonitorConnector::setLatencyData(const std::string& name,
+		const uint64_t events, const uint64_t p50Nanos, const uint64_t p90Nanos,
+		const uint64_t p99Nanos, const uint64_t p999Nanos) {
+	auto metric = latencyMetrics_.find(name);
+	if (metric == latencyMetrics_.end()) {
+		/*
+		 * The five metrics of one summary have consecutive handles
+		 */
+		const uint first = MetricRegistry::registerMetric(name + "Events",
+				MetricRegistry::GAUGE);
+		MetricRegistry::registerMetric(name + "P50Nanos", MetricRegistry::GAUGE);
+		MetricRegistry::registerMetric(name + "P90Nanos", MetricRegistry::GAUGE);
+		MetricRegistry::registerMetric(name + "P99Nanos", MetricRegistry::GAUGE);
+		MetricRegistry::registerMetric(name + "P999Nanos",
+				MetricRegistry::GAUGE);
+		metric = latencyMetrics_.insert(std::make_pair(name, first)).first;
+	}
+	MetricRegistry::set(metric->second, events);
+	MetricRegistry::set(metric->second + 1, p50Nanos);
+	MetricRegistry::set(metric->second + 2, p90Nanos);
+	MetricRegistry::set(metric->second + 3, p99Nanos);
+	MetricRegistry::set(metric->second + 4, p999Nanos);
 }
 
 }
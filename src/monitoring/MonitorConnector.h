@@ -15,14 +15,13 @@
 #include <cstdbool>
 #include <map>
 #include <string>
+#include <vector>
 #include <monitoring/IPCHandler.h>
 
 
 #include <utils/Stopwatch.h>
 #include <utils/AExecutable.h>
 
-#define LAST_VALUE_SUFFIX "_lastValue"
-
 namespace na62 {
 
 class EventBuilder;
@@ -45,16 +44,26 @@ public:
 		currentState_ = state;
 	}
 
+	static STATE getState() {
+		return currentState_;
+	}
+
 private:
 	virtual void thread();
 	void onInterruption();
 	void handleUpdate();
-	uint64_t setDifferentialData(std::string key, uint64_t value);
-	uint64_t getDifferentialValue(std::string key);
 
-	void setDetectorDifferentialData(std::string key, uint64_t value,
-			uint8_t detectorID);
-	void setContinuousData(std::string key, uint64_t value);
+	/**
+	 * Registers all metrics known at startup in the MetricRegistry
+	 */
+	void registerMetrics();
+
+	/**
+	 * Sets the five metrics of the latency summary, registering them on first use
+	 */
+	void setLatencyData(const std::string& name, const uint64_t events,
+			const uint64_t p50Nanos, const uint64_t p90Nanos,
+			const uint64_t p99Nanos, const uint64_t p999Nanos);
 
 	boost::asio::io_service monitoringService;
 
@@ -62,8 +71,21 @@ private:
 
 	Stopwatch updateWatch_;
 
-	std::map<std::string, uint64_t> differentialInts_;
-	std::map<uint8_t, std::map<std::string, uint64_t> > detectorDifferentialInts_;
+	/*
+	 * Handles of the metrics in the MetricRegistry
+	 */
+	std::vector<uint> metrics_;
+	uint l1TriggerMetrics_[0x100];
+	uint l2TriggerMetrics_[0x100];
+	std::vector<uint> detectorMetrics_;
+	std::vector<uint> pipelineMetrics_;
+	std::map<std::string, uint> latencyMetrics_;
+
+	/*
+	 * The metrics are written to the log every logInterval_ updates
+	 */
+	uint logInterval_;
+	uint updatesSinceLog_;
 
 	static STATE currentState_;
 };
@@ -0,0 +1,126 @@
+/*
+ * StatisticsPage.h
+ *
+ *  Created on: Oct 16, 2026
+ *      Author: Jonas Kunze (kunze.jonas@gmail.com)
+ *
+ * Layout of the shared memory segment the farm publishes its statistics to. This header
+ * has no dependencies on the rest of the farm so that external readers can include it.
+ *
+ * A reader maps the segment (shm_open(name, O_RDONLY) + mmap) and takes consistent copies
+ * with ReadStatisticsPage. Readers never block the farm.
+ */
+
+#pragma once
+#ifndef STATISTICSPAGE_H_
+#define STATISTICSPAGE_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+namespace na62 {
+
+#define STATISTICS_PAGE_MAGIC 0x4E413632 /* "NA62" */
+#define STATISTICS_PAGE_VERSION 1
+
+/*
+ * Source number of the LKr within sources. All lower indices are L0 data sources
+ */
+#define STATISTICS_PAGE_MAX_SOURCES 0x101
+
+struct StatisticsPageSource {
+	uint32_t sourceID;
+	uint32_t reserved;
+	uint64_t mepsReceived;
+	uint64_t bytesReceived;
+	uint64_t eventsReceived;
+};
+
+struct StatisticsPage {
+	/*
+	 * Written once before the first update. A reader must check all three
+	 */
+	uint32_t magic;
+	uint32_t version;
+	uint32_t size; // sizeof(StatisticsPage)
+	uint32_t reserved;
+
+	/*
+	 * Seqlock: odd while the farm is writing
+	 */
+	std::atomic<uint64_t> sequence;
+
+	uint64_t updateTimeNanos; // CLOCK_REALTIME of the last update
+	uint64_t numberOfUpdates;
+
+	uint32_t burstID;
+	uint32_t nextBurstID;
+	uint32_t state;
+	uint32_t numberOfSources; // L0 sources + LKr actually used in sources
+
+	uint64_t queuedTasks;
+	uint64_t queuedTriggerTasks;
+	uint64_t mergerQueuedEvents;
+
+	uint64_t framesReceived;
+	uint64_t bytesReceived;
+	uint64_t framesDropped;
+	uint64_t framesSent;
+
+	uint64_t ipFragmentsReceived;
+	uint64_t ipDatagramsReassembled;
+	uint64_t ipDatagramsUnfinished;
+	uint64_t ipFragmentsDropped;
+	uint64_t ipDatagramsEvicted;
+	uint64_t ipFragmentBytesHeld;
+
+	uint64_t l1MRPsSent;
+	uint64_t l1TriggersSent;
+	uint64_t eventsToMerger;
+	uint64_t bytesToMerger;
+
+	uint64_t l1Triggers[0x100];
+	uint64_t l2Triggers[0x100];
+
+	StatisticsPageSource sources[STATISTICS_PAGE_MAX_SOURCES];
+};
+
+/**
+ * Copies the page into copy as soon as the farm is not writing it
+ *
+ * @return false if the segment is not a page of this version
+ */
+inline bool ReadStatisticsPage(const StatisticsPage* page,
+		StatisticsPage* copy) {
+	if (page->magic != STATISTICS_PAGE_MAGIC
+			|| page->version != STATISTICS_PAGE_VERSION
+			|| page->size != sizeof(StatisticsPage)) {
+		return false;
+	}
+
+	uint64_t sequence;
+	do {
+		sequence = page->sequence.load(std::memory_order_acquire);
+		if (sequence & 1) {
+			continue;
+		}
+		memcpy((char*) copy + offsetof(StatisticsPage, updateTimeNanos),
+				(const char*) page + offsetof(StatisticsPage, updateTimeNanos),
+				sizeof(StatisticsPage)
+						- offsetof(StatisticsPage, updateTimeNanos));
+		std::atomic_thread_fence(std::memory_order_acquire);
+	} while ((sequence & 1)
+			|| page->sequence.load(std::memory_order_relaxed) != sequence);
+
+	copy->magic = page->magic;
+	copy->version = page->version;
+	copy->size = page->size;
+	copy->sequence.store(sequence, std::memory_order_relaxed);
+	return true;
+}
+
+} /* namespace na62 */
+
+#endif /* STATISTICSPAGE_H_ */
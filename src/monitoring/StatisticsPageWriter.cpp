@@ -0,0 +1,175 @@
+/*
+ * StatisticsPageWriter.cpp
+ *
+ *  Created on: Oct 16, 2026
+ *      Author: Jonas Kunze (kunze.jonas@gmail.com)
+ */
+
+#include "StatisticsPageWriter.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+
+#include <eventBuilding/Event.h>
+#include <eventBuilding/SourceIDManager.h>
+#include <LKr/L1DistributionHandler.h>
+#include <options/Logging.h>
+#include <socket/NetworkHandler.h>
+
+#include "../eventBuilding/L1Builder.h"
+#include "../eventBuilding/L2Builder.h"
+#include "../eventBuilding/MergerSender.h"
+#include "../eventBuilding/TriggerTask.h"
+#include "../socket/FragmentStore.h"
+#include "../socket/HandleFrameTask.h"
+#include "../socket/PacketHandler.h"
+#include "MonitorConnector.h"
+
+namespace na62 {
+namespace monitoring {
+
+std::string StatisticsPageWriter::openedSegment_;
+
+StatisticsPageWriter::StatisticsPageWriter(const std::string& name,
+		const uint intervalMillis) :
+		name_(name), intervalMillis_(intervalMillis), running_(true), page_(
+				nullptr) {
+	memset((void*) &values_, 0, sizeof(values_));
+}
+
+StatisticsPageWriter::~StatisticsPageWriter() {
+	if (page_ != nullptr) {
+		munmap(page_, sizeof(StatisticsPage));
+	}
+	onShutDown();
+}
+
+void StatisticsPageWriter::onShutDown() {
+	if (!openedSegment_.empty()) {
+		shm_unlink(openedSegment_.c_str());
+		openedSegment_.clear();
+	}
+}
+
+bool StatisticsPageWriter::open() {
+	const int fd = shm_open(name_.c_str(), O_CREAT | O_RDWR, 0644);
+	if (fd < 0 || ftruncate(fd, sizeof(StatisticsPage)) != 0) {
+		LOG_ERROR<< "Unable to create the statistics page " << name_ << ": "
+		<< strerror(errno) << ENDL;
+		if (fd >= 0) {
+			close(fd);
+		}
+		return false;
+	}
+
+	void* memory = mmap(nullptr, sizeof(StatisticsPage),
+			PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	if (memory == MAP_FAILED) {
+		LOG_ERROR<< "Unable to map the statistics page " << name_ << ": "
+		<< strerror(errno) << ENDL;
+		return false;
+	}
+	page_ = (StatisticsPage*) memory;
+	openedSegment_ = name_;
+
+	/*
+	 * Readers check the header before anything else, so it is written last
+	 */
+	memset(memory, 0, sizeof(StatisticsPage));
+	page_->size = sizeof(StatisticsPage);
+	page_->version = STATISTICS_PAGE_VERSION;
+	std::atomic_thread_fence(std::memory_order_release);
+	page_->magic = STATISTICS_PAGE_MAGIC;
+
+	LOG_INFO<< "Publishing statistics to the shared memory segment " << name_
+	<< ENDL;
+	return true;
+}
+
+void StatisticsPageWriter::onInterruption() {
+	running_ = false;
+}
+
+void StatisticsPageWriter::thread() {
+	while (running_) {
+		collect();
+		publish();
+		usleep(intervalMillis_ * 1000);
+	}
+}
+
+void StatisticsPageWriter::collect() {
+	StatisticsPage& v = values_;
+
+	v.updateTimeNanos = std::chrono::duration_cast<std::chrono::nanoseconds>(
+			std::chrono::system_clock::now().time_since_epoch()).count();
+	v.numberOfUpdates++;
+
+	v.burstID = PacketHandler::getCurrentBurstId();
+	v.nextBurstID = PacketHandler::getNextBurstId();
+	v.state = MonitorConnector::getState();
+
+	v.queuedTasks = HandleFrameTask::getNumberOfQeuedTasks();
+	v.queuedTriggerTasks = TriggerTask::getNumberOfQueuedTasks();
+	v.mergerQueuedEvents = MergerSender::GetNumberOfQueuedEvents();
+
+	v.framesReceived = NetworkHandler::GetFramesReceived();
+	v.bytesReceived = NetworkHandler::GetBytesReceived();
+	v.framesDropped = NetworkHandler::GetFramesDropped();
+	v.framesSent = NetworkHandler::GetFramesSent();
+
+	v.ipFragmentsReceived = FragmentStore::getNumberOfReceivedFragments();
+	v.ipDatagramsReassembled = FragmentStore::getNumberOfReassembledFrames();
+	v.ipDatagramsUnfinished = FragmentStore::getNumberOfUnfinishedFrames();
+	v.ipFragmentsDropped = FragmentStore::getNumberOfDroppedFragments();
+	v.ipDatagramsEvicted = FragmentStore::getNumberOfEvictedDatagrams();
+	v.ipFragmentBytesHeld = FragmentStore::getNumberOfBytesHeld();
+
+	v.l1MRPsSent = cream::L1DistributionHandler::GetL1MRPsSent();
+	v.l1TriggersSent = cream::L1DistributionHandler::GetL1TriggersSent();
+	v.eventsToMerger = L2Builder::GetEventsSentToStorage();
+	v.bytesToMerger = L2Builder::GetBytesSentToStorage();
+
+	for (uint word = 0; word != 0x100; word++) {
+		v.l1Triggers[word] = L1Builder::GetL1TriggerStats(word);
+		v.l2Triggers[word] = L2Builder::GetL2TriggerStats(word);
+	}
+
+	/*
+	 * The LKr statistics are stored at SourceIDManager::NUMBER_OF_L0_DATA_SOURCES
+	 */
+	const uint lkrSourceNum = SourceIDManager::NUMBER_OF_L0_DATA_SOURCES;
+	v.numberOfSources = lkrSourceNum + 1;
+	for (uint sourceNum = 0; sourceNum <= lkrSourceNum; sourceNum++) {
+		StatisticsPageSource& source = v.sources[sourceNum];
+		source.sourceID =
+				sourceNum == lkrSourceNum ?
+						SOURCE_ID_LKr : SourceIDManager::SourceNumToID(sourceNum);
+		source.mepsReceived = HandleFrameTask::GetMEPsReceivedBySourceNum(
+				sourceNum);
+		source.bytesReceived = HandleFrameTask::GetBytesReceivedBySourceNum(
+				sourceNum);
+		source.eventsReceived = Event::getMissingEventsBySourceNum(sourceNum);
+	}
+}
+
+void StatisticsPageWriter::publish() {
+	const uint64_t sequence = page_->sequence.load(std::memory_order_relaxed);
+	page_->sequence.store(sequence + 1, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+
+	memcpy((char*) page_ + offsetof(StatisticsPage, updateTimeNanos),
+			(const char*) &values_ + offsetof(StatisticsPage, updateTimeNanos),
+			sizeof(StatisticsPage) - offsetof(StatisticsPage, updateTimeNanos));
+
+	page_->sequence.store(sequence + 2, std::memory_order_release);
+}
+
+} /* namespace monitoring */
+} /* namespace na62 */
@@ -0,0 +1,66 @@
+/*
+ * StatisticsPageWriter.h
+ *
+ *  Created on: Oct 16, 2026
+ *      Author: Jonas Kunze (kunze.jonas@gmail.com)
+ */
+
+#pragma once
+#ifndef STATISTICSPAGEWRITER_H_
+#define STATISTICSPAGEWRITER_H_
+
+#include <sys/types.h>
+#include <utils/AExecutable.h>
+#include <string>
+
+#include "StatisticsPage.h"
+
+namespace na62 {
+namespace monitoring {
+
+/*
+ * Periodically copies all farm counters to the shared memory StatisticsPage.
+ *
+ * The values are collected into a private copy first so that the page is only held in the
+ * odd (writing) state for a single memcpy.
+ */
+class StatisticsPageWriter: public AExecutable {
+public:
+	/**
+	 * @param name Name of the shared memory segment (e.g. /na62-farm-stats)
+	 */
+	StatisticsPageWriter(const std::string& name, const uint intervalMillis);
+	virtual ~StatisticsPageWriter();
+
+	/**
+	 * @return false if the segment could not be created
+	 */
+	bool open();
+
+	/**
+	 * Removes the shared memory segment. Has to be called explicitly at shutdown as the
+	 * writer lives on main's stack and exit() does not run its destructor
+	 */
+	static void onShutDown();
+
+private:
+	static std::string openedSegment_;
+
+	const std::string name_;
+	const uint intervalMillis_;
+	bool running_;
+
+	StatisticsPage* page_;
+	StatisticsPage values_;
+
+	void thread();
+	void onInterruption();
+
+	void collect();
+	void publish();
+};
+
+} /* namespace monitoring */
+} /* namespace na62 */
+
+#endif /* STATISTICSPAGEWRITER_H_ */
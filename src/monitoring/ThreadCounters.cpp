@@ -0,0 +1,47 @@
+/*
+ * ThreadCounters.cpp
+ *
+ *  Created on: Oct 16, 2026
+ *      Author: Jonas Kunze (kunze.jonas@gmail.com)
+ */
+
+#include "ThreadCounters.h"
+
+#include <cstdlib>
+#include <new>
+
+namespace na62 {
+
+thread_local ThreadCounters::Block* ThreadCounters::threadBlock_ = nullptr;
+
+tbb::spin_mutex ThreadCounters::blocksMutex_;
+std::vector<ThreadCounters::Block*> ThreadCounters::blocks_;
+
+ThreadCounters::Block* ThreadCounters::createThreadBlock() {
+	/*
+	 * new does not respect the cache line alignment before C++17
+	 */
+	void* memory;
+	if (posix_memalign(&memory, alignof(Block), sizeof(Block)) != 0) {
+		throw std::bad_alloc();
+	}
+	Block* block = new (memory) Block();
+	for (uint i = 0; i != NUMBER_OF_COUNTERS; i++) {
+		block->counters[i] = 0;
+	}
+
+	tbb::spin_mutex::scoped_lock my_lock(blocksMutex_);
+	blocks_.push_back(block);
+	return block;
+}
+
+uint64_t ThreadCounters::sum(const uint counter) {
+	uint64_t sum = 0;
+	tbb::spin_mutex::scoped_lock my_lock(blocksMutex_);
+	for (Block* block : blocks_) {
+		sum += block->counters[counter].load(std::memory_order_relaxed);
+	}
+	return sum;
+}
+
+} /* namespace na62 */
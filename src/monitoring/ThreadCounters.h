@@ -0,0 +1,86 @@
+/*
+ * ThreadCounters.h
+ *
+ *  Created on: Oct 16, 2026
+ *      Author: Jonas Kunze (kunze.jonas@gmail.com)
+ */
+
+#pragma once
+#ifndef THREADCOUNTERS_H_
+#define THREADCOUNTERS_H_
+
+#include <sys/types.h>
+#include <tbb/spin_mutex.h>
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+namespace na62 {
+
+/*
+ * Statistics counters updated for every frame or event. Every thread increments its own
+ * copy of the counters so that the worker threads never write to the same cache lines.
+ */
+class ThreadCounters {
+public:
+	/*
+	 * Index of every counter within a block. Arrays start at the given index
+	 */
+	enum Counter {
+		MEPS_RECEIVED_BY_SOURCE_NUM = 0,
+		BYTES_RECEIVED_BY_SOURCE_NUM = MEPS_RECEIVED_BY_SOURCE_NUM + 0x100,
+		L1_TRIGGERS = BYTES_RECEIVED_BY_SOURCE_NUM + 0x100,
+		L2_TRIGGERS = L1_TRIGGERS + 0x100,
+		BYTES_SENT_TO_STORAGE = L2_TRIGGERS + 0x100,
+		EVENTS_SENT_TO_STORAGE,
+		STORAGE_BYTES_COPIED,
+		STORAGE_BYTES_ZERO_COPY,
+		NUMBER_OF_COUNTERS
+	};
+
+	/**
+	 * Adds value to the counter of the calling thread. Only the owning thread writes to its
+	 * counters so a relaxed load and store is enough
+	 */
+	static inline void add(const uint counter, const uint64_t value) {
+		std::atomic<uint64_t>& c = getThreadBlock()->counters[counter];
+		c.store(c.load(std::memory_order_relaxed) + value,
+				std::memory_order_relaxed);
+	}
+
+	static inline void increment(const uint counter) {
+		add(counter, 1);
+	}
+
+	/**
+	 * @return The sum of the counter over all threads
+	 */
+	static uint64_t sum(const uint counter);
+
+private:
+	struct alignas(64) Block {
+		std::atomic<uint64_t> counters[NUMBER_OF_COUNTERS];
+	};
+
+	static thread_local Block* threadBlock_;
+
+	/*
+	 * Blocks of all threads that have ever counted something. Blocks are never freed so that
+	 * the counts of finished threads are kept
+	 */
+	static tbb::spin_mutex blocksMutex_;
+	static std::vector<Block*> blocks_;
+
+	static inline Block* getThreadBlock() {
+		if (threadBlock_ == nullptr) {
+			threadBlock_ = createThreadBlock();
+		}
+		return threadBlock_;
+	}
+
+	static Block* createThreadBlock();
+};
+
+} /* namespace na62 */
+
+#endif /* THREADCOUNTERS_H_ */
@@ -14,6 +14,7 @@
 #include <options/Options.h>
 #include <socket/NetworkHandler.h>
 #include <unistd.h>
+#include <algorithm>
 #include <csignal>
 #include <iostream>
 #include <vector>
@@ -23,22 +24,64 @@
 #include <eventBuilding/Event.h>
 #include <options/TriggerOptions.h>
 
+#include "eventBuilding/EventAgingService.h"
 #include "eventBuilding/L1Builder.h"
+#include "eventBuilding/EventPipeline.h"
+#include "eventBuilding/EventTracer.h"
 #include "eventBuilding/L2Builder.h"
 #include "eventBuilding/StorageHandler.h"
+#include "monitoring/HighResolutionSampler.h"
+#include "monitoring/MetricsEndpoint.h"
 #include "monitoring/MonitorConnector.h"
+#include "monitoring/StatisticsPageWriter.h"
 #include "options/MyOptions.h"
 #include "socket/PacketHandler.h"
 #include "socket/ZMQHandler.h"
 #include "socket/HandleFrameTask.h"
+#include "socket/PcapReplayer.h"
+#include "socket/SlowPathHandler.h"
 #include "monitoring/CommandConnector.h"
 #include "straws/StrawReceiver.h"
+#include "benchmark/ThroughputBenchmark.h"
+#include "topology/NodeArena.h"
+#include "topology/SystemTopology.h"
 
 using namespace std;
 using namespace na62;
 
 std::vector<PacketHandler*> packetHandlers;
 
+void shutDown() {
+	IPCHandler::updateState(INITIALIZING);
+	usleep(100);
+
+	ZMQHandler::Stop();
+	AExecutable::InterruptAll();
+
+	LOG_INFO<< "Stopping packet handlers";
+	for (auto& handler : packetHandlers) {
+		handler->stopRunning();
+	}
+
+	LOG_INFO<< "Stopping storage handler";
+	StorageHandler::onShutDown();
+
+	LOG_INFO<< "Stopping STRAW receiver";
+	StrawReceiver::onShutDown();
+
+	usleep(1000);
+	LOG_INFO<< "Stopping IPC handler";
+	IPCHandler::shutDown();
+
+	LOG_INFO<< "Stopping ZMQ handler";
+	ZMQHandler::shutdown();
+
+	monitoring::StatisticsPageWriter::onShutDown();
+
+	LOG_INFO<< "Cleanly shut down na62-farm";
+	exit(0);
+}
+
 void handle_stop(const boost::system::error_code& error, int signal_number) {
 	google::ShutdownGoogleLogging();
 	LOG_INFO << "#############################################" << ENDL;
@@ -49,32 +92,8 @@ void handle_stop(const boost::system::error_code& error, int signal_number) {
 	LOG_INFO << "Received signal " << signal_number << " - Shutting down"
 			<< ENDL;
 
-	IPCHandler::updateState(INITIALIZING);
-	usleep(100);
 	if (!error) {
-		ZMQHandler::Stop();
-		AExecutable::InterruptAll();
-
-		LOG_INFO<< "Stopping packet handlers";
-		for (auto& handler : packetHandlers) {
-			handler->stopRunning();
-		}
-
-		LOG_INFO<< "Stopping storage handler";
-		StorageHandler::onShutDown();
-
-		LOG_INFO<< "Stopping STRAW receiver";
-		StrawReceiver::onShutDown();
-
-		usleep(1000);
-		LOG_INFO<< "Stopping IPC handler";
-		IPCHandler::shutDown();
-
-		LOG_INFO<< "Stopping ZMQ handler";
-		ZMQHandler::shutdown();
-
-		LOG_INFO<< "Cleanly shut down na62-farm";
-		exit(0);
+		shutDown();
 	}
 }
 
@@ -97,10 +116,16 @@ int main(int argc, char* argv[]) {
 	ZMQHandler::Initialize(Options::GetInt(OPTION_ZMQ_IO_THREADS));
 
 	/*
-	 * initialize NIC handler and start gratuitous ARP request sending thread
+	 * initialize NIC handler and start gratuitous ARP request sending thread or replay
+	 * pcap files instead
 	 */
-	NetworkHandler NetworkHandler(Options::GetString(OPTION_ETH_DEVICE_NAME));
-	NetworkHandler.startThread("ArpSender");
+	if (PcapReplayer::IsEnabled()) {
+		PcapReplayer::initialize();
+	} else if (!ThroughputBenchmark::IsEnabled()) {
+		NetworkHandler* networkHandler = new NetworkHandler(
+				Options::GetString(OPTION_ETH_DEVICE_NAME));
+		networkHandler->startThread("ArpSender");
+	}
 
 	SourceIDManager::Initialize(Options::GetInt(OPTION_TS_SOURCEID),
 			Options::GetIntPairList(OPTION_DATA_SOURCE_IDS),
@@ -108,6 +133,15 @@ int main(int argc, char* argv[]) {
 			Options::GetIntPairList(OPTION_INACTIVE_CREAM_CRATES),
 			Options::GetInt(OPTION_MUV_CREAM_CRATE_ID));
 
+	const bool numaAware = Options::GetBool(OPTION_NUMA_AWARE);
+	SystemTopology::initialize(
+			PcapReplayer::IsActive() || ThroughputBenchmark::IsEnabled() ?
+					"" : Options::GetString(OPTION_ETH_DEVICE_NAME),
+			PacketHandler::GetNumberOfQueues());
+	if (numaAware) {
+		NodeArena::initialize();
+	}
+
 	PacketHandler::initialize();
 
 	HandleFrameTask::initialize();
@@ -117,14 +151,23 @@ int main(int argc, char* argv[]) {
 
 	L1Builder::initialize();
 	L2Builder::initialize();
+	EventPipeline::initialize();
+	EventTracer::initialize();
 
 	Event::initialize(Options::GetBool(OPTION_WRITE_BROKEN_CREAM_INFO));
 
 	Event::setPrintMissingSourceIds(
 			MyOptions::GetBool(OPTION_PRINT_MISSING_SOURCES));
 
+	/*
+	 * Events are built on all nodes -> spread them evenly instead of putting all on this node
+	 */
+	SystemTopology::setInterleavedAllocation(numaAware);
 	EventPool::Initialize(Options::GetInt(
 	OPTION_MAX_NUMBER_OF_EVENTS_PER_BURST));
+	SystemTopology::setInterleavedAllocation(false);
+
+	EventAgingService::initialize();
 
 	cream::L1DistributionHandler::Initialize(
 			Options::GetInt(OPTION_MAX_TRIGGERS_PER_L1MRP),
@@ -142,16 +185,51 @@ int main(int argc, char* argv[]) {
 	monitoring::MonitorConnector::setState(INITIALIZING);
 	monitor.startThread("MonitorConnector");
 
+	monitoring::MetricsEndpoint metricsEndpoint(
+			Options::GetString(OPTION_METRICS_SOCKET));
+	if (!Options::GetString(OPTION_METRICS_SOCKET).empty()) {
+		metricsEndpoint.startThread("MetricsEndpoint");
+	}
+
+	monitoring::StatisticsPageWriter statisticsPage(
+			Options::GetString(OPTION_STATISTICS_PAGE),
+			std::max(1, Options::GetInt(OPTION_STATISTICS_PAGE_INTERVAL)));
+	if (!Options::GetString(OPTION_STATISTICS_PAGE).empty()
+			&& statisticsPage.open()) {
+		statisticsPage.startThread("StatisticsPage");
+	}
+
+	if (monitoring::HighResolutionSampler::IsEnabled()) {
+		monitoring::HighResolutionSampler* sampler =
+				new monitoring::HighResolutionSampler();
+		sampler->startThread("HighResolutionSampler");
+	}
+
 	/*
 	 * L1 Distribution handler
 	 */
 	cream::L1DistributionHandler l1Handler;
 	l1Handler.startThread("L1DistributionHandler");
 
+	/*
+	 * The benchmark generates the data itself
+	 */
+	if (ThroughputBenchmark::IsEnabled()) {
+		monitoring::MonitorConnector::setState(RUNNING);
+		ThroughputBenchmark::run();
+		shutDown();
+	}
+
+	/*
+	 * ARP and other control frames
+	 */
+	SlowPathHandler slowPathHandler;
+	slowPathHandler.startThread("SlowPathHandler");
+
 	/*
 	 * Packet Handler
 	 */
-	unsigned int numberOfPacketHandler = NetworkHandler::GetNumberOfQueues();
+	unsigned int numberOfPacketHandler = PacketHandler::GetNumberOfQueues();
 	LOG_INFO << "Starting " << numberOfPacketHandler
 			<< " PacketHandler threads" << ENDL;
 
@@ -160,9 +238,14 @@ int main(int argc, char* argv[]) {
 				i);
 		packetHandlers.push_back(handler);
 
-		uint coresPerSocket = std::thread::hardware_concurrency()
-				/ 2/*hyperthreading*/;
-		uint cpuMask = i % 2 == 0 ? i / 2 : coresPerSocket + i / 2;
+		uint cpuMask;
+		if (numaAware) {
+			cpuMask = SystemTopology::GetCPUOfQueue(i);
+		} else {
+			uint coresPerSocket = std::thread::hardware_concurrency()
+					/ 2/*hyperthreading*/;
+			cpuMask = i % 2 == 0 ? i / 2 : coresPerSocket + i / 2;
+		}
 		handler->startThread(i, "PacketHandler", cpuMask, 15,
 				MyOptions::GetInt(OPTION_PH_SCHEDULER));
 	}
@@ -18,6 +18,16 @@
  */
 #define OPTION_ETH_DEVICE_NAME (char*)"ethDeviceName"
 
+/*
+ * Replay of pcap files instead of using pf_ring
+ */
+#define OPTION_PCAP_REPLAY_FILES (char*)"pcapReplayFiles"
+#define OPTION_PCAP_REPLAY_MODE (char*)"pcapReplayMode"
+#define OPTION_PCAP_REPLAY_RATE (char*)"pcapReplayRate"
+#define OPTION_PCAP_REPLAY_LOOPS (char*)"pcapReplayLoops"
+#define OPTION_PCAP_REPLAY_QUEUES (char*)"pcapReplayQueues"
+#define OPTION_PCAP_REPLAY_IP (char*)"pcapReplayIP"
+
 #define OPTION_L0_RECEIVER_PORT (char*)"L0Port"
 #define OPTION_CREAM_RECEIVER_PORT (char*)"CREAMPort"
 
@@ -45,10 +55,23 @@
 #define OPTION_PRINT_MISSING_SOURCES (char*)"printMissingSources"
 
 #define OPTION_INCREMENT_BURST_AT_EOB (char*)"incrementBurstAtEOB"
+
+#define OPTION_EVENT_AGING_TIMEOUT (char*)"eventAgingTimeout"
+#define OPTION_EVENT_AGING_TABLE_SIZE (char*)"eventAgingTableSize"
+
 /*
  * Triggering
  */
 #define OPTION_L1_DOWNSCALE_FACTOR  (char*)"L1DownscaleFactor"
+#define OPTION_L1_BATCH_SIZE (char*)"L1BatchSize"
+#define OPTION_L1_BATCH_MAX_DELAY (char*)"L1BatchMaxDelay"
+
+#define OPTION_PIPELINE_L1_CONCURRENCY (char*)"pipelineL1Concurrency"
+#define OPTION_PIPELINE_LKR_REQUEST_CONCURRENCY (char*)"pipelineLKrRequestConcurrency"
+#define OPTION_PIPELINE_L2_CONCURRENCY (char*)"pipelineL2Concurrency"
+#define OPTION_PIPELINE_STORAGE_CONCURRENCY (char*)"pipelineStorageConcurrency"
+#define OPTION_PIPELINE_QUEUE_CAPACITY (char*)"pipelineQueueCapacity"
+
 #define OPTION_L2_DOWNSCALE_FACTOR  (char*)"L2DownscaleFactor"
 
 #define OPTION_MIN_USEC_BETWEEN_L1_REQUESTS (char*)"minUsecsBetweenL1Requests"
@@ -58,17 +81,39 @@
  */
 #define OPTION_MERGER_HOST_NAMES (char*)"mergerHostNames"
 #define OPTION_MERGER_PORT (char*)"mergerPort"
+#define OPTION_ZERO_COPY_OUTPUT (char*)"zeroCopyOutput"
+#define OPTION_NUMBER_OF_MERGER_SENDERS (char*)"mergerSenderThreads"
+#define OPTION_OUTPUT_BATCH_SIZE (char*)"outputBatchSize"
+#define OPTION_OUTPUT_BATCH_MAX_AGE (char*)"outputBatchMaxAge"
+#define OPTION_OUTPUT_COMPRESSION_LEVEL (char*)"outputCompressionLevel"
+#define OPTION_OUTPUT_COMPRESSION_ACCELERATION (char*)"outputCompressionAcceleration"
+#define OPTION_OUTPUT_QUEUE_HIGH_WATERMARK (char*)"outputQueueHighWatermark"
+#define OPTION_OUTPUT_QUEUE_LOW_WATERMARK (char*)"outputQueueLowWatermark"
+#define OPTION_SPOOL_FILE (char*)"spoolFile"
+#define OPTION_MAX_SPOOL_SIZE (char*)"maxSpoolSize"
+#define OPTION_OUTPUT_BUFFER_CACHE_SIZE (char*)"outputBufferCacheSize"
 
 /*
  * Performance
  */
 #define OPTION_PH_SCHEDULER (char*) "packetHandlerScheduler"
+#define OPTION_NUMA_AWARE (char*)"numaAware"
+#define OPTION_RUN_TO_COMPLETION (char*)"runToCompletion"
+#define OPTION_CHECK_CHECKSUMS (char*)"checkChecksums"
 #define OPTION_ZMQ_IO_THREADS (char*)"zmqIoThreads"
 #define OPTION_ACTIVE_POLLING (char*)"activePolling"
 #define OPTION_POLLING_DELAY (char*)"pollingDelay"
 #define OPTION_POLLING_SLEEP_MICROS (char*)"pollingSleepMicros"
+#define OPTION_IDLE_MAX_SPIN_MICROS (char*)"idleMaxSpinMicros"
+#define OPTION_IDLE_MAX_WAIT_MICROS (char*)"idleMaxWaitMicros"
 #define OPTION_MAX_FRAME_AGGREGATION (char*)"maxFramesAggregation"
 #define OPTION_MAX_AGGREGATION_TIME (char*)"maxAggregationTime"
+#define OPTION_FRAME_BUFFER_SIZE (char*)"frameBufferSize"
+#define OPTION_FRAME_BUFFERS_PER_QUEUE (char*)"frameBuffersPerQueue"
+#define OPTION_FRAGMENT_SLOTS (char*)"fragmentSlots"
+#define OPTION_MAX_DATAGRAM_SIZE (char*)"maxDatagramSize"
+#define OPTION_MAX_FRAGMENT_AGE (char*)"maxFragmentAge"
+#define OPTION_MAX_FRAGMENT_BYTES (char*)"maxFragmentBytes"
 
 /*
  * MUVs
@@ -82,9 +127,34 @@
 #define OPTION_STRAW_ZMQ_PORT (char*)"strawZmqPort"
 #define OPTION_STRAW_ZMQ_DST_HOSTS (char*)"strawZmqDstHosts"
 
+/*
+ * Monitoring
+ */
+#define OPTION_EVENT_TRACING (char*)"eventTracing"
+#define OPTION_EVENT_TRACE_TABLE_SIZE (char*)"eventTraceTableSize"
+#define OPTION_EVENT_TRACE_SAMPLING (char*)"eventTraceSampling"
+#define OPTION_EVENT_TRACE_FILE (char*)"eventTraceFile"
+
+#define OPTION_MONITOR_LOG_INTERVAL (char*)"monitorLogInterval"
+#define OPTION_METRICS_SOCKET (char*)"metricsSocket"
+#define OPTION_STATISTICS_PAGE (char*)"statisticsPage"
+#define OPTION_STATISTICS_PAGE_INTERVAL (char*)"statisticsPageInterval"
+
+#define OPTION_SAMPLER_INTERVAL (char*)"samplerInterval"
+#define OPTION_SAMPLER_HISTORY (char*)"samplerHistory"
+#define OPTION_SAMPLER_AUTO_DUMP (char*)"samplerAutoDump"
+#define OPTION_SAMPLER_MIN_DUMP_INTERVAL (char*)"samplerMinDumpInterval"
+#define OPTION_SAMPLER_DUMP_DIRECTORY (char*)"samplerDumpDirectory"
+
 /*
  * Debugging
  */
+#define OPTION_BENCHMARK (char*)"benchmark"
+#define OPTION_BENCHMARK_EVENTS (char*)"benchmarkEvents"
+#define OPTION_BENCHMARK_MAX_THREADS (char*)"benchmarkMaxThreads"
+#define OPTION_BENCHMARK_EVENTS_PER_MEP (char*)"benchmarkEventsPerMEP"
+#define OPTION_BENCHMARK_L0_FRAGMENT_SIZE (char*)"benchmarkL0FragmentSize"
+#define OPTION_BENCHMARK_LKR_FRAGMENT_SIZE (char*)"benchmarkLkrFragmentSize"
 
 #define OPTION_WRITE_BROKEN_CREAM_INFO (char*)"printBrokenCreamInfo"
 
@@ -103,7 +173,25 @@ public:
 
 		(OPTION_ETH_DEVICE_NAME,
 				po::value<std::string>()->default_value("dna0"),
-				"Name of the device to be used for receiving data")
+				"Name of the device to be used for receiving data. Use pcap:$fileName to replay a pcap file instead of using pf_ring")
+
+		(OPTION_PCAP_REPLAY_FILES, po::value<std::string>()->default_value(""),
+				"Comma separated list of pcap files to be replayed instead of receiving frames via pf_ring")
+
+		(OPTION_PCAP_REPLAY_MODE, po::value<int>()->default_value(0),
+				"Pacing of the pcap replay. 0: recorded timestamps, 1: fixed rate defined by pcapReplayRate, 2: as fast as possible")
+
+		(OPTION_PCAP_REPLAY_RATE, po::value<double>()->default_value(1E6),
+				"Number of frames per second to be replayed with pcapReplayMode=1")
+
+		(OPTION_PCAP_REPLAY_LOOPS, po::value<int>()->default_value(1),
+				"Number of times the pcap files should be replayed. 0 means forever")
+
+		(OPTION_PCAP_REPLAY_QUEUES, po::value<int>()->default_value(1),
+				"Number of PacketHandler queues the replayed frames are distributed to by their source IP")
+
+		(OPTION_PCAP_REPLAY_IP, po::value<std::string>()->default_value(""),
+				"IP of this PC in the replayed traffic. If empty the destination of the first IP packet is used")
 
 		(OPTION_L0_RECEIVER_PORT, po::value<int>()->default_value(58913),
 				"UDP-Port for L1 data reception")
@@ -135,6 +223,27 @@ public:
 		(OPTION_L1_DOWNSCALE_FACTOR, po::value<int>()->required(),
 				"With this integer you can downscale the event rate going to L2 to a factor of 1/L1DownscaleFactor. The L1 Trigger will accept every even if  i++%downscaleFactor==0")
 
+		(OPTION_L1_BATCH_SIZE, po::value<int>()->default_value(1),
+				"Number of complete events collected by a thread before the L1 trigger is processed for all of them. 1 processes every event immediately")
+
+		(OPTION_L1_BATCH_MAX_DELAY, po::value<int>()->default_value(100),
+				"Maximum number of microseconds a complete event waits for its L1 batch to be processed")
+
+		(OPTION_PIPELINE_L1_CONCURRENCY, po::value<int>()->default_value(0),
+				"Maximum number of tasks processing the L1 pipeline stage. 0 processes L1 within the thread that completed the events")
+
+		(OPTION_PIPELINE_LKR_REQUEST_CONCURRENCY, po::value<int>()->default_value(0),
+				"Maximum number of tasks sending the LKr data requests of L1 accepted events. 0 sends them within the L1 thread")
+
+		(OPTION_PIPELINE_L2_CONCURRENCY, po::value<int>()->default_value(0),
+				"Maximum number of tasks processing the L2 pipeline stage. 0 processes L2 within the thread that completed the events")
+
+		(OPTION_PIPELINE_STORAGE_CONCURRENCY, po::value<int>()->default_value(0),
+				"Maximum number of tasks serializing L2 accepted events for the mergers. 0 serializes them within the L2 thread")
+
+		(OPTION_PIPELINE_QUEUE_CAPACITY, po::value<int>()->default_value(4096),
+				"Maximum number of events queued in front of every pipeline stage. If a queue is full the previous stage processes the events itself")
+
 		(OPTION_L2_DOWNSCALE_FACTOR, po::value<int>()->required(),
 				"With this integer you can downscale the event rate accepted by L2 to a factor of 1/L1DownscaleFactor. The L2 Trigger will accept every even if  i++%downscaleFactor==0")
 
@@ -166,20 +275,68 @@ public:
 		(OPTION_MERGER_PORT, po::value<int>()->required(),
 				"The TCP port the merger is listening to.")
 
+		(OPTION_ZERO_COPY_OUTPUT, po::value<bool>()->default_value(false),
+				"Send events as multipart messages pointing directly to the received fragments instead of copying them into one buffer. The merger has to concatenate the parts")
+
+		(OPTION_NUMBER_OF_MERGER_SENDERS, po::value<int>()->default_value(1),
+				"Number of threads sending the accepted events to the mergers")
+
+		(OPTION_OUTPUT_BATCH_SIZE, po::value<int>()->default_value(0),
+				"Pack the events of one burst into messages of up to this number of bytes (EVENT_BATCH_HDR format). 0 sends every event as a separate message")
+
+		(OPTION_OUTPUT_BATCH_MAX_AGE, po::value<int>()->default_value(1000),
+				"Maximum number of microseconds an event waits in an unfinished batch")
+
+		(OPTION_OUTPUT_COMPRESSION_LEVEL, po::value<int>()->default_value(0),
+				"Compression of the messages sent to the mergers: 0 disables it, 1 uses LZ4, higher values use LZ4HC with this level")
+
+		(OPTION_OUTPUT_COMPRESSION_ACCELERATION, po::value<int>()->default_value(1),
+				"Acceleration of the LZ4 compression (level 1). Higher values compress faster but less")
+
+		(OPTION_OUTPUT_QUEUE_HIGH_WATERMARK, po::value<int>()->default_value(10000),
+				"Number of events queued for the mergers at which new events are written to the spool file")
+
+		(OPTION_OUTPUT_QUEUE_LOW_WATERMARK, po::value<int>()->default_value(1000),
+				"Number of events queued for the mergers below which the spooled events are replayed")
+
+		(OPTION_SPOOL_FILE, po::value<std::string>()->default_value(""),
+				"File accepted events are spooled to if the mergers are too slow (e.g. /tmp/na62-farm-spool.dat). If empty these events are dropped")
+
+		(OPTION_MAX_SPOOL_SIZE, po::value<int>()->default_value(4096),
+				"Maximum size of the spool file in MB")
+
+		(OPTION_OUTPUT_BUFFER_CACHE_SIZE, po::value<int>()->default_value(4 << 20),
+				"Maximum number of bytes of free output buffers kept per trigger type and buffer size class")
+
 		(OPTION_ZMQ_IO_THREADS, po::value<int>()->default_value(1),
 				"Number of ZMQ IO threads")
 
 		(OPTION_PH_SCHEDULER, po::value<int>()->default_value(2),
 				"Process scheduling policy to be used for the PacketHandler threads. 1: FIFO, 2: RR")
 
+		(OPTION_NUMA_AWARE, po::value<bool>()->default_value(false),
+				"Pin the PacketHandlers to cores of the NIC's NUMA node, process their frames in a TBB arena pinned to that node and interleave the event pool over all nodes. If false the PacketHandlers are distributed alternately over two sockets")
+
+		(OPTION_RUN_TO_COMPLETION, po::value<bool>()->default_value(false),
+				"Process the received frames directly within the PacketHandler threads instead of HandleFrameTasks. Only the L1 and L2 trigger processing of complete events is done in the TBB pool")
+
+		(OPTION_CHECK_CHECKSUMS, po::value<bool>()->default_value(false),
+				"Drop all received frames with wrong IP header or UDP checksums")
+
 		(OPTION_ACTIVE_POLLING, po::value<int>()->default_value(1),
-				"Use active polling (high CPU usage, might be faster depending on the number of pf_ring queues)")
+				"Use active polling (high CPU usage, might be faster depending on the number of pf_ring queues). If set the PacketHandlers spin or tpause but never sleep or block on the ring")
 
 		(OPTION_POLLING_DELAY, po::value<double>()->default_value(1E5),
-				"Number of ticks to wait between two polls")
+				"Maximum number of TSC ticks to wait between two polls. The actual delay adapts to the inter-arrival time of the frames")
 
 		(OPTION_POLLING_SLEEP_MICROS, po::value<int>()->default_value(1E4),
-				"Number of microseconds to sleep if polling was unsuccessful during the last tries")
+				"Maximum number of microseconds to sleep if polling was unsuccessful during the last tries. The sleep time starts at 1 microsecond and is doubled with every unsuccessful poll")
+
+		(OPTION_IDLE_MAX_SPIN_MICROS, po::value<int>()->default_value(20),
+				"Maximum time in microseconds since the last frame during which a PacketHandler spins with pause instructions")
+
+		(OPTION_IDLE_MAX_WAIT_MICROS, po::value<int>()->default_value(1000),
+				"Maximum time in microseconds since the last frame during which a PacketHandler waits with tpause (or yields if not available) before it sleeps or blocks on the ring")
 
 		(OPTION_MAX_FRAME_AGGREGATION, po::value<int>()->default_value(100000),
 				"Maximum number of frames aggregated before spawning a TBB task to process them")
@@ -187,12 +344,36 @@ public:
 		(OPTION_MAX_AGGREGATION_TIME, po::value<int>()->default_value(100000),
 				"Maximum time for one frame aggregation period before spawning a new TBB task in microseconds")
 
+		(OPTION_FRAME_BUFFER_SIZE, po::value<int>()->default_value(2048),
+				"Size of the pooled buffers received frames are copied to. Larger frames are copied to separately allocated buffers")
+
+		(OPTION_FRAME_BUFFERS_PER_QUEUE, po::value<int>()->default_value(8192),
+				"Number of frame buffers preallocated for every RX queue")
+
+		(OPTION_FRAGMENT_SLOTS, po::value<int>()->default_value(512),
+				"Number of IP datagrams that can be reassembled concurrently. Fragments of additional datagrams are dropped")
+
+		(OPTION_MAX_DATAGRAM_SIZE, po::value<int>()->default_value(16384),
+				"Maximum IP payload size of fragmented datagrams in bytes. Every reassembly slot preallocates a buffer of this size")
+
+		(OPTION_MAX_FRAGMENT_AGE, po::value<int>()->default_value(1000),
+				"Milliseconds after the first fragment after which an unfinished IP datagram is dropped. Unfinished datagrams are also dropped at the end of the burst")
+
+		(OPTION_MAX_FRAGMENT_BYTES, po::value<int>()->default_value(4 << 20),
+				"Maximum number of bytes held by unfinished IP datagrams. If exceeded the oldest datagrams of the shard are dropped, or the new fragment if the shard holds none")
+
 		(OPTION_PRINT_MISSING_SOURCES, po::value<bool>()->default_value(false),
 				"Print out the source IDs and CREAM/crate IDs that have not been received during the last burst")
 
 		(OPTION_INCREMENT_BURST_AT_EOB, po::value<bool>()->default_value(false),
 				"Print out the source IDs and CREAM/crate IDs that have not been received during the last burst")
 
+		(OPTION_EVENT_AGING_TIMEOUT, po::value<int>()->default_value(0),
+				"Milliseconds after the first fragment an incomplete L0 event is dropped. 0 keeps incomplete events until the end of the burst")
+
+		(OPTION_EVENT_AGING_TABLE_SIZE, po::value<int>()->default_value(1 << 20),
+				"Number of events whose age can be tracked at the same time. Rounded up to the next power of two")
+
 		(OPTION_STRAW_PORT, po::value<int>()->default_value(58916),
 
 				"UDP-Port to be used to receive raw data stream coming from the Straws.")
@@ -206,10 +387,67 @@ public:
 		(OPTION_STRAW_ZMQ_DST_HOSTS, po::value<std::string>()->required(),
 				"Comma separated list of all hosts that have a ZMQ PULL socket listening to the strawZmqPort to receive STRAW data")
 
+		(OPTION_EVENT_TRACING, po::value<bool>()->default_value(false),
+				"Timestamp every event at each processing stage and publish the latency percentiles per stage and L1 trigger word")
+
+		(OPTION_EVENT_TRACE_TABLE_SIZE, po::value<int>()->default_value(65536),
+				"Number of events that can be traced at the same time. Rounded up to the next power of two")
+
+		(OPTION_EVENT_TRACE_SAMPLING, po::value<int>()->default_value(0),
+				"Write all timestamps of every n-th event to the eventTraceFile. 0 disables the sampling")
+
+		(OPTION_EVENT_TRACE_FILE, po::value<std::string>()->default_value("/tmp/na62-farm-event-traces.txt"),
+				"File the sampled event traces are appended to")
+
+		(OPTION_MONITOR_LOG_INTERVAL, po::value<int>()->default_value(60),
+				"Number of seconds between two log lines with all monitoring values. 0 disables the logging")
+
+		(OPTION_METRICS_SOCKET, po::value<std::string>()->default_value(""),
+				"Unix socket serving all monitoring values in the Prometheus text format (e.g. /tmp/na62-farm-metrics.sock). Empty to disable")
+
+		(OPTION_STATISTICS_PAGE, po::value<std::string>()->default_value(""),
+				"Name of the shared memory segment the counters are published to (e.g. /na62-farm-stats, see monitoring/StatisticsPage.h). Empty to disable")
+
+		(OPTION_STATISTICS_PAGE_INTERVAL, po::value<int>()->default_value(100),
+				"Milliseconds between two updates of the shared memory statistics page")
+
+		(OPTION_SAMPLER_INTERVAL, po::value<int>()->default_value(0),
+				"Milliseconds between two samples of the key counters (queued tasks, drops, rates), e.g. 5. 0 disables the sampler")
+
+		(OPTION_SAMPLER_HISTORY, po::value<int>()->default_value(120),
+				"Number of seconds of counter samples kept in memory")
+
+		(OPTION_SAMPLER_AUTO_DUMP, po::value<bool>()->default_value(false),
+				"Write the counter samples to the samplerDumpDirectory one second after frames or events have been dropped")
+
+		(OPTION_SAMPLER_MIN_DUMP_INTERVAL, po::value<int>()->default_value(60),
+				"Minimum number of seconds between two automatic dumps of the counter samples")
+
+		(OPTION_SAMPLER_DUMP_DIRECTORY, po::value<std::string>()->default_value("/tmp"),
+				"Directory the counter samples are written to")
+
 		(OPTION_WRITE_BROKEN_CREAM_INFO,
 				po::value<bool>()->default_value(false),
 				"If set to 1, information about broken cream data (already received/not requested) is written to /tmp/farm-logs)")
 
+		(OPTION_BENCHMARK, po::value<bool>()->default_value(false),
+				"Instead of receiving data run a throughput benchmark with synthetic MEPs and CREAM fragments sending the events to a local merger sink listening at mergerPort")
+
+		(OPTION_BENCHMARK_EVENTS, po::value<int>()->default_value(1000000),
+				"Number of events to be generated for every benchmark run")
+
+		(OPTION_BENCHMARK_MAX_THREADS, po::value<int>()->default_value(0),
+				"The benchmark is run with 1 to benchmarkMaxThreads TBB threads. 0 means the number of CPU cores")
+
+		(OPTION_BENCHMARK_EVENTS_PER_MEP, po::value<int>()->default_value(8),
+				"Number of events per generated MEP")
+
+		(OPTION_BENCHMARK_L0_FRAGMENT_SIZE, po::value<int>()->default_value(64),
+				"Payload size of every generated L0 fragment in bytes")
+
+		(OPTION_BENCHMARK_LKR_FRAGMENT_SIZE, po::value<int>()->default_value(64),
+				"Payload size of every generated CREAM fragment in bytes")
+
 				;
 
 		Options::Initialize(argc, argv, desc);
@@ -7,13 +7,272 @@
 
 #include "FragmentStore.h"
 
+#include <net/ethernet.h>
+#include <netinet/in.h>
+#include <netinet/ip.h>
+#include <chrono>
+#include <cstring>
+
+#include <options/Logging.h>
+#include <options/Options.h>
+
+#include "../options/MyOptions.h"
+#include "FrameBufferPool.h"
+
 namespace na62 {
 
-const uint FragmentStore::numberOfFragmentStores_;
-std::map<uint64_t, std::vector<DataContainer>> FragmentStore::fragmentsById_[];
-tbb::spin_mutex FragmentStore::newFragmentMutexes_[];
+const uint FragmentStore::numberOfShards_;
+FragmentStore::Shard FragmentStore::shards_[];
+
+uint FragmentStore::slotsPerShard_;
+uint FragmentStore::bufferSize_;
+uint FragmentStore::maxIPPayloadBytes_;
+uint FragmentStore::bitmapWords_;
+uint FragmentStore::maxAgeMillis_;
+uint64_t FragmentStore::maxBytesHeld_;
 
 std::atomic<uint> FragmentStore::numberOfFragmentsReceived_(0);
 std::atomic<uint> FragmentStore::numberOfReassembledFrames_(0);
+std::atomic<uint> FragmentStore::numberOfUnfinishedFrames_(0);
+std::atomic<uint64_t> FragmentStore::numberOfDroppedFragments_(0);
+std::atomic<uint64_t> FragmentStore::numberOfEvictedDatagrams_(0);
+std::atomic<uint64_t> FragmentStore::bytesHeld_(0);
+
+#define HEADER_BYTES (sizeof(ether_header) + sizeof(iphdr))
+
+static inline uint64_t nowMillis() {
+	return std::chrono::duration_cast<std::chrono::milliseconds>(
+			std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void FragmentStore::initialize() {
+	/*
+	 * The number of slots per shard must be a power of two
+	 */
+	const uint slots = std::max(1, Options::GetInt(OPTION_FRAGMENT_SLOTS));
+	slotsPerShard_ = 1;
+	while (slotsPerShard_ * numberOfShards_ < slots) {
+		slotsPerShard_ <<= 1;
+	}
+
+	maxIPPayloadBytes_ = std::min(Options::GetInt(OPTION_MAX_DATAGRAM_SIZE),
+			0xFFFF);
+	maxIPPayloadBytes_ = (maxIPPayloadBytes_ + 7) & ~7u;
+	bufferSize_ = HEADER_BYTES + maxIPPayloadBytes_;
+	bitmapWords_ = (maxIPPayloadBytes_ / 8 + 63) / 64;
+
+	maxAgeMillis_ = Options::GetInt(OPTION_MAX_FRAGMENT_AGE);
+	maxBytesHeld_ = Options::GetInt(OPTION_MAX_FRAGMENT_BYTES);
+
+	for (Shard& shard : shards_) {
+		shard.nextSweepMillis = 0;
+		shard.slots.resize(slotsPerShard_);
+		for (Slot& slot : shard.slots) {
+			slot.used = false;
+			slot.buffer = new char[bufferSize_];
+			slot.blockBitmap = new uint64_t[bitmapWords_];
+		}
+	}
+
+	LOG_INFO<< "Allocated " << slotsPerShard_ * numberOfShards_
+	<< " IP reassembly slots of " << bufferSize_ << " B" << ENDL;
+}
+
+FragmentStore::Slot* FragmentStore::findOrCreateSlot(Shard& shard,
+		const uint64_t fragID, const uint burstID, const uint64_t nowMillis) {
+	uint index = getHomeSlot(fragID);
+	for (uint probe = 0; probe != slotsPerShard_; probe++) {
+		Slot& slot = shard.slots[index];
+		if (!slot.used) {
+			slot.fragID = fragID;
+			slot.used = true;
+			slot.blocksReceived = 0;
+			slot.totalBlocks = 0;
+			slot.ipPayloadBytes = 0;
+			slot.headerReceived = false;
+			slot.bytesHeld = 0;
+			slot.burstID = burstID;
+			slot.firstFragmentMillis = nowMillis;
+			memset(slot.blockBitmap, 0, bitmapWords_ * sizeof(uint64_t));
+			numberOfUnfinishedFrames_.fetch_add(1, std::memory_order_relaxed);
+			return &slot;
+		}
+		if (slot.fragID == fragID) {
+			return &slot;
+		}
+		index = (index + 1) & (slotsPerShard_ - 1);
+	}
+	return nullptr;
+}
+
+void FragmentStore::releaseSlot(Shard& shard, Slot* slot) {
+	const uint mask = slotsPerShard_ - 1;
+	uint hole = slot - shard.slots.data();
+
+	/*
+	 * Backward shift deletion: move every following entry whose home slot is not between the
+	 * hole and its current position into the hole
+	 */
+	for (uint index = (hole + 1) & mask; shard.slots[index].used; index =
+			(index + 1) & mask) {
+		const uint home = getHomeSlot(shard.slots[index].fragID);
+		if (((index - home) & mask) >= ((index - hole) & mask)) {
+			std::swap(shard.slots[hole], shard.slots[index]);
+			hole = index;
+		}
+	}
+	shard.slots[hole].used = false;
+	numberOfUnfinishedFrames_.fetch_sub(1, std::memory_order_relaxed);
+}
+
+void FragmentStore::evictSlot(Shard& shard, Slot* slot) {
+	bytesHeld_.fetch_sub(slot->bytesHeld, std::memory_order_relaxed);
+	numberOfEvictedDatagrams_.fetch_add(1, std::memory_order_relaxed);
+	releaseSlot(shard, slot);
+}
+
+bool FragmentStore::evictOldestSlot(Shard& shard) {
+	Slot* oldest = nullptr;
+	for (Slot& slot : shard.slots) {
+		if (slot.used
+				&& (oldest == nullptr
+						|| slot.firstFragmentMillis < oldest->firstFragmentMillis)) {
+			oldest = &slot;
+		}
+	}
+	if (oldest == nullptr) {
+		return false;
+	}
+	evictSlot(shard, oldest);
+	return true;
+}
+
+void FragmentStore::evictExpiredSlots(Shard& shard, const uint burstID,
+		const uint64_t nowMillis) {
+	for (uint index = 0; index != slotsPerShard_; index++) {
+		/*
+		 * Releasing a slot may shift the next entry into it -> check it again
+		 */
+		Slot* slot = &shard.slots[index];
+		while (slot->used
+				&& (slot->burstID < burstID
+						|| nowMillis - slot->firstFragmentMillis > maxAgeMillis_)) {
+			evictSlot(shard, slot);
+		}
+	}
+}
+
+DataContainer FragmentStore::addFragment(DataContainer&& fragment,
+		uint burstID) {
+	UDP_HDR* hdr = (UDP_HDR*) fragment.data;
+	const uint64_t fragID = generateFragmentID(hdr->ip.saddr, hdr->ip.id);
+	Shard& shard = shards_[fragID % numberOfShards_];
+
+	numberOfFragmentsReceived_.fetch_add(1, std::memory_order_relaxed);
+
+	const uint offset = hdr->getFragmentOffsetInBytes();
+	const uint payloadBytes = ntohs(hdr->ip.tot_len) - sizeof(iphdr);
+
+	/*
+	 * All fragments but the last must carry a multiple of 8 bytes
+	 */
+	if (offset + payloadBytes > maxIPPayloadBytes_
+			|| (hdr->isMoreFragments() && payloadBytes % 8 != 0)
+			|| payloadBytes == 0) {
+		numberOfDroppedFragments_.fetch_add(1, std::memory_order_relaxed);
+		FrameBufferPool::freeFrame(fragment);
+		return {nullptr, 0, false};
+	}
+
+	/*
+	 * Synchronize the access to the shard
+	 */
+	tbb::spin_mutex::scoped_lock my_lock(shard.mutex);
+
+	/*
+	 * Sweep the shard at most every tenth of the maximum age
+	 */
+	const uint64_t now = nowMillis();
+	if (now >= shard.nextSweepMillis) {
+		evictExpiredSlots(shard, burstID, now);
+		shard.nextSweepMillis = now + maxAgeMillis_ / 10;
+	}
+
+	/*
+	 * Reserve the bytes before the data is copied so that concurrent inserts into other
+	 * shards cannot exceed the limit together. Make room by dropping the oldest datagrams of
+	 * this shard and drop the fragment if there are none
+	 */
+	while (bytesHeld_.fetch_add(payloadBytes, std::memory_order_relaxed)
+			+ payloadBytes > maxBytesHeld_) {
+		bytesHeld_.fetch_sub(payloadBytes, std::memory_order_relaxed);
+		if (!evictOldestSlot(shard)) {
+			numberOfDroppedFragments_.fetch_add(1, std::memory_order_relaxed);
+			FrameBufferPool::freeFrame(fragment);
+			return {nullptr, 0, false};
+		}
+	}
+
+	Slot* slot = findOrCreateSlot(shard, fragID, burstID, now);
+	if (slot == nullptr) {
+		evictOldestSlot(shard);
+		slot = findOrCreateSlot(shard, fragID, burstID, now);
+	}
+
+	/*
+	 * Mark the received blocks and ignore duplicates
+	 */
+	const uint firstBlock = offset / 8;
+	const uint endBlock = (offset + payloadBytes + 7) / 8;
+	uint newBlocks = 0;
+	for (uint block = firstBlock; block != endBlock; block++) {
+		uint64_t& word = slot->blockBitmap[block / 64];
+		const uint64_t bit = 1ull << (block % 64);
+		newBlocks += (word & bit) == 0;
+		word |= bit;
+	}
+	if (newBlocks == 0) {
+		bytesHeld_.fetch_sub(payloadBytes, std::memory_order_relaxed);
+		FrameBufferPool::freeFrame(fragment);
+		return {nullptr, 0, false};
+	}
+	slot->blocksReceived += newBlocks;
+	slot->bytesHeld += payloadBytes;
+
+	/*
+	 * Copy the payload to its final position. The headers are taken from the first fragment
+	 */
+	memcpy(slot->buffer + HEADER_BYTES + offset, fragment.data + HEADER_BYTES,
+			payloadBytes);
+	if (offset == 0) {
+		memcpy(slot->buffer, fragment.data, HEADER_BYTES);
+		slot->headerReceived = true;
+	}
+	if (!hdr->isMoreFragments()) {
+		slot->ipPayloadBytes = offset + payloadBytes;
+		slot->totalBlocks = endBlock;
+	}
+	FrameBufferPool::freeFrame(fragment);
+
+	if (slot->totalBlocks == 0 || slot->blocksReceived != slot->totalBlocks) {
+		return {nullptr, 0, false};
+	}
+
+	/*
+	 * Complete: the IP header now describes the unfragmented datagram
+	 */
+	numberOfReassembledFrames_.fetch_add(1, std::memory_order_relaxed);
+	bytesHeld_.fetch_sub(slot->bytesHeld, std::memory_order_relaxed);
+	UDP_HDR* reassembledHdr = (UDP_HDR*) slot->buffer;
+	reassembledHdr->ip.tot_len = htons(sizeof(iphdr) + slot->ipPayloadBytes);
+	reassembledHdr->ip.frag_off = 0;
+
+	DataContainer reassembledFrame = { slot->buffer, (uint16_t) (HEADER_BYTES
+			+ slot->ipPayloadBytes), true };
+	slot->buffer = new char[bufferSize_];
+	releaseSlot(shard, slot);
+
+	return reassembledFrame;
+}
 
 } /* namespace na62 */
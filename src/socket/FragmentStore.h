@@ -11,71 +11,47 @@
 #include <socket/EthernetUtils.h>
 #include <structs/Network.h>
 #include <sys/types.h>
-#include <map>
 #include <vector>
 #include <tbb/spin_mutex.h>
 #include <atomic>
 
-#include <algorithm>
-#include <iterator>
-
-#include <options/Logging.h>
-
 namespace na62 {
 
+/*
+ * Reassembles IP fragments.
+ *
+ * The datagrams being reassembled are stored in a fixed number of slots in open addressing
+ * hash tables keyed by (saddr, ip.id). The tables are split into shards with separate locks.
+ * Every slot owns a preallocated buffer the payload of every fragment is copied to directly at
+ * its final offset. The received 8 byte blocks are marked in a bitmap so that duplicates are
+ * ignored and the completion is detected without walking through the fragments.
+ *
+ * The buffer of a completed datagram is handed over to the caller and replaced by a new one.
+ *
+ * Datagrams that are older than maxFragmentAge or belong to a previous burst are evicted as
+ * soon as their shard is touched again. If the table is full or more than maxFragmentBytes
+ * are held the oldest datagrams of the shard are evicted to make room for new fragments.
+ * The bytes are reserved before a fragment is stored, so maxFragmentBytes is a hard limit
+ * over all shards.
+ */
 class FragmentStore {
 
 public:
-	static DataContainer addFragment(DataContainer&& fragment) {
-		UDP_HDR* hdr = (UDP_HDR*) fragment.data;
-		const uint64_t fragID = generateFragmentID(hdr->ip.saddr, hdr->ip.id);
-		const uint fragmentStoreNum = fragID % numberOfFragmentStores_;
-
-		numberOfFragmentsReceived_++;
-
-		/*
-		 * Synchronize fragmentsById access
-		 */
-		tbb::spin_mutex::scoped_lock my_lock(
-				newFragmentMutexes_[fragmentStoreNum]);
-
-		auto& fragmentsReceived = fragmentsById_[fragmentStoreNum][fragID];
-
-		fragmentsReceived.push_back(std::move(fragment));
-
-		uint sumOfIPPayloadBytes = 0;
-		UDP_HDR* lastFragment = nullptr;
-
-		for (auto& frag : fragmentsReceived) {
-			UDP_HDR* hdr = (UDP_HDR*) frag.data;
-
-			sumOfIPPayloadBytes += ntohs(hdr->ip.tot_len) - sizeof(iphdr);
-
-			if (!hdr->isMoreFragments()) {
-				lastFragment = hdr;
-			}
-		}
-
-		if (lastFragment != nullptr) {
-			uint expectedPayloadSum = lastFragment->getFragmentOffsetInBytes()
-					+ ntohs(lastFragment->ip.tot_len) - sizeof(iphdr);
-			/*
-			 * Check if we've received as many bytes as the offset of the last fragment plus its size
-			 */
-			if (expectedPayloadSum == sumOfIPPayloadBytes) {
-				numberOfReassembledFrames_++;
-				DataContainer reassembledFrame = reassembleFrame(
-						fragmentsReceived);
-				fragmentsById_[fragmentStoreNum].erase(
-						generateFragmentID(hdr->ip.saddr, hdr->ip.id));
-//				fragmentsReceived.clear();
-
-				return reassembledFrame;
-			}
-		}
-
-		return {nullptr, 0, false};
-	}
+	/**
+	 * Allocates all slots and their buffers
+	 */
+	static void initialize();
+
+	/**
+	 * Adds the fragment to its datagram. The fragment is freed.
+	 *
+	 * @param burstID The burst the fragment has been received in. Unfinished datagrams of
+	 * previous bursts are evicted
+	 *
+	 * @return The reassembled datagram if this was the missing fragment. Otherwise a container
+	 * with data==nullptr
+	 */
+	static DataContainer addFragment(DataContainer&& fragment, uint burstID);
 
 	static uint getNumberOfReceivedFragments() {
 		return numberOfFragmentsReceived_;
@@ -86,89 +62,119 @@ public:
 	}
 
 	static uint getNumberOfUnfinishedFrames() {
-		uint sum = 0;
-		for (auto store : fragmentsById_) {
-			sum += store.size();
-		}
-		return sum;
+		return numberOfUnfinishedFrames_;
 	}
 
-private:
-	static const uint numberOfFragmentStores_ = 32;
-	static std::map<uint64_t, std::vector<DataContainer>> fragmentsById_[numberOfFragmentStores_];
-	static tbb::spin_mutex newFragmentMutexes_[numberOfFragmentStores_];
+	/*
+	 * Number of fragments dropped because the datagram did not fit into a slot's buffer or
+	 * the fragment was inconsistent with the others
+	 */
+	static uint64_t getNumberOfDroppedFragments() {
+		return numberOfDroppedFragments_;
+	}
 
-	static std::atomic<uint> numberOfFragmentsReceived_;
-	static std::atomic<uint> numberOfReassembledFrames_;
+	/*
+	 * Number of unfinished datagrams removed due to their age, a burst change or to make room
+	 * for new datagrams
+	 */
+	static uint64_t getNumberOfEvictedDatagrams() {
+		return numberOfEvictedDatagrams_;
+	}
 
-	static inline uint64_t generateFragmentID(const uint32_t srcIP,
-			const uint16_t fragID) {
-		return (uint64_t) fragID | ((uint64_t) srcIP << 16);
+	/*
+	 * Sum of the payload bytes of all unfinished datagrams
+	 */
+	static uint64_t getNumberOfBytesHeld() {
+		return bytesHeld_;
 	}
 
-	static DataContainer reassembleFrame(std::vector<DataContainer> fragments) {
+private:
+	struct Slot {
+		uint64_t fragID;
+		bool used;
+
 		/*
-		 * Sort the fragments by offset
+		 * Ethernet and IP header followed by the IP payload
 		 */
-		std::sort(fragments.begin(), fragments.end(),
-				[](const DataContainer& a, const DataContainer& b) {
-					UDP_HDR* hdr1 = (UDP_HDR*) a.data;
-					UDP_HDR* hdr2 = (UDP_HDR*) b.data;
-					return hdr1->getFragmentOffsetInBytes() < hdr2->getFragmentOffsetInBytes();
-				});
+		char* buffer;
+		uint64_t* blockBitmap;
 
-		UDP_HDR* lastFragment = (UDP_HDR*) fragments.back().data;
+		uint blocksReceived;
+		/*
+		 * Known as soon as the last fragment has been received
+		 */
+		uint totalBlocks;
+		uint ipPayloadBytes;
+		bool headerReceived;
 
 		/*
-		 * We'll copy the ethernet and IP header of the first frame plus all IP-Payload of all frames
+		 * Payload bytes copied into the buffer so far
 		 */
-		uint16_t totalBytes = sizeof(ether_header)
-				+ lastFragment->getFragmentOffsetInBytes()
-				+ ntohs(lastFragment->ip.tot_len);
-
-		char* newFrameBuff = new char[totalBytes];
-
-		uint16_t currentOffset = sizeof(ether_header) + sizeof(iphdr);
-		for (DataContainer& fragment : fragments) {
-			UDP_HDR* currentData = (UDP_HDR*) fragment.data;
-
-			if (currentData->getFragmentOffsetInBytes() + sizeof(ether_header)
-					+ sizeof(iphdr) != currentOffset) {
-				LOG_ERROR
-						<< "Error while reassembling IP fragments: sum of fragment lengths is "
-						<< currentOffset << " but offset of current frame is "
-						<< currentData->getFragmentOffsetInBytes() << ENDL;
-
-				for (DataContainer& fragment : fragments) {
-					if (fragment.data != nullptr) {
-						delete[] fragment.data;
-					}
-				}
-
-				return {nullptr, 0, false};
-			}
-
-			/*
-			 * Copy the payload of the IP datagram to the buffer
-			 *
-			 * The payload starts after sizeof(ether_header) + sizeof(iphdr) and is ntohs(currentData->ip.tot_len) - sizeof(iphdr) bytes long
-			 */
-			if (&fragment == &fragments.front()) {
-				/*
-				 * First frame is copied entirely
-				 */
-				memcpy(newFrameBuff, fragment.data, fragment.length);
-				currentOffset = fragment.length;
-			} else {
-				memcpy(newFrameBuff + currentOffset,
-						fragment.data + sizeof(ether_header) + sizeof(iphdr),
-						ntohs(currentData->ip.tot_len) - sizeof(iphdr));
-				currentOffset += ntohs(currentData->ip.tot_len) - sizeof(iphdr);
-			}
-			delete[] fragment.data;
-		}
-		return {newFrameBuff, currentOffset, true};
+		uint bytesHeld;
+		uint burstID;
+		uint64_t firstFragmentMillis;
+	};
+
+	struct Shard {
+		tbb::spin_mutex mutex;
+		std::vector<Slot> slots;
+		uint64_t nextSweepMillis;
+	};
+
+	static const uint numberOfShards_ = 32;
+	static Shard shards_[numberOfShards_];
+
+	static uint slotsPerShard_;
+	static uint bufferSize_;
+	static uint maxIPPayloadBytes_;
+	static uint bitmapWords_;
+	static uint maxAgeMillis_;
+	static uint64_t maxBytesHeld_;
+
+	static std::atomic<uint> numberOfFragmentsReceived_;
+	static std::atomic<uint> numberOfReassembledFrames_;
+	static std::atomic<uint> numberOfUnfinishedFrames_;
+	static std::atomic<uint64_t> numberOfDroppedFragments_;
+	static std::atomic<uint64_t> numberOfEvictedDatagrams_;
+	static std::atomic<uint64_t> bytesHeld_;
+
+	static inline uint64_t generateFragmentID(const uint32_t srcIP,
+			const uint16_t fragID) {
+		return (uint64_t) fragID | ((uint64_t) srcIP << 16);
 	}
+
+	static inline uint getHomeSlot(const uint64_t fragID) {
+		return ((fragID * 0x9E3779B97F4A7C15ull) >> 32) & (slotsPerShard_ - 1);
+	}
+
+	/**
+	 * @return The slot of the datagram, a newly initialized one or nullptr if the shard is full
+	 */
+	static Slot* findOrCreateSlot(Shard& shard, const uint64_t fragID,
+			const uint burstID, const uint64_t nowMillis);
+
+	/**
+	 * Frees the slot and moves following entries of the probe sequence back
+	 */
+	static void releaseSlot(Shard& shard, Slot* slot);
+
+	/**
+	 * Drops the unfinished datagram of the slot
+	 */
+	static void evictSlot(Shard& shard, Slot* slot);
+
+	/**
+	 * Evicts the datagram of the shard with the oldest first fragment
+	 *
+	 * @return false if the shard is empty
+	 */
+	static bool evictOldestSlot(Shard& shard);
+
+	/**
+	 * Evicts all datagrams of the shard that are too old or from a previous burst
+	 */
+	static void evictExpiredSlots(Shard& shard, const uint burstID,
+			const uint64_t nowMillis);
 };
 
 } /* namespace na62 */
@@ -0,0 +1,62 @@
+/*
+ * FrameBatchTask.h
+ *
+ *  Created on: Oct 16, 2026
+ *      Author: Jonas Kunze (kunze.jonas@gmail.com)
+ */
+
+#pragma once
+#ifndef FRAMEBATCHTASK_H_
+#define FRAMEBATCHTASK_H_
+
+#include <tbb/task.h>
+#include <atomic>
+#include <vector>
+
+#include <socket/EthernetUtils.h>
+
+#include "../eventBuilding/L1Builder.h"
+#include "HandleFrameTask.h"
+
+namespace na62 {
+
+/*
+ * Task processing a batch of frames that have all been classified to be of the same type by
+ * the PacketHandler. All checks have already been done so the loop only calls PROCESS.
+ */
+template<void (*PROCESS)(DataContainer&&, uint)>
+class FrameBatchTask: public tbb::task {
+public:
+	FrameBatchTask(std::vector<DataContainer>&& containers, uint burstID) :
+			containers_(std::move(containers)), burstID_(burstID) {
+		HandleFrameTask::queuedTasksNum_.fetch_add(1,
+				std::memory_order_relaxed);
+	}
+
+	virtual ~FrameBatchTask() {
+		HandleFrameTask::queuedTasksNum_.fetch_sub(1,
+				std::memory_order_relaxed);
+	}
+
+	tbb::task* execute() {
+		for (DataContainer& container : containers_) {
+			PROCESS(std::move(container), burstID_);
+			L1Builder::flushL1BatchIfExpired();
+		}
+		L1Builder::flushL1Batch();
+		return nullptr;
+	}
+
+private:
+	std::vector<DataContainer> containers_;
+	const uint burstID_;
+};
+
+typedef FrameBatchTask<HandleFrameTask::processL0Frame> L0FrameTask;
+typedef FrameBatchTask<HandleFrameTask::processCreamFrame> CreamFrameTask;
+typedef FrameBatchTask<HandleFrameTask::processStrawFrame> StrawFrameTask;
+typedef FrameBatchTask<HandleFrameTask::processFragment> FragmentTask;
+
+} /* namespace na62 */
+
+#endif /* FRAMEBATCHTASK_H_ */
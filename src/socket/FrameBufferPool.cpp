@@ -0,0 +1,166 @@
+/*
+ * FrameBufferPool.cpp
+ *
+ *  Created on: Oct 16, 2026
+ *      Author: Jonas Kunze (kunze.jonas@gmail.com)
+ */
+
+#include "FrameBufferPool.h"
+
+#include <cstring>
+#include <new>
+
+#include <options/Logging.h>
+#include <options/Options.h>
+
+#include "../options/MyOptions.h"
+
+namespace na62 {
+
+std::atomic<FrameBufferPool*> FrameBufferPool::pools_[MAX_NUMBER_OF_POOLS];
+std::atomic<uint> FrameBufferPool::numberOfPools_(0);
+uint FrameBufferPool::BufferSize_;
+uint FrameBufferPool::BuffersPerQueue_;
+
+FrameBufferPool::FrameBufferPool(uint bufferSize, uint numberOfBuffers) :
+		bufferSize_(bufferSize), slotSize_(bufferSize + sizeof(SlotTrailer)), slots_(
+				(char*) ::operator new((size_t) slotSize_ * numberOfBuffers)), slotsEnd_(
+				slots_ + (size_t) slotSize_ * numberOfBuffers), allocations_(0), framesCopied_(
+				0), bytesCopied_(0), movedToHeap_(0) {
+	/*
+	 * Writing the trailers touches all pages on the NUMA node of the receiving thread
+	 */
+	for (char* buffer = slots_; buffer != slotsEnd_; buffer += slotSize_) {
+		SlotTrailer* trailer = new (buffer + bufferSize_) SlotTrailer();
+		trailer->pool = this;
+		trailer->refCount = 0;
+		freeBuffers_.push(buffer);
+	}
+}
+
+FrameBufferPool::~FrameBufferPool() {
+	::operator delete(slots_);
+}
+
+void FrameBufferPool::initialize(uint numberOfQueues) {
+	/*
+	 * The trailer behind the frame data must be aligned
+	 */
+	BufferSize_ = MyOptions::GetInt(OPTION_FRAME_BUFFER_SIZE);
+	BufferSize_ = (BufferSize_ + sizeof(void*) - 1) & ~(sizeof(void*) - 1);
+
+	BuffersPerQueue_ = MyOptions::GetInt(OPTION_FRAME_BUFFERS_PER_QUEUE);
+
+	if (numberOfQueues > MAX_NUMBER_OF_POOLS) {
+		LOG_ERROR<< "At most " << MAX_NUMBER_OF_POOLS << " RX queues are supported but "
+		<< numberOfQueues << " are configured" << ENDL;
+		exit(1);
+	}
+
+	LOG_INFO<< "Allocating " << BuffersPerQueue_ << " frame buffers of "
+	<< BufferSize_ << " B for each of the " << numberOfQueues << " RX queues" << ENDL;
+
+	for (uint queue = 0; queue != numberOfQueues; queue++) {
+		pools_[queue] = nullptr;
+	}
+	numberOfPools_ = numberOfQueues;
+}
+
+FrameBufferPool* FrameBufferPool::createPool(uint queueNumber) {
+	FrameBufferPool* pool = new FrameBufferPool(BufferSize_, BuffersPerQueue_);
+	pools_[queueNumber].store(pool, std::memory_order_release);
+	return pool;
+}
+
+DataContainer FrameBufferPool::copyFrame(const char* frame,
+		const uint16_t length, const bool pooled) {
+	framesCopied_.fetch_add(1, std::memory_order_relaxed);
+	bytesCopied_.fetch_add(length, std::memory_order_relaxed);
+
+	if (!pooled || length > bufferSize_) {
+		allocations_.fetch_add(1, std::memory_order_relaxed);
+		char* data = new char[length];
+		memcpy(data, frame, length);
+		return {data, length, true};
+	}
+
+	char* buffer;
+	if (!freeBuffers_.try_pop(buffer)) {
+		/*
+		 * All slots are in use -> fall back to the heap
+		 */
+		allocations_.fetch_add(1, std::memory_order_relaxed);
+		char* data = new char[length];
+		memcpy(data, frame, length);
+		return {data, length, true};
+	}
+	getTrailer(buffer)->refCount.store(1, std::memory_order_relaxed);
+
+	memcpy(buffer, frame, length);
+	return {buffer, length, false};
+}
+
+void FrameBufferPool::release(char* buffer) {
+	SlotTrailer* trailer = getTrailer(buffer);
+	if (trailer->refCount.fetch_sub(1, std::memory_order_acq_rel) != 1) {
+		return;
+	}
+	trailer->pool->freeBuffers_.push(buffer);
+}
+
+void FrameBufferPool::copyToHeap(DataContainer& container) {
+	getTrailer(container.data)->pool->movedToHeap_.fetch_add(1,
+			std::memory_order_relaxed);
+
+	char* data = new char[container.length];
+	memcpy(data, container.data, container.length);
+	release(container.data);
+	container.data = data;
+	container.ownerMayFreeData = true;
+}
+
+uint64_t FrameBufferPool::GetAllocations() {
+	uint64_t sum = 0;
+	for (uint queue = 0; queue != numberOfPools_; queue++) {
+		FrameBufferPool* pool = pools_[queue];
+		if (pool != nullptr) {
+			sum += pool->allocations_;
+		}
+	}
+	return sum;
+}
+
+uint64_t FrameBufferPool::GetFramesCopied() {
+	uint64_t sum = 0;
+	for (uint queue = 0; queue != numberOfPools_; queue++) {
+		FrameBufferPool* pool = pools_[queue];
+		if (pool != nullptr) {
+			sum += pool->framesCopied_;
+		}
+	}
+	return sum;
+}
+
+uint64_t FrameBufferPool::GetBytesCopied() {
+	uint64_t sum = 0;
+	for (uint queue = 0; queue != numberOfPools_; queue++) {
+		FrameBufferPool* pool = pools_[queue];
+		if (pool != nullptr) {
+			sum += pool->bytesCopied_;
+		}
+	}
+	return sum;
+}
+
+uint64_t FrameBufferPool::GetBuffersMovedToHeap() {
+	uint64_t sum = 0;
+	for (uint queue = 0; queue != numberOfPools_; queue++) {
+		FrameBufferPool* pool = pools_[queue];
+		if (pool != nullptr) {
+			sum += pool->movedToHeap_;
+		}
+	}
+	return sum;
+}
+
+} /* namespace na62 */
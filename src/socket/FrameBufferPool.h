@@ -0,0 +1,170 @@
+/*
+ * FrameBufferPool.h
+ *
+ *  Created on: Oct 16, 2026
+ *      Author: Jonas Kunze (kunze.jonas@gmail.com)
+ */
+
+#pragma once
+#ifndef FRAMEBUFFERPOOL_H_
+#define FRAMEBUFFERPOOL_H_
+
+#include <sys/types.h>
+#include <atomic>
+#include <cstdint>
+#include <tbb/concurrent_queue.h>
+
+#include <socket/EthernetUtils.h>
+
+namespace na62 {
+
+/*
+ * Pool of fixed size frame buffers owned by one RX queue.
+ *
+ * All buffers of a pool are slots in one contiguous block. Behind the frame data every
+ * slot carries a SlotTrailer storing the owning pool and a reference counter.
+ *
+ * MEP and LkrFragment (na62-farm-lib) free their frame with delete[] and have no way to
+ * return it to a pool. Frames for them are therefore copied into heap buffers by the
+ * PacketHandler (see copyFrame()).
+ *
+ * DataContainers pointing to pooled buffers have ownerMayFreeData==false. They must be
+ * freed via freeFrame() or release().
+ */
+class FrameBufferPool {
+public:
+	FrameBufferPool(uint bufferSize, uint numberOfBuffers);
+	virtual ~FrameBufferPool();
+
+	/**
+	 * Prepares one pool for every RX queue. The pools are created by createPool()
+	 */
+	static void initialize(uint numberOfQueues);
+
+	/**
+	 * Allocates the buffers of the queue's pool. Must be called by the thread receiving
+	 * from the queue after it has been pinned so that the buffers are allocated on its NUMA node
+	 */
+	static FrameBufferPool* createPool(uint queueNumber);
+
+	static inline FrameBufferPool* getPool(uint queueNumber) {
+		return pools_[queueNumber];
+	}
+
+	/**
+	 * Copies the given frame into a pooled buffer. Frames larger than bufferSize_, received
+	 * while all slots are in use or with pooled==false are copied into a separate heap
+	 * buffer (ownerMayFreeData==true)
+	 *
+	 * Must only be called by the thread receiving from this pool's queue
+	 *
+	 * @param pooled false for frames that will be freed with delete[]
+	 */
+	DataContainer copyFrame(const char* frame, const uint16_t length,
+			const bool pooled);
+
+	/**
+	 * Decrements the reference counter of the pooled buffer and puts it back to its pool
+	 * as soon as the last reference is gone
+	 */
+	static void release(char* buffer);
+
+	/**
+	 * Frees the data of the container, independent of whether it is pooled or not
+	 */
+	static inline void freeFrame(DataContainer& container) {
+		if (container.data == nullptr) {
+			return;
+		}
+		if (container.ownerMayFreeData) {
+			container.free();
+		} else {
+			release(container.data);
+			container.data = nullptr;
+		}
+	}
+
+	/**
+	 * Must be called before the data of the container is passed to an object freeing it
+	 * with delete[] (MEP, LkrFragment). A pooled buffer is copied into a heap buffer and
+	 * released
+	 */
+	static inline void moveToHeap(DataContainer& container) {
+		if (!container.ownerMayFreeData) {
+			copyToHeap(container);
+		}
+	}
+
+	/**
+	 * Number of heap allocations done for received frames since startup
+	 */
+	static uint64_t GetAllocations();
+
+	/**
+	 * Number of frames copied into pooled or heap buffers since startup
+	 */
+	static uint64_t GetFramesCopied();
+
+	/**
+	 * Number of bytes copied from the rings into frame buffers since startup
+	 */
+	static uint64_t GetBytesCopied();
+
+	/**
+	 * Number of pooled buffers that had to be copied to the heap by moveToHeap(). Should
+	 * stay 0 as the PacketHandler copies MEPs and CREAM frames to the heap directly
+	 */
+	static uint64_t GetBuffersMovedToHeap();
+
+private:
+	struct SlotTrailer {
+		FrameBufferPool* pool;
+		std::atomic<uint32_t> refCount;
+	};
+
+	/*
+	 * Pools not yet created by their queue's thread are nullptr
+	 */
+	static const uint MAX_NUMBER_OF_POOLS = 128;
+	static std::atomic<FrameBufferPool*> pools_[MAX_NUMBER_OF_POOLS];
+	static std::atomic<uint> numberOfPools_;
+	static uint BuffersPerQueue_;
+
+	const uint bufferSize_;
+	const uint slotSize_;
+
+	/*
+	 * [slots_, slotsEnd_) contains all slots of this pool
+	 */
+	char* const slots_;
+	char* const slotsEnd_;
+
+	tbb::concurrent_queue<char*> freeBuffers_;
+
+	/*
+	 * Only written by the receiving thread
+	 */
+	std::atomic<uint64_t> allocations_;
+	std::atomic<uint64_t> framesCopied_;
+	std::atomic<uint64_t> bytesCopied_;
+
+	/*
+	 * Written by all threads moving frames of this pool to the heap
+	 */
+	std::atomic<uint64_t> movedToHeap_;
+
+	static void copyToHeap(DataContainer& container);
+
+	static inline SlotTrailer* getTrailer(char* buffer) {
+		/*
+		 * All pools use the same buffer size (see initialize())
+		 */
+		return reinterpret_cast<SlotTrailer*>(buffer + BufferSize_);
+	}
+
+	static uint BufferSize_;
+};
+
+} /* namespace na62 */
+
+#endif /* FRAMEBUFFERPOOL_H_ */
@@ -0,0 +1,366 @@
+/*
+ * FrameValidator.cpp
+ *
+ *  Created on: Oct 16, 2026
+ *      Author: Jonas Kunze (kunze.jonas@gmail.com)
+ */
+
+#include "FrameValidator.h"
+
+#include <immintrin.h>
+#include <net/ethernet.h>
+#include <netinet/in.h>
+#include <netinet/ip.h>
+#include <netinet/udp.h>
+#include <algorithm>
+#include <cstring>
+
+#include <options/Logging.h>
+#include <structs/Network.h>
+
+namespace na62 {
+
+/*
+ * ether_type (network byte order as read from memory), IP version/IHL and protocol of a
+ * valid frame packed into one word
+ */
+#define EXPECTED_TYPE_AND_PROTOCOL (0x0008 << 16 | 0x45 << 8 | IPPROTO_UDP)
+
+uint32_t FrameValidator::myIP_;
+bool FrameValidator::checkChecksums_;
+uint FrameValidator::groupSize_;
+uint32_t (*FrameValidator::checkHeaders_)(const DataContainer* frames,
+		uint32_t myIP);
+uint16_t (*FrameValidator::checksum_)(const char* data, uint length,
+		uint32_t initialSum);
+
+std::atomic<uint64_t> FrameValidator::framesValidated_(0);
+std::atomic<uint64_t> FrameValidator::headerErrors_(0);
+std::atomic<uint64_t> FrameValidator::checksumErrors_(0);
+
+/*
+ * Header fields of one frame as signed words so that all checks are comparisons for
+ * equality or being non-negative. Lengths too small for the headers they describe are
+ * stored as negative slack
+ */
+struct HeaderWords {
+	int32_t typeAndProtocol;
+	int32_t dstIP;
+	int32_t ipSlack; // Bytes of the frame behind the IP datagram
+	int32_t udpSlack; // Bytes of the frame behind the UDP datagram
+};
+
+static inline void loadHeaderWords(const DataContainer& frame,
+		HeaderWords& words) {
+	if (frame.length < sizeof(UDP_HDR)) {
+		words.typeAndProtocol = 0;
+		words.dstIP = 0;
+		words.ipSlack = -1;
+		words.udpSlack = -1;
+		return;
+	}
+
+	const UDP_HDR* hdr = (const UDP_HDR*) frame.data;
+	const uint8_t versionAndIHL = *((const uint8_t*) &hdr->ip);
+	words.typeAndProtocol = (uint32_t) hdr->eth.ether_type << 16
+			| versionAndIHL << 8 | hdr->ip.protocol;
+	words.dstIP = hdr->ip.daddr;
+
+	const uint16_t ipLength = ntohs(hdr->ip.tot_len);
+	words.ipSlack =
+			ipLength < sizeof(iphdr) ?
+					-1 :
+					(int32_t) frame.length - sizeof(ether_header) - ipLength;
+
+	/*
+	 * The UDP header of fragments is checked after the reassembly
+	 */
+	const uint16_t udpLength = ntohs(hdr->udp.len);
+	if (hdr->isFragment()) {
+		words.udpSlack = 0;
+	} else if (udpLength < sizeof(udphdr)
+			|| ipLength != sizeof(iphdr) + udpLength) {
+		words.udpSlack = -1;
+	} else {
+		words.udpSlack = (int32_t) frame.length - sizeof(ether_header)
+				- sizeof(iphdr) - udpLength;
+	}
+}
+
+static inline uint64_t foldChecksum(uint64_t sum) {
+	while (sum >> 16) {
+		sum = (sum & 0xFFFF) + (sum >> 16);
+	}
+	return sum;
+}
+
+static uint64_t sumWordsScalar(const char* data, uint length) {
+	uint64_t sum = 0;
+	uint16_t word;
+	for (; length >= 2; data += 2, length -= 2) {
+		memcpy(&word, data, 2);
+		sum += word;
+	}
+	if (length != 0) {
+		/*
+		 * An odd last byte is padded with zero
+		 */
+		sum += (uint8_t) *data;
+	}
+	return sum;
+}
+
+/*
+ * Scalar implementations
+ */
+static uint32_t checkHeadersScalar(const DataContainer* frames, uint32_t myIP) {
+	HeaderWords words;
+	loadHeaderWords(frames[0], words);
+	return words.typeAndProtocol == EXPECTED_TYPE_AND_PROTOCOL
+			&& words.dstIP == (int32_t) myIP && words.ipSlack >= 0
+			&& words.udpSlack >= 0;
+}
+
+static uint16_t checksumScalar(const char* data, uint length,
+		uint32_t initialSum) {
+	return foldChecksum(sumWordsScalar(data, length) + initialSum);
+}
+
+/*
+ * SSE4.2 implementations
+ */
+__attribute__((target("sse4.2"))) static uint32_t checkHeadersSSE(
+		const DataContainer* frames, uint32_t myIP) {
+	HeaderWords words[4];
+	for (uint i = 0; i != 4; i++) {
+		loadHeaderWords(frames[i], words[i]);
+	}
+	const __m128i typeAndProtocol = _mm_set_epi32(words[3].typeAndProtocol,
+			words[2].typeAndProtocol, words[1].typeAndProtocol,
+			words[0].typeAndProtocol);
+	const __m128i dstIP = _mm_set_epi32(words[3].dstIP, words[2].dstIP,
+			words[1].dstIP, words[0].dstIP);
+	const __m128i ipSlack = _mm_set_epi32(words[3].ipSlack, words[2].ipSlack,
+			words[1].ipSlack, words[0].ipSlack);
+	const __m128i udpSlack = _mm_set_epi32(words[3].udpSlack,
+			words[2].udpSlack, words[1].udpSlack, words[0].udpSlack);
+
+	const __m128i minusOne = _mm_set1_epi32(-1);
+	__m128i ok = _mm_cmpeq_epi32(typeAndProtocol,
+			_mm_set1_epi32(EXPECTED_TYPE_AND_PROTOCOL));
+	ok = _mm_and_si128(ok, _mm_cmpeq_epi32(dstIP, _mm_set1_epi32(myIP)));
+	ok = _mm_and_si128(ok, _mm_cmpgt_epi32(ipSlack, minusOne));
+	ok = _mm_and_si128(ok, _mm_cmpgt_epi32(udpSlack, minusOne));
+	return _mm_movemask_ps(_mm_castsi128_ps(ok));
+}
+
+__attribute__((target("sse4.2"))) static uint16_t checksumSSE(
+		const char* data, uint length, uint32_t initialSum) {
+	const __m128i zero = _mm_setzero_si128();
+	__m128i sum = zero;
+	/*
+	 * Every 32 bit lane gets at most 2x0xFFFF per iteration -> no overflow for jumbo frames
+	 */
+	for (; length >= 16; data += 16, length -= 16) {
+		const __m128i words = _mm_loadu_si128((const __m128i*) data);
+		sum = _mm_add_epi32(sum, _mm_unpacklo_epi16(words, zero));
+		sum = _mm_add_epi32(sum, _mm_unpackhi_epi16(words, zero));
+	}
+	uint32_t lanes[4];
+	_mm_storeu_si128((__m128i*) lanes, sum);
+	const uint64_t total = (uint64_t) lanes[0] + lanes[1] + lanes[2] + lanes[3];
+	return foldChecksum(total + sumWordsScalar(data, length) + initialSum);
+}
+
+/*
+ * AVX2 implementations
+ */
+__attribute__((target("avx2"))) static uint32_t checkHeadersAVX2(
+		const DataContainer* frames, uint32_t myIP) {
+	HeaderWords words[8];
+	for (uint i = 0; i != 8; i++) {
+		loadHeaderWords(frames[i], words[i]);
+	}
+
+	/*
+	 * Transpose the header words: one vector per field
+	 */
+	const __m256i index = _mm256_setr_epi32(0, 4, 8, 12, 16, 20, 24, 28);
+	const int* base = (const int*) words;
+	const __m256i typeAndProtocol = _mm256_i32gather_epi32(base, index, 4);
+	const __m256i dstIP = _mm256_i32gather_epi32(base + 1, index, 4);
+	const __m256i ipSlack = _mm256_i32gather_epi32(base + 2, index, 4);
+	const __m256i udpSlack = _mm256_i32gather_epi32(base + 3, index, 4);
+
+	const __m256i minusOne = _mm256_set1_epi32(-1);
+	__m256i ok = _mm256_cmpeq_epi32(typeAndProtocol,
+			_mm256_set1_epi32(EXPECTED_TYPE_AND_PROTOCOL));
+	ok = _mm256_and_si256(ok,
+			_mm256_cmpeq_epi32(dstIP, _mm256_set1_epi32(myIP)));
+	ok = _mm256_and_si256(ok, _mm256_cmpgt_epi32(ipSlack, minusOne));
+	ok = _mm256_and_si256(ok, _mm256_cmpgt_epi32(udpSlack, minusOne));
+	return _mm256_movemask_ps(_mm256_castsi256_ps(ok));
+}
+
+__attribute__((target("avx2"))) static uint16_t checksumAVX2(
+		const char* data, uint length, uint32_t initialSum) {
+	const __m256i zero = _mm256_setzero_si256();
+	__m256i sum = zero;
+	for (; length >= 32; data += 32, length -= 32) {
+		const __m256i words = _mm256_loadu_si256((const __m256i*) data);
+		sum = _mm256_add_epi32(sum, _mm256_unpacklo_epi16(words, zero));
+		sum = _mm256_add_epi32(sum, _mm256_unpackhi_epi16(words, zero));
+	}
+	uint32_t lanes[8];
+	_mm256_storeu_si256((__m256i*) lanes, sum);
+	uint64_t total = 0;
+	for (uint32_t lane : lanes) {
+		total += lane;
+	}
+	return foldChecksum(total + sumWordsScalar(data, length) + initialSum);
+}
+
+void FrameValidator::initialize(uint32_t myIP, bool checkChecksums) {
+	myIP_ = myIP;
+	checkChecksums_ = checkChecksums;
+
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2")) {
+		groupSize_ = 8;
+		checkHeaders_ = checkHeadersAVX2;
+		checksum_ = checksumAVX2;
+	} else if (__builtin_cpu_supports("sse4.2")) {
+		groupSize_ = 4;
+		checkHeaders_ = checkHeadersSSE;
+		checksum_ = checksumSSE;
+	} else {
+		groupSize_ = 1;
+		checkHeaders_ = checkHeadersScalar;
+		checksum_ = checksumScalar;
+	}
+
+	LOG_INFO<< "Validating frame headers in groups of " << groupSize_
+	<< (checkChecksums_ ? " including" : " without") << " checksums" << ENDL;
+}
+
+bool FrameValidator::checkHeader(const DataContainer& frame, uint32_t myIP) {
+	return checkHeadersScalar(&frame, myIP);
+}
+
+bool FrameValidator::checkChecksums(const DataContainer& frame) {
+	const UDP_HDR* hdr = (const UDP_HDR*) frame.data;
+
+	/*
+	 * The ones' complement sum of a correct header including its checksum is 0xFFFF
+	 */
+	if (checksum_((const char*) &hdr->ip, sizeof(iphdr), 0) != 0xFFFF) {
+		checksumErrors_.fetch_add(1, std::memory_order_relaxed);
+		return false;
+	}
+
+	if (hdr->isFragment()) {
+		return true;
+	}
+	return isUDPChecksumValid(frame);
+}
+
+bool FrameValidator::isReassembledDatagramValid(const DataContainer& frame) {
+	const UDP_HDR* hdr = (const UDP_HDR*) frame.data;
+	const uint16_t udpLength = ntohs(hdr->udp.len);
+	if (frame.length < sizeof(UDP_HDR) || udpLength < sizeof(udphdr)
+			|| sizeof(ether_header) + sizeof(iphdr) + udpLength > frame.length) {
+		headerErrors_.fetch_add(1, std::memory_order_relaxed);
+		return false;
+	}
+	return !checkChecksums_ || isUDPChecksumValid(frame);
+}
+
+bool FrameValidator::isUDPChecksumValid(const DataContainer& frame) {
+	const UDP_HDR* hdr = (const UDP_HDR*) frame.data;
+	if (hdr->udp.check == 0) {
+		return true;
+	}
+	const uint16_t udpLength = ntohs(hdr->udp.len);
+
+	/*
+	 * Pseudo header: source and destination IP, protocol and UDP length
+	 */
+	const uint32_t pseudoHeaderSum = (hdr->ip.saddr & 0xFFFF)
+			+ (hdr->ip.saddr >> 16) + (hdr->ip.daddr & 0xFFFF)
+			+ (hdr->ip.daddr >> 16) + htons(IPPROTO_UDP) + hdr->udp.len;
+
+	if (checksum_((const char*) &hdr->udp, udpLength, pseudoHeaderSum)
+			!= 0xFFFF) {
+		checksumErrors_.fetch_add(1, std::memory_order_relaxed);
+		return false;
+	}
+	return true;
+}
+
+void FrameValidator::validate(const DataContainer* frames, uint numberOfFrames,
+		uint64_t* passBitmap) {
+	for (uint word = 0; word != (numberOfFrames + 63) / 64; word++) {
+		passBitmap[word] = 0;
+	}
+
+	uint frame = 0;
+	if (groupSize_ != 1) {
+		for (; frame + groupSize_ <= numberOfFrames; frame += groupSize_) {
+			const uint64_t passed = checkHeaders_(frames + frame, myIP_);
+			/*
+			 * groupSize_ divides 64 so the group never spans two words
+			 */
+			passBitmap[frame / 64] |= passed << (frame % 64);
+		}
+	}
+	for (; frame != numberOfFrames; frame++) {
+		if (checkHeader(frames[frame], myIP_)) {
+			passBitmap[frame / 64] |= 1ull << (frame % 64);
+		}
+	}
+
+	/*
+	 * ARP and other non UDP frames fail the checks but are no errors
+	 */
+	uint errors = 0;
+	for (uint word = 0; word != (numberOfFrames + 63) / 64; word++) {
+		const uint framesInWord = std::min(64u, numberOfFrames - word * 64);
+		uint64_t failed = ~passBitmap[word]
+				& (framesInWord == 64 ? ~0ull : (1ull << framesInWord) - 1);
+		while (failed != 0) {
+			const uint bit = __builtin_ctzll(failed);
+			failed &= failed - 1;
+			errors += !isControlFrame(frames[word * 64 + bit]);
+		}
+	}
+	framesValidated_.fetch_add(numberOfFrames, std::memory_order_relaxed);
+	headerErrors_.fetch_add(errors, std::memory_order_relaxed);
+
+	if (!checkChecksums_) {
+		return;
+	}
+
+	for (uint word = 0; word != (numberOfFrames + 63) / 64; word++) {
+		uint64_t bits = passBitmap[word];
+		while (bits != 0) {
+			const uint bit = __builtin_ctzll(bits);
+			bits &= bits - 1;
+			if (!checkChecksums(frames[word * 64 + bit])) {
+				passBitmap[word] &= ~(1ull << bit);
+			}
+		}
+	}
+}
+
+bool FrameValidator::isValid(const DataContainer& frame) {
+	framesValidated_.fetch_add(1, std::memory_order_relaxed);
+	if (!checkHeader(frame, myIP_)) {
+		if (!isControlFrame(frame)) {
+			headerErrors_.fetch_add(1, std::memory_order_relaxed);
+		}
+		return false;
+	}
+	return !checkChecksums_ || checkChecksums(frame);
+}
+
+} /* namespace na62 */
@@ -0,0 +1,131 @@
+/*
+ * FrameValidator.h
+ *
+ *  Created on: Oct 16, 2026
+ *      Author: Jonas Kunze (kunze.jonas@gmail.com)
+ */
+
+#pragma once
+#ifndef FRAMEVALIDATOR_H_
+#define FRAMEVALIDATOR_H_
+
+#include <net/ethernet.h>
+#include <netinet/in.h>
+#include <netinet/ip.h>
+#include <sys/types.h>
+#include <atomic>
+#include <cstdint>
+
+#include <socket/EthernetUtils.h>
+#include <structs/Network.h>
+
+namespace na62 {
+
+/*
+ * Checks the ethernet, IP and UDP headers of a batch of received frames in one pass:
+ *
+ * - ether type IPv4, IP header without options, protocol UDP
+ * - destination IP is MyIP
+ * - ip.tot_len and udp.len fit into the frame (smaller is ok because of ethernet padding)
+ *   and are large enough for their headers, ip.tot_len == sizeof(iphdr) + udp.len
+ * - optionally the IP header and UDP checksums (a UDP checksum of 0 means none has been sent)
+ *
+ * The headers of 8 (AVX2) or 4 (SSE4.2) frames are compared at once and the checksums are
+ * summed up with SIMD instructions. Without these extensions a scalar implementation is used.
+ * IP fragments are only checked up to the IP header, their UDP header is checked after the
+ * reassembly. ARP and other non UDP frames are not valid but not counted as header errors.
+ */
+class FrameValidator {
+public:
+	/**
+	 * Chooses the implementation supported by the CPU
+	 *
+	 * @param myIP IP address all accepted frames must be sent to
+	 */
+	static void initialize(uint32_t myIP, bool checkChecksums);
+
+	/**
+	 * Sets bit i%64 of passBitmap[i/64] if frames[i] is valid and resets it otherwise
+	 *
+	 * @param passBitmap Must have at least (numberOfFrames+63)/64 entries
+	 */
+	static void validate(const DataContainer* frames, uint numberOfFrames,
+			uint64_t* passBitmap);
+
+	/**
+	 * Validates a single frame with the scalar implementation
+	 */
+	static bool isValid(const DataContainer& frame);
+
+	/**
+	 * Checks the UDP header and, if enabled, the UDP checksum of a reassembled datagram
+	 */
+	static bool isReassembledDatagramValid(const DataContainer& frame);
+
+	/**
+	 * @return true for frames that are no UDP/IPv4 frames (e.g. ARP)
+	 */
+	static inline bool isControlFrame(const DataContainer& frame) {
+		if (frame.length < sizeof(ether_header)) {
+			return false;
+		}
+		const UDP_HDR* hdr = (const UDP_HDR*) frame.data;
+		if (hdr->eth.ether_type != 0x0008/*ETHERTYPE_IP*/) {
+			return true;
+		}
+		return frame.length >= sizeof(ether_header) + sizeof(iphdr)
+				&& hdr->ip.protocol != IPPROTO_UDP;
+	}
+
+	static inline bool IsCheckingChecksums() {
+		return checkChecksums_;
+	}
+
+	static inline uint64_t GetFramesValidated() {
+		return framesValidated_;
+	}
+
+	/*
+	 * Number of frames failing the header or length checks
+	 */
+	static inline uint64_t GetHeaderErrors() {
+		return headerErrors_;
+	}
+
+	static inline uint64_t GetChecksumErrors() {
+		return checksumErrors_;
+	}
+
+private:
+	static uint32_t myIP_;
+	static bool checkChecksums_;
+
+	/*
+	 * Number of frames checked at once by the chosen header check
+	 */
+	static uint groupSize_;
+
+	/*
+	 * Returns a bitmask with bit i set if the headers of frames[i] are ok
+	 */
+	static uint32_t (*checkHeaders_)(const DataContainer* frames,
+			uint32_t myIP);
+
+	/*
+	 * Ones' complement sum of length bytes folded to 16 bits (little endian words)
+	 */
+	static uint16_t (*checksum_)(const char* data, uint length,
+			uint32_t initialSum);
+
+	static std::atomic<uint64_t> framesValidated_;
+	static std::atomic<uint64_t> headerErrors_;
+	static std::atomic<uint64_t> checksumErrors_;
+
+	static bool checkHeader(const DataContainer& frame, uint32_t myIP);
+	static bool checkChecksums(const DataContainer& frame);
+	static bool isUDPChecksumValid(const DataContainer& frame);
+};
+
+} /* namespace na62 */
+
+#endif /* FRAMEVALIDATOR_H_ */
@@ -34,9 +34,12 @@
 #include "../eventBuilding/L1Builder.h"
 #include "../eventBuilding/L2Builder.h"
 #include "../options/MyOptions.h"
+#include "../benchmark/ThroughputBenchmark.h"
 #include "../straws/StrawReceiver.h"
 #include "PacketHandler.h"
 #include "FragmentStore.h"
+#include "FrameBufferPool.h"
+#include "PcapReplayer.h"
 
 namespace na62 {
 
@@ -47,8 +50,11 @@ uint32_t HandleFrameTask::MyIP;
 
 std::atomic<uint> HandleFrameTask::queuedTasksNum_;
 uint HandleFrameTask::highestSourceNum_;
-std::atomic<uint64_t>* HandleFrameTask::MEPsReceivedBySourceNum_;
-std::atomic<uint64_t>* HandleFrameTask::BytesReceivedBySourceNum_;
+
+uint8_t HandleFrameTask::sourceNumBySourceID_[0x100];
+std::bitset<0x10000> HandleFrameTask::activeCREAMs_;
+std::atomic<uint64_t> HandleFrameTask::unknownSourceIDFrames_[0x100];
+std::atomic<uint64_t>* HandleFrameTask::unknownCREAMFrames_;
 
 HandleFrameTask::HandleFrameTask(std::vector<DataContainer>&& _containers, uint burstID) :
 		containers_(std::move(_containers)), burstID_(burstID) {
@@ -63,20 +69,49 @@ void HandleFrameTask::initialize() {
 	L0_Port = Options::GetInt(OPTION_L0_RECEIVER_PORT);
 	CREAM_Port = Options::GetInt(OPTION_CREAM_RECEIVER_PORT);
 	STRAW_PORT = Options::GetInt(OPTION_STRAW_PORT);
-	MyIP = NetworkHandler::GetMyIP();
+	if (PcapReplayer::IsActive()) {
+		MyIP = PcapReplayer::GetMyIP();
+	} else if (ThroughputBenchmark::IsEnabled()) {
+		MyIP = ThroughputBenchmark::GetMyIP();
+	} else {
+		MyIP = NetworkHandler::GetMyIP();
+	}
+
+	FrameValidator::initialize(MyIP, Options::GetBool(OPTION_CHECK_CHECKSUMS));
+	FragmentStore::initialize();
 
 	/*
 	 * All L0 data sources and LKr:
 	 */
 	highestSourceNum_ = SourceIDManager::NUMBER_OF_L0_DATA_SOURCES;
 
-	MEPsReceivedBySourceNum_ = new std::atomic<uint64_t>[highestSourceNum_ + 1];
-	BytesReceivedBySourceNum_ =
-			new std::atomic<uint64_t>[highestSourceNum_ + 1];
+	/*
+	 * Lookup tables for the source IDs and CREAMs
+	 */
+	for (uint sourceID = 0; sourceID != 0x100; sourceID++) {
+		sourceNumBySourceID_[sourceID] = UNKNOWN_SOURCE_NUM;
+		unknownSourceIDFrames_[sourceID] = 0;
+	}
+	for (uint sourceNum = 0;
+			sourceNum != SourceIDManager::NUMBER_OF_L0_DATA_SOURCES;
+			sourceNum++) {
+		sourceNumBySourceID_[SourceIDManager::SourceNumToID(sourceNum)] =
+				sourceNum;
+	}
 
-	for (uint i = 0; i != highestSourceNum_ + 1; i++) {
-		MEPsReceivedBySourceNum_[i] = 0;
-		BytesReceivedBySourceNum_[i] = 0;
+	std::vector<std::pair<int, int> > inactiveCREAMs =
+			Options::GetIntPairList(OPTION_INACTIVE_CREAM_CRATES);
+	for (auto cream : Options::GetIntPairList(OPTION_CREAM_CRATES)) {
+		if (std::find(inactiveCREAMs.begin(), inactiveCREAMs.end(), cream)
+				== inactiveCREAMs.end()) {
+			activeCREAMs_[(cream.first & 0xFF) << 8 | (cream.second & 0xFF)] =
+					true;
+		}
+	}
+
+	unknownCREAMFrames_ = new std::atomic<uint64_t>[0x10000];
+	for (uint i = 0; i != 0x10000; i++) {
+		unknownCREAMFrames_[i] = 0;
 	}
 }
 
@@ -84,7 +119,7 @@ void HandleFrameTask::processARPRequest(struct ARP_HDR* arp) {
 	/*
 	 * Look for ARP requests asking for my IP
 	 */
-	if (arp->targetIPAddr == NetworkHandler::GetMyIP()) { // This is asking for me
+	if (arp->targetIPAddr == MyIP) { // This is asking for me
 		struct DataContainer responseArp = EthernetUtils::GenerateARPv4(
 				NetworkHandler::GetMyMac().data(), arp->sourceHardwAddr,
 				NetworkHandler::GetMyIP(), arp->sourceIPAddr,
@@ -95,156 +130,178 @@ void HandleFrameTask::processARPRequest(struct ARP_HDR* arp) {
 
 tbb::task* HandleFrameTask::execute() {
 	for (DataContainer& container : containers_) {
-		processFrame(std::move(container));
+		processFrame(std::move(container), burstID_);
+		L1Builder::flushL1BatchIfExpired();
 	}
+	L1Builder::flushL1Batch();
 	return nullptr;
 }
 
-void HandleFrameTask::processFrame(DataContainer&& container) {
+void HandleFrameTask::processFrame(DataContainer&& container, uint burstID) {
+	const FrameType type = classifyFrame(container);
+	processClassifiedFrame(std::move(container), type, burstID);
+}
+
+void HandleFrameTask::processFragment(DataContainer&& container,
+		uint burstID) {
+	container = FragmentStore::addFragment(std::move(container), burstID);
+	if (container.data == nullptr) {
+		return;
+	}
+
+	/*
+	 * The UDP header and checksum can only be checked for the whole datagram
+	 */
+	if (!FrameValidator::isReassembledDatagramValid(container)) {
+		FrameBufferPool::freeFrame(container);
+		return;
+	}
+	processClassifiedFrame(std::move(container),
+			classifyPort(ntohs(((struct UDP_HDR*) container.data)->udp.dest)),
+			burstID);
+}
+
+void HandleFrameTask::processClassifiedFrame(DataContainer&& container,
+		FrameType type, uint burstID) {
+	switch (type) {
+	case IP_FRAGMENT:
+		processFragment(std::move(container), burstID);
+		break;
+	case L0_FRAME:
+		processL0Frame(std::move(container), burstID);
+		break;
+	case CREAM_FRAME:
+		processCreamFrame(std::move(container), burstID);
+		break;
+	case STRAW_FRAME:
+		processStrawFrame(std::move(container), burstID);
+		break;
+	case CONTROL_FRAME:
+		processControlFrame(std::move(container));
+		break;
+	default:
+		FrameBufferPool::freeFrame(container);
+	}
+}
+
+void HandleFrameTask::processL0Frame(DataContainer&& container, uint burstID) {
 	try {
 		struct UDP_HDR* hdr = (struct UDP_HDR*) container.data;
-		const uint16_t etherType = /*ntohs*/(hdr->eth.ether_type);
-		const uint8_t ipProto = hdr->ip.protocol;
-		uint16_t destPort = ntohs(hdr->udp.dest);
-		const uint32_t dstIP = hdr->ip.daddr;
+		const char * UDPPayload = container.data + sizeof(struct UDP_HDR);
+		const uint16_t UdpDataLength = ntohs(hdr->udp.len)
+				- sizeof(struct udphdr);
 
 		/*
-		 * Check if we received an ARP request
+		 * Drop MEPs of unknown sources before the MEP is created
 		 */
-		if (etherType != 0x0008/*ETHERTYPE_IP*/|| ipProto != IPPROTO_UDP) {
-			if (etherType == 0x0608/*ETHERTYPE_ARP*/) {
-				// this will delete the data
-				processARPRequest((struct ARP_HDR*) container.data);
-				return;
-			} else {
-				// Just ignore this frame as it's neither IP nor ARP
-				container.free();
-				return;
-			}
+		if (UdpDataLength < sizeof(l0::MEP_HDR)) {
+			FrameBufferPool::freeFrame(container);
+			return;
 		}
-
-		/*
-		 * Check checksum errors
-		 */
-		if (!checkFrame(hdr, container.length)) {
-			container.free();
+		const uint8_t sourceID = ((const l0::MEP_HDR*) UDPPayload)->sourceID;
+		const uint8_t sourceNum = sourceNumBySourceID_[sourceID];
+		if (sourceNum == UNKNOWN_SOURCE_NUM) {
+			unknownSourceIDFrames_[sourceID].fetch_add(1,
+					std::memory_order_relaxed);
+			FrameBufferPool::freeFrame(container);
 			return;
 		}
 
 		/*
-		 * Check if we are really the destination of the IP datagram
+		 * L0 Data
+		 * Length is hdr->ip.tot_len-sizeof(struct udphdr) and not container.length because of ethernet padding bytes!
+		 *
+		 * The MEP deletes the frame as soon as all its fragments are deleted
 		 */
-		if (MyIP != dstIP) {
-			container.free();
-			return;
-		}
-
-		if (hdr->isFragment()) {
-			container = FragmentStore::addFragment(std::move(container));
-			if (container.data == nullptr) {
-				return;
-			}
-			hdr = (struct UDP_HDR*) container.data;
-			destPort = ntohs(hdr->udp.dest);
+		FrameBufferPool::moveToHeap(container);
+		l0::MEP* mep = new l0::MEP(UDPPayload, UdpDataLength, container.data);
+
+		ThreadCounters::increment(
+				ThreadCounters::MEPS_RECEIVED_BY_SOURCE_NUM + sourceNum);
+		ThreadCounters::add(
+				ThreadCounters::BYTES_RECEIVED_BY_SOURCE_NUM + sourceNum,
+				container.length);
+
+		for (int i = mep->getNumberOfEvents() - 1; i >= 0; i--) {
+			// Add every fragment
+			L1Builder::buildEvent(mep->getFragment(i), burstID);
 		}
+	} catch (UnknownSourceIDFound const& e) {
+		FrameBufferPool::freeFrame(container);
+	} catch (NA62Error const& e) {
+		FrameBufferPool::freeFrame(container);
+	}
+}
 
+void HandleFrameTask::processCreamFrame(DataContainer&& container, uint) {
+	try {
+		struct UDP_HDR* hdr = (struct UDP_HDR*) container.data;
 		const char * UDPPayload = container.data + sizeof(struct UDP_HDR);
-		const uint16_t & UdpDataLength = ntohs(hdr->udp.len)
+		const uint16_t UdpDataLength = ntohs(hdr->udp.len)
 				- sizeof(struct udphdr);
 
 		/*
-		 *  Now let's see what's insight the packet
+		 * Drop fragments of inactive or unknown CREAMs before the fragment is created
 		 */
-		if (destPort == L0_Port) { ////////////////////////////////////////////////// L0 Data //////////////////////////////////////////////////
-			/*
-			 * L0 Data
-			 * Length is hdr->ip.tot_len-sizeof(struct udphdr) and not container.length because of ethernet padding bytes!
-			 */
-			l0::MEP* mep = new l0::MEP(UDPPayload, UdpDataLength,
-					container.data);
-
-			uint sourceNum = SourceIDManager::SourceIDToNum(mep->getSourceID());
-
-			MEPsReceivedBySourceNum_[sourceNum].fetch_add(1,
-					std::memory_order_relaxed);
-			BytesReceivedBySourceNum_[sourceNum].fetch_add(container.length,
+		if (UdpDataLength < sizeof(cream::LKR_EVENT_RAW_HDR)) {
+			FrameBufferPool::freeFrame(container);
+			return;
+		}
+		const cream::LKR_EVENT_RAW_HDR* lkrHdr =
+				(const cream::LKR_EVENT_RAW_HDR*) UDPPayload;
+		const uint creamKey = lkrHdr->crateID << 8 | lkrHdr->creamID;
+		if (!activeCREAMs_[creamKey]) {
+			unknownCREAMFrames_[creamKey].fetch_add(1,
 					std::memory_order_relaxed);
+			FrameBufferPool::freeFrame(container);
+			return;
+		}
 
-			for (int i = mep->getNumberOfEvents() - 1; i >= 0; i--) {
-				// Add every fragment
-				L1Builder::buildEvent(mep->getFragment(i), burstID_);
-			}
-		} else if (destPort == CREAM_Port) { ////////////////////////////////////////////////// CREAM Data //////////////////////////////////////////////////
-			cream::LkrFragment* fragment = new cream::LkrFragment(UDPPayload,
-					UdpDataLength, container.data);
+		FrameBufferPool::moveToHeap(container);
+		cream::LkrFragment* fragment = new cream::LkrFragment(UDPPayload,
+				UdpDataLength, container.data);
 
-			MEPsReceivedBySourceNum_[highestSourceNum_].fetch_add(1,
-					std::memory_order_relaxed);
+		ThreadCounters::increment(
+				ThreadCounters::MEPS_RECEIVED_BY_SOURCE_NUM + highestSourceNum_);
+		ThreadCounters::add(
+				ThreadCounters::BYTES_RECEIVED_BY_SOURCE_NUM + highestSourceNum_,
+				container.length);
 
-			BytesReceivedBySourceNum_[highestSourceNum_].fetch_add(
-					container.length, std::memory_order_relaxed);
-
-			L2Builder::buildEvent(fragment);
-		} else if (destPort == STRAW_PORT) { ////////////////////////////////////////////////// STRAW Data //////////////////////////////////////////////////
-			StrawReceiver::processFrame(std::move(container), burstID_);
-		} else {
-			/*
-			 * Packet with unknown UDP port received
-			 */
-			LOG_ERROR<<"Packet with unknown UDP port received: " << destPort << ENDL;
-			container.free();
-		}
-	} catch (UnknownSourceIDFound const& e) {
-		container.free();
+		L2Builder::buildEvent(fragment);
 	} catch (UnknownCREAMSourceIDFound const&e) {
-		container.free();
+		FrameBufferPool::freeFrame(container);
 	} catch (NA62Error const& e) {
-		container.free();
+		FrameBufferPool::freeFrame(container);
 	}
 }
 
-bool HandleFrameTask::checkFrame(struct UDP_HDR* hdr, uint16_t length) {
-	/*
-	 * Check IP-Header
-	 */
-	//				if (!EthernetUtils::CheckData((char*) &hdr->ip, sizeof(iphdr))) {
-	//					LOG_ERROR << "Packet with broken IP-checksum received");
-	//					container.free();
-	//					continue;
-	//				}
-	if (hdr->isFragment()) {
-		return true;
+void HandleFrameTask::processStrawFrame(DataContainer&& container,
+		uint burstID) {
+	try {
+		StrawReceiver::processFrame(std::move(container), burstID);
+	} catch (NA62Error const& e) {
+		FrameBufferPool::freeFrame(container);
 	}
+}
 
-	if (ntohs(hdr->ip.tot_len) + sizeof(ether_header) != length) {
+void HandleFrameTask::processControlFrame(DataContainer&& container) {
+	struct UDP_HDR* hdr = (struct UDP_HDR*) container.data;
+	if (hdr->eth.ether_type == 0x0608/*ETHERTYPE_ARP*/) {
 		/*
-		 * Does not need to be equal because of ethernet padding
+		 * Without a NIC there is nobody to answer to
 		 */
-		if (ntohs(hdr->ip.tot_len) + sizeof(ether_header) > length) {
-			LOG_ERROR <<
-			"Received IP-Packet with less bytes than ip.tot_len field! " <<
-			(ntohs(hdr->ip.tot_len) + sizeof(ether_header) ) << ":"<<length << ENDL;
-			return false;
+		if (!PcapReplayer::IsActive()) {
+			processARPRequest((struct ARP_HDR*) container.data);
 		}
+	} else if (hdr->eth.ether_type == 0x0008/*ETHERTYPE_IP*/
+	&& hdr->ip.protocol == IPPROTO_UDP) {
+		/*
+		 * Packet with unknown UDP port received
+		 */
+		LOG_ERROR<<"Packet with unknown UDP port received: " << ntohs(hdr->udp.dest) << ENDL;
 	}
-
-	/*
-	 * Does not need to be equal because of ethernet padding
-	 */
-	if (ntohs(hdr->udp.len) + sizeof(ether_header) + sizeof(iphdr) > length) {
-		LOG_ERROR<<"Received UDP-Packet with less bytes than udp.len field! "<<(ntohs(hdr->udp.len) + sizeof(ether_header) + sizeof(iphdr)) <<":"<<length;
-		return false;
-	}
-
-	//				/*
-	//				 * Check UDP checksum
-	//				 */
-	//				if (!EthernetUtils::CheckUDP(hdr, (const char *) (&hdr->udp) + sizeof(struct udphdr), ntohs(hdr->udp.len) - sizeof(struct udphdr))) {
-	//					LOG_ERROR << "Packet with broken UDP-checksum received" ) << ENDL;
-	//					container.free();
-	//					continue;
-	//				}
-	return true;
+	// Just ignore all other frames as they are neither IP nor ARP
+	FrameBufferPool::freeFrame(container);
 }
 
 }
@@ -9,26 +9,44 @@
 #define HANDLEFRAMETASK_H_
 
 #include <tbb/task.h>
+#include <netinet/in.h>
+#include <bitset>
 #include <cstdint>
 #include <atomic>
 
 #include <socket/EthernetUtils.h>
+#include <structs/Network.h>
+
+#include "../monitoring/ThreadCounters.h"
+#include "FrameValidator.h"
 
 namespace na62 {
 
+template<void (*PROCESS)(DataContainer&&, uint)>
+class FrameBatchTask;
+
 class HandleFrameTask: public tbb::task {
+public:
+	/*
+	 * Types of frames the PacketHandler sorts the received frames into
+	 */
+	enum FrameType {
+		L0_FRAME = 0,
+		CREAM_FRAME = 1,
+		STRAW_FRAME = 2,
+		IP_FRAGMENT = 3,
+		CONTROL_FRAME = 4, // ARP, non IP and unknown UDP ports
+		INVALID_FRAME = 5 // broken or not for us
+	};
+
 private:
 	std::vector<DataContainer> containers_;
 	uint burstID_;
 
-	void processARPRequest(struct ARP_HDR* arp);
-
-	/**
-	 * @return <true> If no checksum errors have been found
-	 */
-	bool checkFrame(struct UDP_HDR* hdr, uint16_t length);
-
+	static void processClassifiedFrame(DataContainer&& container,
+			FrameType type, uint burstID);
 
+	static void processARPRequest(struct ARP_HDR* arp);
 
 	static uint16_t L0_Port;
 	static uint16_t CREAM_Port;
@@ -38,12 +56,26 @@ private:
 	static std::atomic<uint> queuedTasksNum_;
 
 	static uint highestSourceNum_;
-	static std::atomic<uint64_t>* MEPsReceivedBySourceNum_;
-	static std::atomic<uint64_t>* BytesReceivedBySourceNum_;
 
-	void processFrame(DataContainer&& container);
+	/*
+	 * Source number of every L0 source ID or UNKNOWN_SOURCE_NUM. Built once so that unknown
+	 * IDs can be dropped without exceptions
+	 */
+	static const uint8_t UNKNOWN_SOURCE_NUM = 0xFF;
+	static uint8_t sourceNumBySourceID_[0x100];
+
+	/*
+	 * Active CREAMs indexed by crateID<<8 | creamID
+	 */
+	static std::bitset<0x10000> activeCREAMs_;
+
+	static std::atomic<uint64_t> unknownSourceIDFrames_[0x100];
+	static std::atomic<uint64_t>* unknownCREAMFrames_;
 
 public:
+	template<void (*PROCESS)(DataContainer&&, uint)>
+	friend class FrameBatchTask;
+
 	HandleFrameTask(std::vector<DataContainer>&& _containers, uint burstID);
 	virtual ~HandleFrameTask();
 
@@ -51,16 +83,124 @@ public:
 
 	static void initialize();
 
+	/**
+	 * Checks the headers of the frame and returns its type by peeking at the UDP port
+	 */
+	static inline FrameType classifyFrame(const DataContainer& container) {
+		if (!FrameValidator::isValid(container)) {
+			return classifyInvalidFrame(container);
+		}
+		return classifyValidFrame(container);
+	}
+
+	/**
+	 * @param container A frame that passed the FrameValidator
+	 */
+	static inline FrameType classifyValidFrame(const DataContainer& container) {
+		struct UDP_HDR* hdr = (struct UDP_HDR*) container.data;
+		if (hdr->isFragment()) {
+			return IP_FRAGMENT;
+		}
+		return classifyPort(ntohs(hdr->udp.dest));
+	}
+
+	/**
+	 * @param container A frame that did not pass the FrameValidator
+	 * @return CONTROL_FRAME for non UDP frames like ARP and INVALID_FRAME for broken frames
+	 */
+	static inline FrameType classifyInvalidFrame(
+			const DataContainer& container) {
+		if (FrameValidator::isControlFrame(container)) {
+			return CONTROL_FRAME;
+		}
+		return INVALID_FRAME;
+	}
+
+	static inline FrameType classifyPort(const uint16_t destPort) {
+		if (destPort == L0_Port) {
+			return L0_FRAME;
+		}
+		if (destPort == CREAM_Port) {
+			return CREAM_FRAME;
+		}
+		if (destPort == STRAW_PORT) {
+			return STRAW_FRAME;
+		}
+		return CONTROL_FRAME;
+	}
+
+	/**
+	 * Peeks at a frame still in the ring to decide where to copy it to. MEPs and CREAM
+	 * frames end up in objects freeing them with delete[] and must not be pooled
+	 *
+	 * @return true if the frame looks like an unfragmented L0 or CREAM datagram
+	 */
+	static inline bool isEventDataFrame(const char* frame,
+			const uint16_t length) {
+		if (length < sizeof(struct UDP_HDR)) {
+			return false;
+		}
+		struct UDP_HDR* hdr = (struct UDP_HDR*) frame;
+		if (hdr->eth.ether_type != 0x0008/*ETHERTYPE_IP*/
+		|| hdr->ip.protocol != IPPROTO_UDP || hdr->isFragment()) {
+			return false;
+		}
+		const uint16_t destPort = ntohs(hdr->udp.dest);
+		return destPort == L0_Port || destPort == CREAM_Port;
+	}
+
+	/**
+	 * Processes one received frame of any type. Called by the task for all its frames or
+	 * directly by the PacketHandler in run-to-completion mode
+	 */
+	static void processFrame(DataContainer&& container, uint burstID);
+
+	/**
+	 * Reassembles a frame classified as IP_FRAGMENT and processes the datagram as soon as it
+	 * is complete
+	 */
+	static void processFragment(DataContainer&& container, uint burstID);
+
+	/*
+	 * Process frames already classified by classifyFrame(). CREAM fragments carry no burst ID
+	 * but processCreamFrame keeps the signature required by FrameBatchTask
+	 */
+	static void processL0Frame(DataContainer&& container, uint burstID);
+	static void processCreamFrame(DataContainer&& container, uint);
+	static void processStrawFrame(DataContainer&& container, uint burstID);
+	static void processControlFrame(DataContainer&& container);
+
+	static inline uint32_t GetMyIP() {
+		return MyIP;
+	}
+
 	static inline uint getNumberOfQeuedTasks() {
 		return queuedTasksNum_;
 	}
 
 	static inline uint64_t GetMEPsReceivedBySourceNum(uint8_t sourceNum) {
-		return MEPsReceivedBySourceNum_[sourceNum];
+		return ThreadCounters::sum(
+				ThreadCounters::MEPS_RECEIVED_BY_SOURCE_NUM + sourceNum);
 	}
 
 	static inline uint64_t GetBytesReceivedBySourceNum(uint8_t sourceNum) {
-		return BytesReceivedBySourceNum_[sourceNum];
+		return ThreadCounters::sum(
+				ThreadCounters::BYTES_RECEIVED_BY_SOURCE_NUM + sourceNum);
+	}
+
+	/**
+	 * @return The number of MEPs dropped because of the unknown source ID
+	 */
+	static inline uint64_t GetUnknownSourceIDFrames(uint8_t sourceID) {
+		return unknownSourceIDFrames_[sourceID];
+	}
+
+	/**
+	 * @return The number of CREAM frames dropped because the CREAM is not active
+	 */
+	static inline uint64_t GetUnknownCREAMFrames(uint8_t crateID,
+			uint8_t creamID) {
+		return unknownCREAMFrames_[crateID << 8 | creamID];
 	}
 };
 
@@ -0,0 +1,138 @@
+/*
+ * IdleStrategy.cpp
+ *
+ *  Created on: Oct 16, 2026
+ *      Author: Jonas Kunze (kunze.jonas@gmail.com)
+ */
+
+#include "IdleStrategy.h"
+
+#include <cpuid.h>
+#include <immintrin.h>
+#include <sched.h>
+#include <unistd.h>
+#include <algorithm>
+#include <chrono>
+
+#include <options/Logging.h>
+#include <options/Options.h>
+
+#include "../options/MyOptions.h"
+
+namespace na62 {
+
+bool IdleStrategy::waitpkgSupported_ = false;
+uint64_t IdleStrategy::ticksPerMicro_ = 1;
+
+uint64_t IdleStrategy::minQuantumTicks_;
+uint64_t IdleStrategy::maxQuantumTicks_;
+uint64_t IdleStrategy::maxSpinTicks_;
+uint64_t IdleStrategy::maxWaitTicks_;
+uint IdleStrategy::maxSleepMicros_;
+
+std::atomic<uint64_t> IdleStrategy::ticksInTier_[SLEEP + 1];
+
+/*
+ * tpause is only available with -mwaitpkg so it has to be compiled for that target explicitly.
+ * It must only be called if waitpkgSupported_ is true
+ */
+__attribute__((target("waitpkg"))) static inline void tpause(
+		uint64_t deadlineTicks) {
+	_tpause(0 /* C0.2 */, deadlineTicks);
+}
+
+void IdleStrategy::initialize() {
+	uint eax, ebx, ecx, edx;
+	if (__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx)) {
+		waitpkgSupported_ = ecx & (1 << 5);
+	}
+
+	/*
+	 * Measure the TSC frequency
+	 */
+	auto start = std::chrono::steady_clock::now();
+	const uint64_t startTicks = __rdtsc();
+	usleep(10000);
+	const uint64_t ticks = __rdtsc() - startTicks;
+	const uint64_t micros = std::chrono::duration_cast<
+			std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+	ticksPerMicro_ = std::max((uint64_t) 1, ticks / std::max((uint64_t) 1, micros));
+
+	minQuantumTicks_ = 100;
+	maxQuantumTicks_ = std::max((uint64_t) Options::GetDouble(OPTION_POLLING_DELAY),
+			minQuantumTicks_);
+	maxSpinTicks_ = Options::GetInt(OPTION_IDLE_MAX_SPIN_MICROS) * ticksPerMicro_;
+	maxWaitTicks_ = std::max(
+			(uint64_t) Options::GetInt(OPTION_IDLE_MAX_WAIT_MICROS) * ticksPerMicro_,
+			maxSpinTicks_);
+	maxSleepMicros_ = std::max(1, Options::GetInt(OPTION_POLLING_SLEEP_MICROS));
+
+	for (auto& ticks : ticksInTier_) {
+		ticks = 0;
+	}
+
+	LOG_INFO<< "Idle strategy: " << ticksPerMicro_ << " TSC ticks per microsecond, tpause "
+	<< (waitpkgSupported_ ? "available" : "not available") << ENDL;
+}
+
+IdleStrategy::IdleStrategy() :
+		lastFrameTicks_(__rdtsc()), averageInterArrivalTicks_(maxWaitTicks_), sleepMicros_(
+				1) {
+}
+
+IdleStrategy::Tier IdleStrategy::idle(bool maySleep) {
+	const uint64_t start = __rdtsc();
+	const uint64_t idleTicks = start - lastFrameTicks_;
+
+	/*
+	 * Spin for a few inter-arrival times and use tpause for some more before giving
+	 * the core away
+	 */
+	const uint64_t spinTicks = std::min(4 * averageInterArrivalTicks_,
+			maxSpinTicks_);
+	const uint64_t waitTicks = std::min(
+			std::max(64 * averageInterArrivalTicks_, spinTicks), maxWaitTicks_);
+
+	/*
+	 * Poll again after half an inter-arrival time
+	 */
+	const uint64_t quantum = std::min(
+			std::max(averageInterArrivalTicks_ / 2, minQuantumTicks_),
+			maxQuantumTicks_);
+
+	Tier tier;
+	if (idleTicks < spinTicks) {
+		tier = SPIN;
+		spin(quantum);
+	} else if (idleTicks < waitTicks || !maySleep) {
+		tier = WAIT;
+		wait(quantum);
+	} else {
+		tier = SLEEP;
+		usleep(sleepMicros_);
+		sleepMicros_ = std::min(2 * sleepMicros_, maxSleepMicros_);
+	}
+
+	ticksInTier_[tier].fetch_add(__rdtsc() - start, std::memory_order_relaxed);
+	return tier;
+}
+
+void IdleStrategy::spin(uint64_t ticks) {
+	const uint64_t deadline = __rdtsc() + ticks;
+	while (__rdtsc() < deadline) {
+		_mm_pause();
+	}
+}
+
+void IdleStrategy::wait(uint64_t ticks) {
+	if (waitpkgSupported_) {
+		/*
+		 * The OS may limit the maximum duration so we might return earlier
+		 */
+		tpause(__rdtsc() + ticks);
+	} else {
+		sched_yield();
+	}
+}
+
+} /* namespace na62 */
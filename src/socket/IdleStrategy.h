@@ -0,0 +1,107 @@
+/*
+ * IdleStrategy.h
+ *
+ *  Created on: Oct 16, 2026
+ *      Author: Jonas Kunze (kunze.jonas@gmail.com)
+ */
+
+#pragma once
+#ifndef IDLESTRATEGY_H_
+#define IDLESTRATEGY_H_
+
+#include <sys/types.h>
+#include <x86intrin.h>
+#include <atomic>
+#include <cstdint>
+
+namespace na62 {
+
+/*
+ * Decides how a PacketHandler waits after an unsuccessful poll. Depending on the time since
+ * the last received frame it goes through the following tiers:
+ *
+ * SPIN:  pause instructions
+ * WAIT:  tpause in the C0.2 state if the CPU supports WAITPKG, sched_yield otherwise
+ * SLEEP: a sleep with exponential backoff up to pollingSleepMicros
+ *
+ * There is no tier blocking on the ring: NetworkHandler neither exposes the pf_ring handle
+ * for pfring_poll nor offers a receive with timeout, and a blocked thread could not be
+ * stopped on an idle link.
+ *
+ * The tier boundaries follow the average inter-arrival time of the frames of the queue so that
+ * during a burst we never go deeper than WAIT and between bursts the core is released quickly.
+ */
+class IdleStrategy {
+public:
+	enum Tier {
+		SPIN = 0, WAIT = 1, SLEEP = 2
+	};
+
+	/**
+	 * Reads the options, checks the CPU features and calibrates the TSC
+	 */
+	static void initialize();
+
+	IdleStrategy();
+
+	/**
+	 * Must be called for every received frame
+	 */
+	inline void onFrameReceived() {
+		const uint64_t now = __rdtsc();
+		uint64_t interArrival = now - lastFrameTicks_;
+		if (interArrival > maxWaitTicks_) {
+			interArrival = maxWaitTicks_;
+		}
+		/*
+		 * Exponentially weighted moving average with a weight of 1/8
+		 */
+		averageInterArrivalTicks_ += ((int64_t) interArrival
+				- (int64_t) averageInterArrivalTicks_) / 8;
+		lastFrameTicks_ = now;
+		sleepMicros_ = 1;
+	}
+
+	/**
+	 * Waits once after an unsuccessful poll using the tier adequate for the time since the last frame
+	 *
+	 * @param maySleep If <false> the WAIT tier is never left
+	 *
+	 * @return The tier that has been used
+	 */
+	Tier idle(bool maySleep);
+
+	static inline bool IsWaitpkgSupported() {
+		return waitpkgSupported_;
+	}
+
+	/*
+	 * Time spent in each tier by all queues in microseconds
+	 */
+	static inline uint64_t GetMicrosInTier(Tier tier) {
+		return ticksInTier_[tier] / ticksPerMicro_;
+	}
+
+private:
+	uint64_t lastFrameTicks_;
+	uint64_t averageInterArrivalTicks_;
+	uint sleepMicros_;
+
+	static bool waitpkgSupported_;
+	static uint64_t ticksPerMicro_;
+
+	static uint64_t minQuantumTicks_;
+	static uint64_t maxQuantumTicks_;
+	static uint64_t maxSpinTicks_;
+	static uint64_t maxWaitTicks_;
+	static uint maxSleepMicros_;
+
+	static std::atomic<uint64_t> ticksInTier_[SLEEP + 1];
+
+	void spin(uint64_t ticks);
+	void wait(uint64_t ticks);
+};
+
+} /* namespace na62 */
+
+#endif /* IDLESTRATEGY_H_ */
@@ -40,10 +40,53 @@
 #include <boost/timer/timer.hpp>
 #include <options/Logging.h>
 
+#include "../benchmark/ThroughputBenchmark.h"
+#include "../eventBuilding/L1Builder.h"
+#include "../eventBuilding/TriggerTask.h"
+#include "FrameBufferPool.h"
 #include "HandleFrameTask.h"
+#include "IdleStrategy.h"
+#include "FrameBatchTask.h"
+#include "FrameValidator.h"
+#include "PcapReplayer.h"
+#include "SlowPathHandler.h"
+#include "../topology/NodeArena.h"
+#include "../topology/SystemTopology.h"
 
 namespace na62 {
 
+/*
+ * Functor processing a batch of frames within a NodeArena
+ */
+template<typename TASK>
+struct HandleFramesInArena {
+	mutable std::vector<DataContainer> frames;
+	uint burstID;
+
+	void operator()() const {
+		tbb::task::spawn_root_and_wait(
+				*new (tbb::task::allocate_root()) TASK(std::move(frames),
+						burstID));
+	}
+};
+
+/*
+ * Starts a task of type TASK processing the frames
+ */
+template<typename TASK>
+static void enqueueBatch(std::vector<DataContainer>& frames, uint burstID,
+		NodeArena* arena, tbb::priority_t priority) {
+	if (arena != nullptr) {
+		HandleFramesInArena<TASK> functor = { std::move(frames), burstID };
+		arena->enqueue(functor);
+	} else {
+		TASK* task = new (tbb::task::allocate_root()) TASK(std::move(frames),
+				burstID);
+		tbb::task::enqueue(*task, priority);
+	}
+	frames.clear();
+}
+
 std::atomic<uint> PacketHandler::spins_;
 std::atomic<uint> PacketHandler::sleeps_;
 
@@ -51,6 +94,8 @@ boost::timer::cpu_timer PacketHandler::sendTimer;
 
 uint PacketHandler::NUMBER_OF_EBS = 0;
 std::atomic<uint> PacketHandler::frameHandleTasksSpawned_(0);
+std::atomic<uint64_t> PacketHandler::framesProcessedInline_(0);
+bool PacketHandler::runToCompletion_ = false;
 
 uint32_t PacketHandler::currentBurstID_;
 uint32_t PacketHandler::nextBurstID_;
@@ -67,6 +112,28 @@ PacketHandler::~PacketHandler() {
 void PacketHandler::initialize() {
 	currentBurstID_ = Options::GetInt(OPTION_FIRST_BURST_ID);
 	nextBurstID_ = currentBurstID_;
+
+	FrameBufferPool::initialize(GetNumberOfQueues());
+
+	/*
+	 * In run-to-completion mode only the trigger processing runs in the TBB pool
+	 */
+	runToCompletion_ = Options::GetBool(OPTION_RUN_TO_COMPLETION);
+	TriggerTask::setEnabled(runToCompletion_);
+	IdleStrategy::initialize();
+}
+
+uint PacketHandler::GetNumberOfQueues() {
+	if (PcapReplayer::IsActive()) {
+		return PcapReplayer::GetNumberOfQueues();
+	}
+	if (ThroughputBenchmark::IsEnabled()) {
+		/*
+		 * The benchmark injects its frames without any PacketHandler
+		 */
+		return 0;
+	}
+	return NetworkHandler::GetNumberOfQueues();
 }
 
 void PacketHandler::thread() {
@@ -75,7 +142,6 @@ void PacketHandler::thread() {
 	int receivedFrame = 0;
 
 	const bool activePolling = Options::GetBool(OPTION_ACTIVE_POLLING);
-	const uint pollDelay = Options::GetDouble(OPTION_POLLING_DELAY);
 
 	const uint maxAggregationMicros = Options::GetInt(
 	OPTION_MAX_AGGREGATION_TIME);
@@ -83,20 +149,48 @@ void PacketHandler::thread() {
 	const uint minUsecBetweenL1Requests = Options::GetInt(
 	OPTION_MIN_USEC_BETWEEN_L1_REQUESTS);
 
-	uint sleepMicros = Options::GetInt(OPTION_POLLING_SLEEP_MICROS);
-
 	const uint framesToBeGathered = Options::GetInt(
 	OPTION_MAX_FRAME_AGGREGATION);
 
+	/*
+	 * Without pf_ring there is nothing to be sent
+	 */
+	const bool replay = PcapReplayer::IsActive();
+
 	//boost::timer::cpu_timer sendTimer;
 
+	/*
+	 * This thread is already pinned -> the buffers are allocated on the right NUMA node
+	 */
+	FrameBufferPool* framePool = FrameBufferPool::createPool(threadNum_);
+
+	NodeArena* arena =
+			Options::GetBool(OPTION_NUMA_AWARE) ?
+					NodeArena::getArena(
+							SystemTopology::GetNodeOfQueue(threadNum_)) :
+					nullptr;
+	NodeArena::setCurrentThreadArena(arena);
+
+	IdleStrategy idleStrategy;
+
+	/*
+	 * Frames received during one aggregation period and their validation result
+	 */
+	std::vector<DataContainer> received;
+	received.reserve(framesToBeGathered + 1);
+	std::vector<uint64_t> validFrames((framesToBeGathered + 1 + 63) / 64);
+
 	char* buff; // = new char[MTU];
 	while (running_) {
 		/*
 		 * We want to aggregate several frames if we already have more HandleFrameTasks running than there are CPU cores available
 		 */
-		std::vector<DataContainer> frames;
-		frames.reserve(framesToBeGathered);
+		std::vector<DataContainer> l0Frames;
+		l0Frames.reserve(framesToBeGathered);
+		std::vector<DataContainer> creamFrames;
+		std::vector<DataContainer> strawFrames;
+		std::vector<DataContainer> fragments;
+		bool processedInline = false;
 
 		receivedFrame = 0;
 		buff = nullptr;
@@ -113,29 +207,53 @@ void PacketHandler::thread() {
 			 * The actual  polling!
 			 * Do not wait for incoming packets as this will block the ring and make sending impossible
 			 */
-			receivedFrame = NetworkHandler::GetNextFrame(&hdr, &buff, 0, false,
-					threadNum_);
+			if (replay) {
+				receivedFrame = PcapReplayer::GetNextFrame(&hdr, &buff,
+						threadNum_);
+			} else {
+				receivedFrame = NetworkHandler::GetNextFrame(&hdr, &buff, 0,
+						false, threadNum_);
+			}
 
 			if (receivedFrame > 0) {
-
-				char* data = new char[hdr.len];
-				memcpy(data, buff, hdr.len);
-				frames.push_back( { data, (uint16_t) hdr.len, true });
+				/*
+				 * The ring slot will be reused -> copy the frame into a pooled buffer
+				 */
+				DataContainer frame = framePool->copyFrame(buff, hdr.len,
+						!HandleFrameTask::isEventDataFrame(buff, hdr.len));
+				idleStrategy.onFrameReceived();
+				if (runToCompletion_) {
+					/*
+					 * Process the frame while it is still in the cache
+					 */
+					updateBurstID();
+					HandleFrameTask::processFrame(std::move(frame),
+							currentBurstID_);
+					L1Builder::flushL1BatchIfExpired();
+					framesProcessedInline_.fetch_add(1,
+							std::memory_order_relaxed);
+					processedInline = true;
+				} else {
+					received.push_back(frame);
+				}
 				goToSleep = false;
 				spinsInARow = 0;
 			} else {
-				if (threadNum_ == 0
+				/*
+				 * No more frames for now -> do not let the completed events wait
+				 */
+				if (runToCompletion_) {
+					L1Builder::flushL1Batch();
+				}
+
+				if (threadNum_ == 0 && !replay
 						&& sendTimer.elapsed().wall / 1000
 								> minUsecBetweenL1Requests) {
 
 					/*
 					 * We didn't receive anything for a while -> send enqueued frames
 					 */
-					sleepMicros = Options::GetInt(OPTION_POLLING_SLEEP_MICROS);
 					if (NetworkHandler::DoSendQueuedFrames(threadNum_)) {
-						sleepMicros =
-								sleepMicros > minUsecBetweenL1Requests ?
-										minUsecBetweenL1Requests : sleepMicros;
 						spinsInARow = 0;
 					}
 					sendTimer.start();
@@ -160,7 +278,7 @@ void PacketHandler::thread() {
 					if ((stepNum == 0 || spinsInARow++ == 10
 							|| aggregationTimer.elapsed().wall / 1000
 									> maxAggregationMicros)
-							&& (threadNum_ != 0
+							&& (threadNum_ != 0 || replay
 									|| NetworkHandler::getNumberOfEnqueuedSendFrames()
 											== 0)) {
 						goToSleep = true;
@@ -168,50 +286,95 @@ void PacketHandler::thread() {
 					}
 
 					/*
-					 * Spin wait a while. This block is not optimized by the compiler
+					 * Wait a while without giving the core away as we are aggregating frames
 					 */
 					spins_++;
-					for (volatile uint i = 0; i < pollDelay; i++) {
-						asm("");
-					}
+					idleStrategy.idle(false);
 				}
 			}
 		}
 
-		if (!frames.empty()) {
+		const bool framesGathered = !received.empty();
+		if (framesGathered) {
 			/*
-			 * Check if the burstID is already updated and the update is long enough ago. Otherwise
-			 * we would increment the burstID while we are still processing events from the last burst.
+			 * Validate all headers at once and sort the frames into the batches of their type
 			 */
-			if (nextBurstID_ != currentBurstID_
-			//&& mep->getFirstEventNum() < 1000
-					&& burstChangedTimer_.elapsed().wall / 1E6 > 1000 /*1s*/) {
-				currentBurstID_ = nextBurstID_;
+			FrameValidator::validate(received.data(), received.size(),
+					validFrames.data());
+			for (uint i = 0; i != received.size(); i++) {
+				DataContainer& frame = received[i];
+				const bool valid = validFrames[i / 64] & (1ull << (i % 64));
+				switch (valid ?
+						HandleFrameTask::classifyValidFrame(frame) :
+						HandleFrameTask::classifyInvalidFrame(frame)) {
+				case HandleFrameTask::L0_FRAME:
+					l0Frames.push_back(frame);
+					break;
+				case HandleFrameTask::CREAM_FRAME:
+					creamFrames.push_back(frame);
+					break;
+				case HandleFrameTask::STRAW_FRAME:
+					strawFrames.push_back(frame);
+					break;
+				case HandleFrameTask::IP_FRAGMENT:
+					fragments.push_back(frame);
+					break;
+				case HandleFrameTask::CONTROL_FRAME:
+					SlowPathHandler::enqueueFrame(std::move(frame));
+					break;
+				default:
+					FrameBufferPool::freeFrame(frame);
+				}
 			}
+			received.clear();
+
+			updateBurstID();
 
 			/*
-			 * Start a new task which will check the frame
-			 *
+			 * Start one task per frame type. CREAM data completes events and frees them so
+			 * it has a higher priority. STRAW data is only forwarded.
 			 */
-			HandleFrameTask* task =
-					new (tbb::task::allocate_root()) HandleFrameTask(
-							std::move(frames), currentBurstID_);
-			tbb::task::enqueue(*task, tbb::priority_t::priority_normal);
+			if (!l0Frames.empty()) {
+				enqueueBatch<L0FrameTask>(l0Frames, currentBurstID_, arena,
+						tbb::priority_t::priority_normal);
+				frameHandleTasksSpawned_++;
+			}
+			if (!creamFrames.empty()) {
+				enqueueBatch<CreamFrameTask>(creamFrames, currentBurstID_,
+						arena, tbb::priority_t::priority_high);
+				frameHandleTasksSpawned_++;
+			}
+			if (!strawFrames.empty()) {
+				enqueueBatch<StrawFrameTask>(strawFrames, currentBurstID_,
+						arena, tbb::priority_t::priority_low);
+				frameHandleTasksSpawned_++;
+			}
+			if (!fragments.empty()) {
+				/*
+				 * Reassembles the fragments and processes the datagrams
+				 */
+				enqueueBatch<FragmentTask>(fragments, currentBurstID_,
+						arena, tbb::priority_t::priority_normal);
+				frameHandleTasksSpawned_++;
+			}
 
 			goToSleep = false;
-			frameHandleTasksSpawned_++;
 		} else {
-			goToSleep = true;
+			goToSleep = !processedInline;
 		}
 
 		if (goToSleep) {
-			sleeps_++;
-			if (!activePolling) {
-				/*
-				 * Allow other threads to run
-				 */
-				boost::this_thread::sleep(
-						boost::posix_time::microsec(sleepMicros));
+			/*
+			 * With active polling we never give the core away
+			 */
+			switch (idleStrategy.idle(!activePolling)) {
+			case IdleStrategy::SPIN:
+			case IdleStrategy::WAIT:
+				spins_++;
+				break;
+			case IdleStrategy::SLEEP:
+				sleeps_++;
+				break;
 			}
 		}
 	}
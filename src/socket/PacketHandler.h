@@ -30,6 +30,11 @@ public:
 
 	static void initialize();
 
+	/**
+	 * @return The number of RX queues of the NIC or of the pcap replay
+	 */
+	static uint GetNumberOfQueues();
+
 	static std::atomic<uint> spins_;
 	static std::atomic<uint> sleeps_;
 	static boost::timer::cpu_timer sendTimer;
@@ -39,6 +44,11 @@ public:
 	 */
 	static std::atomic<uint> frameHandleTasksSpawned_;
 
+	/*
+	 * Number of frames processed directly by the PacketHandlers in run-to-completion mode
+	 */
+	static std::atomic<uint64_t> framesProcessedInline_;
+
 	static uint32_t getCurrentBurstId() {
 		return currentBurstID_;
 	}
@@ -66,6 +76,23 @@ private:
 	static uint32_t nextBurstID_;
 	static boost::timer::cpu_timer burstChangedTimer_;
 
+	/*
+	 * Process frames within this thread instead of HandleFrameTasks
+	 */
+	static bool runToCompletion_;
+
+	/**
+	 * Check if the burstID is already updated and the update is long enough ago. Otherwise
+	 * we would increment the burstID while we are still processing events from the last burst.
+	 */
+	static inline void updateBurstID() {
+		if (nextBurstID_ != currentBurstID_
+		//&& mep->getFirstEventNum() < 1000
+				&& burstChangedTimer_.elapsed().wall / 1E6 > 1000 /*1s*/) {
+			currentBurstID_ = nextBurstID_;
+		}
+	}
+
 	/**
 	 * @return <true> In case of success, false in case of a serious error (we should stop the thread in this case)
 	 */
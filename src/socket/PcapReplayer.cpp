@@ -0,0 +1,321 @@
+/*
+ * PcapReplayer.cpp
+ *
+ *  Created on: Oct 16, 2026
+ *      Author: Jonas Kunze (kunze.jonas@gmail.com)
+ */
+
+#include "PcapReplayer.h"
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <linux/pf_ring.h>
+#include <net/ethernet.h>
+#include <netinet/in.h>
+#include <netinet/ip.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+
+#include <options/Logging.h>
+#include <options/Options.h>
+#include <structs/Network.h>
+
+#include "../options/MyOptions.h"
+
+namespace na62 {
+
+/*
+ * File format as defined by libpcap
+ */
+struct PCAP_FILE_HDR {
+	uint32_t magic;
+	uint16_t versionMajor;
+	uint16_t versionMinor;
+	int32_t thiszone;
+	uint32_t sigfigs;
+	uint32_t snaplen;
+	uint32_t linktype;
+}__attribute__ ((__packed__));
+
+struct PCAP_RECORD_HDR {
+	uint32_t tsSec;
+	uint32_t tsFraction; // micro or nano seconds depending on the magic
+	uint32_t inclLength;
+	uint32_t origLength;
+}__attribute__ ((__packed__));
+
+#define PCAP_MAGIC_MICROS 0xa1b2c3d4
+#define PCAP_MAGIC_NANOS 0xa1b23c4d
+#define PCAP_LINKTYPE_ETHERNET 1
+
+/*
+ * Frames are copied into DataContainers with a 16 bit length
+ */
+#define PCAP_MAX_FRAME_LENGTH 0xFFFF
+
+bool PcapReplayer::active_ = false;
+uint PcapReplayer::mode_;
+uint PcapReplayer::loops_;
+uint32_t PcapReplayer::myIP_ = 0;
+
+std::vector<PcapReplayer::Queue> PcapReplayer::queues_;
+
+uint64_t PcapReplayer::loopDurationNanos_;
+std::atomic<uint64_t> PcapReplayer::startNanos_(0);
+
+std::atomic<uint64_t> PcapReplayer::framesReplayed_(0);
+std::atomic<uint64_t> PcapReplayer::bytesReplayed_(0);
+
+std::vector<std::string> PcapReplayer::GetFileNames() {
+	std::string deviceName = Options::GetString(OPTION_ETH_DEVICE_NAME);
+	if (deviceName.compare(0, 5, "pcap:") == 0) {
+		return {deviceName.substr(5)};
+	}
+	if (Options::GetString(OPTION_PCAP_REPLAY_FILES).empty()) {
+		return {};
+	}
+	return Options::GetStringList(OPTION_PCAP_REPLAY_FILES);
+}
+
+bool PcapReplayer::IsEnabled() {
+	return !GetFileNames().empty();
+}
+
+uint64_t PcapReplayer::now() {
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(
+			std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void PcapReplayer::mapFile(std::string fileName, std::vector<Frame>& frames) {
+	int fd = open(fileName.c_str(), O_RDONLY);
+	struct stat fileStat;
+	if (fd < 0 || fstat(fd, &fileStat) != 0) {
+		LOG_ERROR<< "Unable to open pcap file " << fileName << ": " << strerror(errno) << ENDL;
+		exit(1);
+	}
+
+	const size_t fileSize = fileStat.st_size;
+	const char* file = (const char*) mmap(nullptr, fileSize, PROT_READ,
+			MAP_PRIVATE | MAP_POPULATE, fd, 0);
+	close(fd);
+	if (file == MAP_FAILED || fileSize < sizeof(PCAP_FILE_HDR)) {
+		LOG_ERROR<< "Unable to map pcap file " << fileName << ENDL;
+		exit(1);
+	}
+	madvise((void*) file, fileSize, MADV_SEQUENTIAL);
+
+	const PCAP_FILE_HDR* fileHdr = (const PCAP_FILE_HDR*) file;
+	bool swapped = false;
+	bool nanos = false;
+	switch (fileHdr->magic) {
+	case PCAP_MAGIC_MICROS:
+		break;
+	case PCAP_MAGIC_NANOS:
+		nanos = true;
+		break;
+	case __builtin_bswap32(PCAP_MAGIC_MICROS):
+		swapped = true;
+		break;
+	case __builtin_bswap32(PCAP_MAGIC_NANOS):
+		swapped = true;
+		nanos = true;
+		break;
+	default:
+		LOG_ERROR<< fileName << " is not a pcap file" << ENDL;
+		exit(1);
+	}
+
+	const uint32_t linktype =
+			swapped ? __builtin_bswap32(fileHdr->linktype) : fileHdr->linktype;
+	if (linktype != PCAP_LINKTYPE_ETHERNET) {
+		LOG_ERROR<< fileName << " does not contain ethernet frames (linktype " << linktype << ")" << ENDL;
+		exit(1);
+	}
+
+	uint truncatedFrames = 0;
+	uint oversizedFrames = 0;
+	size_t offset = sizeof(PCAP_FILE_HDR);
+	while (offset + sizeof(PCAP_RECORD_HDR) <= fileSize) {
+		const PCAP_RECORD_HDR* record = (const PCAP_RECORD_HDR*) (file + offset);
+		Frame frame;
+		frame.data = file + offset + sizeof(PCAP_RECORD_HDR);
+		frame.length =
+				swapped ?
+						__builtin_bswap32(record->inclLength) :
+						record->inclLength;
+		const uint32_t origLength =
+				swapped ?
+						__builtin_bswap32(record->origLength) :
+						record->origLength;
+		const uint32_t tsSec =
+				swapped ? __builtin_bswap32(record->tsSec) : record->tsSec;
+		const uint32_t tsFraction =
+				swapped ?
+						__builtin_bswap32(record->tsFraction) :
+						record->tsFraction;
+
+		offset += sizeof(PCAP_RECORD_HDR) + frame.length;
+		if (offset > fileSize) {
+			LOG_ERROR<< "Ignoring incomplete last record of " << fileName << ENDL;
+			break;
+		}
+		if (frame.length > PCAP_MAX_FRAME_LENGTH) {
+			oversizedFrames++;
+			continue;
+		}
+		if (frame.length != origLength) {
+			truncatedFrames++;
+		}
+
+		frame.timestamp.tv_sec = tsSec;
+		frame.timestamp.tv_usec = nanos ? tsFraction / 1000 : tsFraction;
+		frame.dueNanos = tsSec * 1000000000ull
+				+ (nanos ? tsFraction : tsFraction * 1000ull);
+		frames.push_back(frame);
+	}
+
+	if (truncatedFrames != 0) {
+		LOG_ERROR<< fileName << " contains " << truncatedFrames
+		<< " truncated frames. They will be replayed with their captured length only" << ENDL;
+	}
+	if (oversizedFrames != 0) {
+		LOG_ERROR<< "Ignoring " << oversizedFrames << " frames of " << fileName
+		<< " longer than " << PCAP_MAX_FRAME_LENGTH << " B" << ENDL;
+	}
+}
+
+void PcapReplayer::initialize() {
+	mode_ = Options::GetInt(OPTION_PCAP_REPLAY_MODE);
+	loops_ = Options::GetInt(OPTION_PCAP_REPLAY_LOOPS);
+	const double rate = Options::GetDouble(OPTION_PCAP_REPLAY_RATE);
+	const uint numberOfQueues = std::max(1,
+			Options::GetInt(OPTION_PCAP_REPLAY_QUEUES));
+
+	if (mode_ == FIXED_RATE && rate <= 0) {
+		LOG_ERROR<< "pcapReplayRate must be positive for pcapReplayMode=" << FIXED_RATE << ENDL;
+		exit(1);
+	}
+
+	/*
+	 * Read all frames of all files in the order they are given
+	 */
+	std::vector<Frame> frames;
+	for (std::string fileName : GetFileNames()) {
+		LOG_INFO<< "Mapping pcap file " << fileName << ENDL;
+		mapFile(fileName, frames);
+	}
+
+	if (frames.empty()) {
+		LOG_ERROR<< "No frames found in the pcap files to be replayed" << ENDL;
+		exit(1);
+	}
+
+	std::string myIP = Options::GetString(OPTION_PCAP_REPLAY_IP);
+	if (!myIP.empty()) {
+		struct in_addr addr;
+		if (inet_pton(AF_INET, myIP.c_str(), &addr) != 1) {
+			LOG_ERROR<< "Invalid pcapReplayIP " << myIP << ENDL;
+			exit(1);
+		}
+		myIP_ = addr.s_addr;
+	}
+
+	/*
+	 * Calculate the release time of every frame and distribute the frames to the queues by
+	 * their source IP
+	 */
+	queues_.resize(numberOfQueues);
+	const uint64_t firstTimestamp = frames.front().dueNanos;
+	uint64_t frameIndex = 0;
+	for (Frame& frame : frames) {
+		switch (mode_) {
+		case RECORDED_TIMESTAMPS:
+			frame.dueNanos =
+					frame.dueNanos > firstTimestamp ?
+							frame.dueNanos - firstTimestamp : 0;
+			break;
+		case FIXED_RATE:
+			frame.dueNanos = frameIndex * 1E9 / rate;
+			break;
+		default:
+			frame.dueNanos = 0;
+		}
+		frameIndex++;
+
+		uint queue = 0;
+		const UDP_HDR* hdr = (const UDP_HDR*) frame.data;
+		if (frame.length >= sizeof(ether_header) + sizeof(iphdr)
+				&& hdr->eth.ether_type == htons(ETHERTYPE_IP)) {
+			queue = ntohl(hdr->ip.saddr) % numberOfQueues;
+
+			if (myIP_ == 0) {
+				myIP_ = hdr->ip.daddr;
+			}
+		}
+		queues_[queue].frames.push_back(frame);
+	}
+
+	/*
+	 * The next loop starts one average frame interval after the last frame
+	 */
+	loopDurationNanos_ = frames.back().dueNanos
+			+ frames.back().dueNanos / frames.size();
+
+	for (Queue& queue : queues_) {
+		queue.nextFrame = 0;
+		queue.loop = 0;
+	}
+
+	struct in_addr addr;
+	addr.s_addr = myIP_;
+	LOG_INFO<< "Replaying " << frames.size() << " frames on " << numberOfQueues
+	<< " queues with mode " << mode_ << " to " << inet_ntoa(addr) << ENDL;
+
+	active_ = true;
+}
+
+int PcapReplayer::GetNextFrame(struct pfring_pkthdr* hdr, char** pkt,
+		uint queueNumber) {
+	Queue& queue = queues_[queueNumber];
+	if (queue.nextFrame == queue.frames.size()) {
+		if (queue.frames.empty() || (loops_ != 0 && queue.loop + 1 >= loops_)) {
+			return 0;
+		}
+		queue.nextFrame = 0;
+		queue.loop++;
+	}
+
+	/*
+	 * The replay starts with the first frame requested by any queue
+	 */
+	uint64_t start = startNanos_.load(std::memory_order_relaxed);
+	if (start == 0) {
+		uint64_t expected = 0;
+		startNanos_.compare_exchange_strong(expected, now());
+		start = startNanos_;
+	}
+
+	const Frame& frame = queue.frames[queue.nextFrame];
+	if (mode_ != AS_FAST_AS_POSSIBLE
+			&& now() - start
+					< frame.dueNanos + queue.loop * loopDurationNanos_) {
+		return 0;
+	}
+	queue.nextFrame++;
+
+	hdr->len = frame.length;
+	hdr->caplen = frame.length;
+	hdr->ts = frame.timestamp;
+	*pkt = (char*) frame.data;
+
+	framesReplayed_.fetch_add(1, std::memory_order_relaxed);
+	bytesReplayed_.fetch_add(frame.length, std::memory_order_relaxed);
+	return 1;
+}
+
+} /* namespace na62 */
@@ -0,0 +1,135 @@
+/*
+ * PcapReplayer.h
+ *
+ *  Created on: Oct 16, 2026
+ *      Author: Jonas Kunze (kunze.jonas@gmail.com)
+ */
+
+#pragma once
+#ifndef PCAPREPLAYER_H_
+#define PCAPREPLAYER_H_
+
+#include <sys/types.h>
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+struct pfring_pkthdr;
+
+namespace na62 {
+
+/*
+ * Replays frames from memory mapped pcap files instead of receiving them from pf_ring.
+ *
+ * The frames are distributed to the queues by the source IP like the RSS of the NIC does and
+ * are served via GetNextFrame() which behaves like NetworkHandler::GetNextFrame() without
+ * blocking: 0 is returned if the next frame of the queue is not yet due.
+ */
+class PcapReplayer {
+public:
+	enum ReplayMode {
+		/*
+		 * Frames are released at the timestamps recorded in the file
+		 */
+		RECORDED_TIMESTAMPS = 0,
+		/*
+		 * Frames are released with pcapReplayRate frames per second (all queues together)
+		 */
+		FIXED_RATE = 1,
+		/*
+		 * Frames are released as fast as the PacketHandlers are able to process them
+		 */
+		AS_FAST_AS_POSSIBLE = 2
+	};
+
+	/**
+	 * @return <true> if the files defined by the pcapReplayFiles option or by an ethDeviceName
+	 * like "pcap:file.pcap" should be replayed instead of using pf_ring
+	 */
+	static bool IsEnabled();
+
+	/**
+	 * Maps all files and generates the frame index of every queue
+	 */
+	static void initialize();
+
+	static inline bool IsActive() {
+		return active_;
+	}
+
+	/**
+	 * @return 1 if a frame has been written to hdr and pkt, 0 if the next frame is not yet due
+	 * or the replay is finished
+	 */
+	static int GetNextFrame(struct pfring_pkthdr* hdr, char** pkt,
+			uint queueNumber);
+
+	static inline uint GetNumberOfQueues() {
+		return queues_.size();
+	}
+
+	/**
+	 * @return The IP in network byte order frames are expected to be sent to
+	 */
+	static inline uint32_t GetMyIP() {
+		return myIP_;
+	}
+
+	static inline uint64_t GetFramesReplayed() {
+		return framesReplayed_;
+	}
+
+	static inline uint64_t GetBytesReplayed() {
+		return bytesReplayed_;
+	}
+
+private:
+	struct Frame {
+		const char* data;
+		uint32_t length;
+		/*
+		 * Nanoseconds after the start of the replay this frame should be released
+		 */
+		uint64_t dueNanos;
+		struct timeval timestamp;
+	};
+
+	/*
+	 * Written only by the thread polling the queue
+	 */
+	struct Queue {
+		std::vector<Frame> frames;
+		uint nextFrame;
+		uint loop;
+	};
+
+	static bool active_;
+	static uint mode_;
+	static uint loops_;
+	static uint32_t myIP_;
+
+	static std::vector<Queue> queues_;
+
+	/*
+	 * Duration of one pass through all files in nanoseconds
+	 */
+	static uint64_t loopDurationNanos_;
+	static std::atomic<uint64_t> startNanos_;
+
+	static std::atomic<uint64_t> framesReplayed_;
+	static std::atomic<uint64_t> bytesReplayed_;
+
+	static std::vector<std::string> GetFileNames();
+
+	/**
+	 * Maps the file and appends all its frames to frames
+	 */
+	static void mapFile(std::string fileName, std::vector<Frame>& frames);
+
+	static uint64_t now();
+};
+
+} /* namespace na62 */
+
+#endif /* PCAPREPLAYER_H_ */
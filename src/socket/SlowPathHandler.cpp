@@ -0,0 +1,58 @@
+/*
+ * SlowPathHandler.cpp
+ *
+ *  Created on: Oct 16, 2026
+ *      Author: Jonas Kunze (kunze.jonas@gmail.com)
+ */
+
+#include "SlowPathHandler.h"
+
+#include <options/Logging.h>
+
+#include "../eventBuilding/L1Builder.h"
+#include "FrameBufferPool.h"
+#include "HandleFrameTask.h"
+
+namespace na62 {
+
+tbb::concurrent_bounded_queue<DataContainer> SlowPathHandler::frames_;
+
+std::atomic<uint64_t> SlowPathHandler::framesProcessed_(0);
+std::atomic<uint64_t> SlowPathHandler::framesDropped_(0);
+
+SlowPathHandler::SlowPathHandler() {
+	frames_.set_capacity(1024);
+}
+
+SlowPathHandler::~SlowPathHandler() {
+}
+
+void SlowPathHandler::enqueueFrame(DataContainer&& container) {
+	if (!frames_.try_push(container)) {
+		framesDropped_.fetch_add(1, std::memory_order_relaxed);
+		FrameBufferPool::freeFrame(container);
+	}
+}
+
+void SlowPathHandler::thread() {
+	DataContainer container = { nullptr, 0, false };
+	try {
+		while (true) {
+			frames_.pop(container);
+			/*
+			 * Only frames already classified as CONTROL_FRAME are enqueued
+			 */
+			HandleFrameTask::processControlFrame(std::move(container));
+			L1Builder::flushL1Batch();
+			framesProcessed_.fetch_add(1, std::memory_order_relaxed);
+		}
+	} catch (tbb::user_abort const& e) {
+		LOG_INFO<< "Stopping slow path thread" << ENDL;
+	}
+}
+
+void SlowPathHandler::onInterruption() {
+	frames_.abort();
+}
+
+} /* namespace na62 */
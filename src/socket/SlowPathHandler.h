@@ -0,0 +1,57 @@
+/*
+ * SlowPathHandler.h
+ *
+ *  Created on: Oct 16, 2026
+ *      Author: Jonas Kunze (kunze.jonas@gmail.com)
+ */
+
+#pragma once
+#ifndef SLOWPATHHANDLER_H_
+#define SLOWPATHHANDLER_H_
+
+#include <sys/types.h>
+#include <atomic>
+#include <cstdint>
+#include <tbb/concurrent_queue.h>
+#include <utils/AExecutable.h>
+
+#include <socket/EthernetUtils.h>
+
+namespace na62 {
+
+/*
+ * Thread processing the rare control frames (ARP, non IP frames, unknown UDP ports) so that
+ * they do not disturb the data path tasks
+ */
+class SlowPathHandler: public AExecutable {
+public:
+	SlowPathHandler();
+	virtual ~SlowPathHandler();
+
+	/**
+	 * Enqueues the frame to be processed by the slow path thread. If the queue is full the
+	 * frame is dropped
+	 */
+	static void enqueueFrame(DataContainer&& container);
+
+	static inline uint64_t GetFramesProcessed() {
+		return framesProcessed_;
+	}
+
+	static inline uint64_t GetFramesDropped() {
+		return framesDropped_;
+	}
+
+private:
+	static tbb::concurrent_bounded_queue<DataContainer> frames_;
+
+	static std::atomic<uint64_t> framesProcessed_;
+	static std::atomic<uint64_t> framesDropped_;
+
+	void thread();
+	void onInterruption();
+};
+
+} /* namespace na62 */
+
+#endif /* SLOWPATHHANDLER_H_ */
@@ -19,6 +19,7 @@
 
 #include "../eventBuilding/StorageHandler.h"
 #include "../options/MyOptions.h"
+#include "../socket/FrameBufferPool.h"
 
 namespace na62 {
 
@@ -58,33 +59,38 @@ void StrawReceiver::onShutDown() {
 	pushSockets_.clear();
 }
 
+void StrawReceiver::freePooledFrame(void*, void* frame) {
+	FrameBufferPool::release((char*) frame);
+}
+
+void StrawReceiver::freeHeapFrame(void*, void* frame) {
+	delete[] (char*) frame;
+}
+
 void StrawReceiver::processFrame(DataContainer&& data, uint burstID) {
 	UDP_HDR* udpIpHdr = reinterpret_cast<UDP_HDR*>(data.data);
 	char* payload = data.data + sizeof(struct UDP_HDR);
 
 	uint sendDataLength = data.length - sizeof(UDP_HDR)
 			+ 8/*header indicating length and PC IP*/;
-	char* sendData = new char[sendDataLength];
 
 	/*
-	 * Write header
+	 * Write header in place of the UDP header directly in front of the payload so that
+	 * the frame buffer can be sent without copying the data
 	 */
+	char* sendData = payload - 8;
+	const uint32_t sourceIP = udpIpHdr->ip.saddr;
 	memcpy(sendData, &sendDataLength, 4);
-	memcpy(sendData + 4, &(udpIpHdr->ip.saddr), 4);
-
-	/*
-	 * Write data
-	 */
-	memcpy(sendData + 8, payload, sendDataLength - 8);
-
-	delete[] data.data;
+	memcpy(sendData + 4, &sourceIP, 4);
 
 	/*
-	 * Prepare ZMQ message
+	 * Prepare ZMQ message. The frame is freed by ZMQ as soon as it has been sent
 	 */
 	zmq::socket_t* socket = pushSockets_[burstID % pushSockets_.size()];
 	zmq::message_t zmqMessage((void*) sendData, sendDataLength,
-			(zmq::free_fn*) ZMQHandler::freeZmqMessage);
+			data.ownerMayFreeData ?
+					(zmq::free_fn*) freeHeapFrame :
+					(zmq::free_fn*) freePooledFrame, data.data);
 
 	/*
 	 * Send burstID and data
@@ -36,6 +36,12 @@ private:
 	static tbb::spin_mutex sendMutex_;
 
 	static std::vector<std::string> getZmqAddresses();
+
+	/*
+	 * ZMQ free functions getting the beginning of the frame buffer as hint
+	 */
+	static void freePooledFrame(void* data, void* frame);
+	static void freeHeapFrame(void* data, void* frame);
 };
 
 } /* namespace na62 */
@@ -0,0 +1,64 @@
+/*
+ * NodeArena.cpp
+ *
+ *  Created on: Oct 16, 2026
+ *      Author: Jonas Kunze (kunze.jonas@gmail.com)
+ */
+
+#include "NodeArena.h"
+
+#include <options/Logging.h>
+
+#include "SystemTopology.h"
+
+namespace na62 {
+
+std::vector<NodeArena*> NodeArena::arenas_;
+thread_local NodeArena* NodeArena::currentThreadArena_ = nullptr;
+
+thread_local cpu_set_t NodeArena::Pinner::previousCPUs_;
+thread_local bool NodeArena::Pinner::previousCPUsValid_ = false;
+
+NodeArena::NodeArena(uint node) :
+		arena_(SystemTopology::GetWorkerCPUsOfNode(node).size()), pinner_(
+				arena_, node) {
+}
+
+NodeArena::Pinner::Pinner(tbb::task_arena& arena, uint node) :
+		tbb::task_scheduler_observer(arena), node_(node) {
+	CPU_ZERO(&cpus_);
+	for (uint cpu : SystemTopology::GetWorkerCPUsOfNode(node)) {
+		CPU_SET(cpu, &cpus_);
+	}
+	observe(true);
+}
+
+NodeArena::Pinner::~Pinner() {
+	observe(false);
+}
+
+void NodeArena::initialize() {
+	for (uint node = 0; node != SystemTopology::GetNumberOfNodes(); node++) {
+		arenas_.push_back(new NodeArena(node));
+	}
+	LOG_INFO<< "Created " << arenas_.size() << " TBB arenas pinned to their NUMA nodes" << ENDL;
+}
+
+void NodeArena::Pinner::on_scheduler_entry(bool) {
+	previousCPUsValid_ = sched_getaffinity(0, sizeof(previousCPUs_),
+			&previousCPUs_) == 0;
+	if (sched_setaffinity(0, sizeof(cpus_), &cpus_) != 0) {
+		LOG_ERROR<< "Unable to pin thread to the CPUs of NUMA node " << node_ << ENDL;
+	}
+}
+
+void NodeArena::Pinner::on_scheduler_exit(bool) {
+	if (previousCPUsValid_
+			&& sched_setaffinity(0, sizeof(previousCPUs_), &previousCPUs_)
+					!= 0) {
+		LOG_ERROR<< "Unable to restore the affinity of a thread leaving NUMA node " << node_ << ENDL;
+	}
+	previousCPUsValid_ = false;
+}
+
+} /* namespace na62 */
@@ -0,0 +1,101 @@
+/*
+ * NodeArena.h
+ *
+ *  Created on: Oct 16, 2026
+ *      Author: Jonas Kunze (kunze.jonas@gmail.com)
+ */
+
+#pragma once
+#ifndef NODEARENA_H_
+#define NODEARENA_H_
+
+/*
+ * Arena local observers need TBB_PREVIEW_LOCAL_OBSERVER which only works if it is defined
+ * before the first TBB header -> it is defined in the build flags
+ */
+#if !TBB_PREVIEW_LOCAL_OBSERVER
+#error "NodeArena requires -DTBB_PREVIEW_LOCAL_OBSERVER=1"
+#endif
+
+#include <sched.h>
+#include <sys/types.h>
+#include <vector>
+#include <tbb/task_arena.h>
+#include <tbb/task_scheduler_observer.h>
+
+namespace na62 {
+
+/*
+ * TBB arena whose worker threads are pinned to the CPUs of one NUMA node that are not used by
+ * PacketHandlers. The PacketHandlers of the queues on that node enqueue their HandleFrameTasks
+ * here so that the frames and events are processed on the node that received them.
+ */
+class NodeArena {
+public:
+	NodeArena(uint node);
+
+	/**
+	 * Creates one arena for every NUMA node
+	 */
+	static void initialize();
+
+	static inline NodeArena* getArena(uint node) {
+		return arenas_[node];
+	}
+
+	/**
+	 * Sets the arena the calling PacketHandler thread should use for all the work it creates
+	 */
+	static inline void setCurrentThreadArena(NodeArena* arena) {
+		currentThreadArena_ = arena;
+	}
+
+	/**
+	 * @return The arena set by setCurrentThreadArena or nullptr
+	 */
+	static inline NodeArena* getCurrentThreadArena() {
+		return currentThreadArena_;
+	}
+
+	/**
+	 * Executes the functor asynchronously within this arena
+	 */
+	template<typename F>
+	inline void enqueue(const F& functor) {
+		arena_.enqueue(functor);
+	}
+
+private:
+	/*
+	 * Pins every thread entering the arena to the worker CPUs of the node and restores its
+	 * previous affinity when it leaves as TBB workers migrate between arenas
+	 */
+	class Pinner: public tbb::task_scheduler_observer {
+	public:
+		Pinner(tbb::task_arena& arena, uint node);
+		virtual ~Pinner();
+
+		void on_scheduler_entry(bool isWorker);
+		void on_scheduler_exit(bool isWorker);
+
+	private:
+		const uint node_;
+		cpu_set_t cpus_;
+
+		static thread_local cpu_set_t previousCPUs_;
+		static thread_local bool previousCPUsValid_;
+	};
+
+	/*
+	 * The arena must be constructed before its observer
+	 */
+	tbb::task_arena arena_;
+	Pinner pinner_;
+
+	static std::vector<NodeArena*> arenas_;
+	static thread_local NodeArena* currentThreadArena_;
+};
+
+} /* namespace na62 */
+
+#endif /* NODEARENA_H_ */
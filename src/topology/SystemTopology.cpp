@@ -0,0 +1,179 @@
+/*
+ * SystemTopology.cpp
+ *
+ *  Created on: Oct 16, 2026
+ *      Author: Jonas Kunze (kunze.jonas@gmail.com)
+ */
+
+#include "SystemTopology.h"
+
+#include <linux/mempolicy.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+
+#include <options/Logging.h>
+
+namespace na62 {
+
+int SystemTopology::nicNode_ = -1;
+std::vector<std::vector<uint> > SystemTopology::nodeCPUs_;
+std::vector<uint> SystemTopology::queueNodes_;
+std::vector<uint> SystemTopology::queueCPUs_;
+
+std::vector<uint> SystemTopology::GetWorkerCPUsOfNode(uint node) {
+	std::vector<uint> cpus;
+	for (uint cpu : nodeCPUs_[node]) {
+		if (std::find(queueCPUs_.begin(), queueCPUs_.end(), cpu)
+				== queueCPUs_.end()) {
+			cpus.push_back(cpu);
+		}
+	}
+	if (cpus.empty()) {
+		return nodeCPUs_[node];
+	}
+	return cpus;
+}
+
+std::string SystemTopology::readLine(std::string fileName) {
+	std::ifstream file(fileName);
+	std::string line;
+	if (file.is_open()) {
+		std::getline(file, line);
+	}
+	return line;
+}
+
+std::vector<uint> SystemTopology::parseCPUList(std::string list) {
+	std::vector<uint> cpus;
+	std::stringstream stream(list);
+	std::string range;
+	while (std::getline(stream, range, ',')) {
+		if (range.empty()) {
+			continue;
+		}
+		size_t dash = range.find('-');
+		uint first = std::atoi(range.substr(0, dash).c_str());
+		uint last =
+				dash == std::string::npos ?
+						first : std::atoi(range.substr(dash + 1).c_str());
+		for (uint cpu = first; cpu <= last; cpu++) {
+			cpus.push_back(cpu);
+		}
+	}
+	return cpus;
+}
+
+void SystemTopology::initialize(std::string ethDeviceName, uint numberOfQueues) {
+	const std::vector<uint> onlineCPUs = parseCPUList(
+			readLine("/sys/devices/system/cpu/online"));
+
+	/*
+	 * Assign all online CPUs to their nodes. Without NUMA support there is only node 0
+	 */
+	for (uint node = 0;; node++) {
+		std::stringstream fileName;
+		fileName << "/sys/devices/system/node/node" << node << "/cpulist";
+		std::string list = readLine(fileName.str());
+		if (list.empty()) {
+			break;
+		}
+
+		std::vector<uint> cpus;
+		for (uint cpu : parseCPUList(list)) {
+			if (std::find(onlineCPUs.begin(), onlineCPUs.end(), cpu)
+					!= onlineCPUs.end()) {
+				cpus.push_back(cpu);
+			}
+		}
+		nodeCPUs_.push_back(cpus);
+	}
+	if (nodeCPUs_.empty()) {
+		nodeCPUs_.push_back(onlineCPUs);
+	}
+
+	/*
+	 * Sort the CPUs of every node by their position within their physical core so that the
+	 * queues are first spread over the physical cores
+	 */
+	for (std::vector<uint>& cpus : nodeCPUs_) {
+		std::vector<std::pair<uint, uint> > siblingRankAndCPU;
+		for (uint cpu : cpus) {
+			std::stringstream fileName;
+			fileName << "/sys/devices/system/cpu/cpu" << cpu
+					<< "/topology/thread_siblings_list";
+			std::vector<uint> siblings = parseCPUList(readLine(fileName.str()));
+			uint rank = std::find(siblings.begin(), siblings.end(), cpu)
+					- siblings.begin();
+			siblingRankAndCPU.push_back(
+					std::make_pair(rank == siblings.size() ? 0 : rank, cpu));
+		}
+		std::sort(siblingRankAndCPU.begin(), siblingRankAndCPU.end());
+
+		cpus.clear();
+		for (auto& rankAndCPU : siblingRankAndCPU) {
+			cpus.push_back(rankAndCPU.second);
+		}
+	}
+
+	/*
+	 * Strip pf_ring prefixes and queue suffixes like zc:eth2@3 or dna:eth2
+	 */
+	std::string interface = ethDeviceName;
+	if (interface.find(':') != std::string::npos) {
+		interface = interface.substr(interface.find(':') + 1);
+	}
+	interface = interface.substr(0, interface.find('@'));
+
+	if (!interface.empty()) {
+		std::string node = readLine(
+				"/sys/class/net/" + interface + "/device/numa_node");
+		if (!node.empty()) {
+			nicNode_ = std::atoi(node.c_str());
+		}
+		if (nicNode_ >= (int) nodeCPUs_.size()) {
+			nicNode_ = -1;
+		}
+	}
+
+	std::vector<uint> queuesPerNode(nodeCPUs_.size(), 0);
+	for (uint queue = 0; queue != numberOfQueues; queue++) {
+		const uint node =
+				nicNode_ >= 0 ? nicNode_ : queue % nodeCPUs_.size();
+		queueNodes_.push_back(node);
+
+		const std::vector<uint>& cpus = nodeCPUs_[node];
+		queueCPUs_.push_back(cpus[queuesPerNode[node]++ % cpus.size()]);
+	}
+
+	std::stringstream summary;
+	summary << "Found " << onlineCPUs.size() << " CPUs on " << nodeCPUs_.size()
+			<< " NUMA nodes. NIC " << interface << " is on node " << nicNode_
+			<< ". Queue CPUs:";
+	for (uint cpu : queueCPUs_) {
+		summary << " " << cpu;
+	}
+	LOG_INFO<< summary.str() << ENDL;
+}
+
+void SystemTopology::setInterleavedAllocation(bool enable) {
+	if (!enable) {
+		syscall(SYS_set_mempolicy, MPOL_DEFAULT, nullptr, 0);
+		return;
+	}
+
+	const uint bitsPerWord = 8 * sizeof(unsigned long);
+	std::vector<unsigned long> nodeMask(nodeCPUs_.size() / bitsPerWord + 1, 0);
+	for (uint node = 0; node != nodeCPUs_.size(); node++) {
+		nodeMask[node / bitsPerWord] |= 1ul << (node % bitsPerWord);
+	}
+	if (syscall(SYS_set_mempolicy, MPOL_INTERLEAVE, nodeMask.data(),
+			nodeMask.size() * bitsPerWord + 1) != 0) {
+		LOG_ERROR<< "Unable to interleave memory over all NUMA nodes" << ENDL;
+	}
+}
+
+} /* namespace na62 */
@@ -0,0 +1,100 @@
+/*
+ * SystemTopology.h
+ *
+ *  Created on: Oct 16, 2026
+ *      Author: Jonas Kunze (kunze.jonas@gmail.com)
+ */
+
+#pragma once
+#ifndef SYSTEMTOPOLOGY_H_
+#define SYSTEMTOPOLOGY_H_
+
+#include <sys/types.h>
+#include <string>
+#include <vector>
+
+namespace na62 {
+
+/*
+ * CPU and NUMA topology of the machine as found in sysfs and the NUMA node of the NIC
+ * receiving the data. Used to place the PacketHandlers, their frame buffers and the
+ * HandleFrameTasks onto the node of the NIC.
+ */
+class SystemTopology {
+public:
+	/**
+	 * Reads the topology from sysfs
+	 *
+	 * @param ethDeviceName The name of the pf_ring device, e.g. eth2, zc:eth2@0 or dna0. Empty
+	 * if no NIC is used (pcap replay, benchmark)
+	 * @param numberOfQueues The number of RX queues (PacketHandlers)
+	 */
+	static void initialize(std::string ethDeviceName, uint numberOfQueues);
+
+	static inline uint GetNumberOfNodes() {
+		return nodeCPUs_.size();
+	}
+
+	/**
+	 * @return All online CPUs of the node. The first hyperthread of every physical core comes
+	 * before all the second hyperthreads
+	 */
+	static inline const std::vector<uint>& GetCPUsOfNode(uint node) {
+		return nodeCPUs_[node];
+	}
+
+	/**
+	 * @return The CPUs of the node without the ones the PacketHandlers are pinned to. All CPUs
+	 * of the node if the PacketHandlers occupy all of them
+	 */
+	static std::vector<uint> GetWorkerCPUsOfNode(uint node);
+
+	/**
+	 * @return The NUMA node of the NIC or -1 if it is unknown
+	 */
+	static inline int GetNICNode() {
+		return nicNode_;
+	}
+
+	/**
+	 * @return The node the RX queue should be processed on: the NIC's node or, if unknown,
+	 * the nodes in round robin
+	 */
+	static inline uint GetNodeOfQueue(uint queue) {
+		return queueNodes_[queue];
+	}
+
+	/**
+	 * @return The CPU the PacketHandler of the RX queue should be pinned to. The queues of a
+	 * node are first distributed over the physical cores and then over the hyperthreads
+	 */
+	static inline uint GetCPUOfQueue(uint queue) {
+		return queueCPUs_[queue];
+	}
+
+	/**
+	 * Sets the memory policy of the calling thread to interleave all new pages over all nodes
+	 * (enable=true) or to allocate them on the local node (enable=false)
+	 */
+	static void setInterleavedAllocation(bool enable);
+
+private:
+	static int nicNode_;
+	static std::vector<std::vector<uint> > nodeCPUs_;
+	static std::vector<uint> queueNodes_;
+	static std::vector<uint> queueCPUs_;
+
+	/**
+	 * Parses lists like "0-3,8,10-11"
+	 */
+	static std::vector<uint> parseCPUList(std::string list);
+
+	/**
+	 * @return The first line of the file or an empty string if it does not exist
+	 */
+	static std::string readLine(std::string fileName);
+};
+
+} /* namespace na62 */
+
+#endif /* SYSTEMTOPOLOGY_H_ */